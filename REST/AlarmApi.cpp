@@ -15,7 +15,6 @@
 #include <pistache/http.h>
 
 #include "AlarmApi.hpp"
-#include "alarm.hpp"
 #include "common.hpp"
 
 using namespace Pistache;
@@ -27,7 +26,7 @@ using namespace DigitalRooster::REST;
 static Q_LOGGING_CATEGORY(CLASS_LC, "AlarmApi");
 
 /*****************************************************************************/
-AlarmApi::AlarmApi(IAlarmStore& as, Pistache::Rest::Router& router)
+AlarmApi::AlarmApi(ConcurrentStore& as, Pistache::Rest::Router& router)
     : alarmstore(as) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
 
@@ -49,7 +48,8 @@ AlarmApi::AlarmApi(IAlarmStore& as, Pistache::Rest::Router& router)
 void AlarmApi::read_alarm_list(const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    respond_json_array(alarmstore.get_alarms(), request, response);
+    auto snapshot = alarmstore.get_snapshot();
+    respond_json_array(snapshot->alarms, request, response);
 }
 
 /*****************************************************************************/
@@ -63,8 +63,8 @@ void AlarmApi::get_alarm(const Pistache::Rest::Request& request,
         auto uid = QUuid::fromString(
             QLatin1String(request.param(":uid").as<std::string>().c_str()));
         QJsonDocument jd;
-        auto result = alarmstore.get_alarm(uid);
-        jd.setObject(result->to_json_object());
+        auto snapshot = alarmstore.get_snapshot();
+        jd.setObject(find_json_by_id(snapshot->alarms, uid));
         response.setMime(Pistache::Http::Mime::MediaType::fromString("application/json"));
         response.send(Pistache::Http::Code::Ok, jd.toJson().toStdString());
     } catch (std::out_of_range& oor) {
@@ -86,10 +86,14 @@ void AlarmApi::add_alarm(const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     try {
-        auto alm =
-            Alarm::from_json_object(qjson_form_std_string(request.body()));
-        alarmstore.add_alarm(alm);
-        respond_SuccessCreated(alm, response);
+        auto id = wait_for_store(
+            alarmstore.add_alarm(qjson_form_std_string(request.body())));
+        respond_SuccessCreated(id, response);
+    } catch (StoreUnavailable&) {
+        response.setMime(
+            Pistache::Http::Mime::MediaType::fromString("application/json"));
+        response.send(
+            Pistache::Http::Code::Service_Unavailable, SERVICE_UNAVAILABLE);
     } catch (std::invalid_argument& ia) {
         InternalErrorJson je(ia, 400);
         response.setMime(
@@ -111,8 +115,13 @@ void AlarmApi::delete_alarm(const Pistache::Rest::Request& request,
         // Massively ugly casting to get something convertible to QUuid...
         auto uid = QUuid::fromString(
             QLatin1String(request.param(":uid").as<std::string>().c_str()));
-        alarmstore.delete_alarm(uid);
+        wait_for_store(alarmstore.delete_alarm(uid));
         response.send(Pistache::Http::Code::Ok); // DELETE ok without MIME TYPE
+    } catch (StoreUnavailable&) {
+        response.setMime(
+            Pistache::Http::Mime::MediaType::fromString("application/json"));
+        response.send(
+            Pistache::Http::Code::Service_Unavailable, SERVICE_UNAVAILABLE);
     } catch (std::out_of_range& oor) {
         response.setMime(
              Pistache::Http::Mime::MediaType::fromString("application/json"));
@@ -16,7 +16,7 @@
 #include <pistache/router.h>
 #include <string>
 
-#include "IAlarmStore.hpp"
+#include "concurrent_store.hpp"
 
 namespace DigitalRooster {
 namespace REST {
@@ -30,7 +30,7 @@ namespace REST {
          * @param alarmstore backend that provides access to Alarm list
          * @param router
          */
-        AlarmApi(IAlarmStore& station, Pistache::Rest::Router& router);
+        AlarmApi(ConcurrentStore& alarmstore, Pistache::Rest::Router& router);
 
         /**
          * resource name under \ref{API_URL_BASE}
@@ -76,7 +76,7 @@ namespace REST {
         /**
          * Backend handling internet Alarm stations in configuration
          */
-        IAlarmStore& alarmstore;
+        ConcurrentStore& alarmstore;
         /**
          * API resource name
          */
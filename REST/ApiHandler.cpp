@@ -38,10 +38,8 @@ const int PISTACHE_SERVER_MAX_RESPONSE_SIZE = 32768;
 
 /*****************************************************************************/
 /* PIMPL initialization */
-DigitalRooster::RestApi::RestApi(DigitalRooster::IWeatherConfigStore& ws,
-    DigitalRooster::IAlarmStore& asr, DigitalRooster::IPodcastStore& ps,
-    DigitalRooster::IStationStore& sts, DigitalRooster::ITimeOutStore& tos)
-    : impl(std::make_unique<ApiHandler>(ws, asr, ps, sts, tos,
+DigitalRooster::RestApi::RestApi(DigitalRooster::ConcurrentStore& store)
+    : impl(std::make_unique<ApiHandler>(store,
           Pistache::Address(
               Pistache::Ipv4::any(), Pistache::Port(REST_API_PORT)))) {
 }
@@ -51,14 +49,12 @@ DigitalRooster::RestApi::RestApi(DigitalRooster::IWeatherConfigStore& ws,
 DigitalRooster::RestApi::~RestApi() = default;
 
 /*****************************************************************************/
-ApiHandler::ApiHandler(DigitalRooster::IWeatherConfigStore& ws,
-    DigitalRooster::IAlarmStore& as, DigitalRooster::IPodcastStore& ps,
-    DigitalRooster::IStationStore& sts, DigitalRooster::ITimeOutStore& tos,
-    Pistache::Address addr)
+ApiHandler::ApiHandler(
+    DigitalRooster::ConcurrentStore& store, Pistache::Address addr)
     : endpoint(addr)
-    , alarmapi(as, router)
-    , radioapi(sts, router)
-    , podcastsapi(ps, router) {
+    , alarmapi(store, router)
+    , radioapi(store, router)
+    , podcastsapi(store, router) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
 
     auto opts =
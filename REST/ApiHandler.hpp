@@ -24,17 +24,10 @@
 #include <pistache/http.h>
 #include <pistache/router.h>
 
-#include "ITimeoutStore.hpp"
-#include "IWeatherConfigStore.hpp"
-
 #include "AlarmApi.hpp"
-#include "IAlarmStore.hpp"
-
-#include "IPodcastStore.hpp"
 #include "PodcastApi.hpp"
-
-#include "IStationStore.hpp"
 #include "RadioApi.hpp"
+#include "concurrent_store.hpp"
 
 namespace DigitalRooster {
 namespace REST {
@@ -43,10 +36,13 @@ namespace REST {
      */
     class ApiHandler {
     public:
-        ApiHandler(DigitalRooster::IWeatherConfigStore& ws,
-            DigitalRooster::IAlarmStore& as, DigitalRooster::IPodcastStore& ps,
-            DigitalRooster::IStationStore& sts,
-            DigitalRooster::ITimeOutStore& tos, Pistache::Address addr);
+        /**
+         * Setup API implementations and start server threads
+         * @param store thread safe access to configuration
+         * @param addr listen address
+         */
+        ApiHandler(
+            DigitalRooster::ConcurrentStore& store, Pistache::Address addr);
 
         /**
          * Read list of podcast sources
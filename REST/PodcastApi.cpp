@@ -15,7 +15,6 @@
 #include <pistache/http.h>
 
 #include "PodcastApi.hpp"
-#include "PodcastSource.hpp"
 
 #include "common.hpp"
 
@@ -28,7 +27,7 @@ using namespace DigitalRooster::REST;
 static Q_LOGGING_CATEGORY(CLASS_LC, "PodcastApi");
 
 /*****************************************************************************/
-PodcastApi::PodcastApi(IPodcastStore& ps, Pistache::Rest::Router& router)
+PodcastApi::PodcastApi(ConcurrentStore& ps, Pistache::Rest::Router& router)
     : podcaststore(ps) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
 
@@ -49,7 +48,8 @@ PodcastApi::PodcastApi(IPodcastStore& ps, Pistache::Rest::Router& router)
 void PodcastApi::read_podcast_list(const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    respond_json_array(podcaststore.get_podcast_sources(), request, response);
+    auto snapshot = podcaststore.get_snapshot();
+    respond_json_array(snapshot->podcasts, request, response);
 }
 
 /*****************************************************************************/
@@ -62,8 +62,8 @@ void PodcastApi::get_podcast(const Pistache::Rest::Request& request,
         auto uid = QUuid::fromString(
             QLatin1String(request.param(":uid").as<std::string>().c_str()));
         QJsonDocument jd;
-        auto result = podcaststore.get_podcast_source(uid);
-        jd.setObject(result->to_json_object());
+        auto snapshot = podcaststore.get_snapshot();
+        jd.setObject(find_json_by_id(snapshot->podcasts, uid));
         response.setMime(
             Pistache::Http::Mime::MediaType::fromString("application/json"));
         response.send(Pistache::Http::Code::Ok, jd.toJson().toStdString());
@@ -84,10 +84,14 @@ void PodcastApi::add_podcast(const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     try {
-        auto ps = PodcastSource::from_json_object(
-            qjson_form_std_string(request.body()));
-        podcaststore.add_podcast_source(ps);
-        respond_SuccessCreated(ps, response);
+        auto id = wait_for_store(podcaststore.add_podcast_source(
+            qjson_form_std_string(request.body())));
+        respond_SuccessCreated(id, response);
+    } catch (StoreUnavailable&) {
+        response.setMime(
+            Pistache::Http::Mime::MediaType::fromString("application/json"));
+        response.send(
+            Pistache::Http::Code::Service_Unavailable, SERVICE_UNAVAILABLE);
     } catch (std::invalid_argument& ia) {
         response.setMime(
             Pistache::Http::Mime::MediaType::fromString("application/json"));
@@ -106,8 +110,13 @@ void PodcastApi::delete_podcast(const Pistache::Rest::Request& request,
         // Massively ugly casting to get something convertible to QUuid...
         auto uid = QUuid::fromString(
             QLatin1String(request.param(":uid").as<std::string>().c_str()));
-        podcaststore.delete_podcast_source(uid);
+        wait_for_store(podcaststore.delete_podcast_source(uid));
         response.send(Pistache::Http::Code::Ok); // NO Mimetype when delete OK
+    } catch (StoreUnavailable&) {
+        response.setMime(
+            Pistache::Http::Mime::MediaType::fromString("application/json"));
+        response.send(
+            Pistache::Http::Code::Service_Unavailable, SERVICE_UNAVAILABLE);
     } catch (std::out_of_range& oor) {
         response.setMime(
             Pistache::Http::Mime::MediaType::fromString("application/json"));
@@ -16,7 +16,7 @@
 #include <pistache/router.h>
 #include <string>
 
-#include "IPodcastStore.hpp"
+#include "concurrent_store.hpp"
 
 namespace DigitalRooster {
 namespace REST {
@@ -28,7 +28,7 @@ namespace REST {
          * @param ps backend that provides access list of PodcastSource
          * @param router
          */
-        PodcastApi(IPodcastStore& ps, Pistache::Rest::Router& router);
+        PodcastApi(ConcurrentStore& ps, Pistache::Rest::Router& router);
 
         /**
          * resource name under \ref{API_URL_BASE}
@@ -74,7 +74,7 @@ namespace REST {
         /**
          * Backend handling for storing PodcastSource in configuration
          */
-        IPodcastStore& podcaststore;
+        ConcurrentStore& podcaststore;
         /**
          * API resource name
          */
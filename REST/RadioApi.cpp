@@ -14,7 +14,6 @@
 #include <pistache/endpoint.h>
 #include <pistache/http.h>
 
-#include "PlayableItem.hpp"
 #include "RadioApi.hpp"
 #include "common.hpp"
 #include "util.hpp"
@@ -28,7 +27,7 @@ using namespace DigitalRooster::REST;
 static Q_LOGGING_CATEGORY(CLASS_LC, "RadioAPI");
 
 /*****************************************************************************/
-RadioApi::RadioApi(IStationStore& station, Pistache::Rest::Router& router)
+RadioApi::RadioApi(ConcurrentStore& station, Pistache::Rest::Router& router)
     : stationstore(station) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
 
@@ -49,7 +48,8 @@ RadioApi::RadioApi(IStationStore& station, Pistache::Rest::Router& router)
 void RadioApi::read_radio_list(const Pistache::Rest::Request& request,
     Pistache::Http::ResponseWriter response) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    respond_json_array(stationstore.get_stations(), request, response);
+    auto snapshot = stationstore.get_snapshot();
+    respond_json_array(snapshot->stations, request, response);
 }
 
 /*****************************************************************************/
@@ -62,8 +62,8 @@ void RadioApi::get_station(const Pistache::Rest::Request& request,
         auto uid = QUuid::fromString(
             QLatin1String(request.param(":uid").as<std::string>().c_str()));
         QJsonDocument jd;
-        auto result = stationstore.get_station(uid);
-        jd.setObject(result->to_json_object());
+        auto snapshot = stationstore.get_snapshot();
+        jd.setObject(find_json_by_id(snapshot->stations, uid));
         response.setMime(
             Pistache::Http::Mime::MediaType::fromString("application/json"));
         response.send(Pistache::Http::Code::Ok, jd.toJson().toStdString());
@@ -87,10 +87,14 @@ void RadioApi::add_station(const Pistache::Rest::Request& request,
     try {
         response.setMime(
             Pistache::Http::Mime::MediaType::fromString("application/json"));
-        auto st = PlayableItem::from_json_object(
-            qjson_form_std_string(request.body()));
-        stationstore.add_radio_station(st);
-        respond_SuccessCreated(st, response);
+        auto id = wait_for_store(stationstore.add_radio_station(
+            qjson_form_std_string(request.body())));
+        respond_SuccessCreated(id, response);
+    } catch (StoreUnavailable&) {
+        response.setMime(
+            Pistache::Http::Mime::MediaType::fromString("application/json"));
+        response.send(
+            Pistache::Http::Code::Service_Unavailable, SERVICE_UNAVAILABLE);
     } catch (std::invalid_argument& ia) {
         InternalErrorJson je(ia, 400);
         response.setMime(
@@ -111,8 +115,13 @@ void RadioApi::delete_station(const Pistache::Rest::Request& request,
         // Massively ugly casting to get something convertible to QUuid...
         auto uid = QUuid::fromString(
             QLatin1String(request.param(":uid").as<std::string>().c_str()));
-        stationstore.delete_radio_station(uid);
+        wait_for_store(stationstore.delete_radio_station(uid));
         response.send(Pistache::Http::Code::Ok); // NO MIME TYPE!
+    } catch (StoreUnavailable&) {
+        response.setMime(
+            Pistache::Http::Mime::MediaType::fromString("application/json"));
+        response.send(
+            Pistache::Http::Code::Service_Unavailable, SERVICE_UNAVAILABLE);
     } catch (std::out_of_range& oor) {
         response.setMime(
              Pistache::Http::Mime::MediaType::fromString("application/json"));
@@ -16,7 +16,7 @@
 #include <pistache/router.h>
 #include <string>
 
-#include "IStationStore.hpp"
+#include "concurrent_store.hpp"
 
 namespace DigitalRooster {
 namespace REST {
@@ -28,7 +28,7 @@ namespace REST {
          * @param station backend that provides access to radio stations
          * @param router
          */
-        RadioApi(IStationStore& station, Pistache::Rest::Router& router);
+        RadioApi(ConcurrentStore& station, Pistache::Rest::Router& router);
 
         /**
          * resource name under \ref{API_URL_BASE}
@@ -74,7 +74,7 @@ namespace REST {
         /**
          * Backend handling internet radio stations in configuration
          */
-        IStationStore& stationstore;
+        ConcurrentStore& stationstore;
         /**
          * API resource name
          */
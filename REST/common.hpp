@@ -13,18 +13,25 @@
 #ifndef _REST_COMMON_HPP_
 #define _REST_COMMON_HPP_
 
+#include <chrono>
+#include <future>
 #include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <optional>
 
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QJsonObject>
 #include <QJsonValue>
+#include <QUuid>
 #include <pistache/endpoint.h>
 #include <pistache/http.h>
 #include <pistache/router.h>
 
+#include "concurrent_store.hpp"
+
 namespace DigitalRooster {
 namespace REST {
 
@@ -40,6 +47,42 @@ namespace REST {
     const std::string BAD_REQUEST_NO_ITEM_WITH_UUID =
         R"({"code":400, "message": "no item for this UUID"})";
 
+    /**
+     * Reponse if the configuration did not execute a change in time
+     */
+    const std::string SERVICE_UNAVAILABLE =
+        R"({"code":503, "message": "configuration not available"})";
+
+    /**
+     * Maximum time to wait for a change of the configuration, e.g. the Qt
+     * thread no longer executes changes after the application quit
+     */
+    const std::chrono::seconds STORE_TIMEOUT(5);
+
+    /**
+     * Thrown if the configuration did not execute a change in time
+     */
+    struct StoreUnavailable : public std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Wait for the result of a change posted to the configuration
+     * @throws StoreUnavailable after STORE_TIMEOUT, the change is cancelled
+     *         and never applied
+     * @param change returned by ConcurrentStore
+     * @return result or exception of change
+     */
+    template <typename T> T wait_for_store(StoreChange<T> change) {
+        if (change.result.wait_for(STORE_TIMEOUT) !=
+                std::future_status::ready &&
+            change.cancel()) {
+            throw StoreUnavailable("configuration did not respond");
+        }
+        /* a change that already started is applied, wait for its result */
+        return change.result.get();
+    }
+
     /**
      * Helper structure to package exceptions and reformat them into
      * JSON messages
@@ -104,9 +147,7 @@ namespace REST {
      * Simple Helper function that creates a HTTP response with a JSON array of
      * the requested objects
      * @tparam T some container type
-     * @tparam T
-     * @param all container with pointers to objects that implement
-     * to_json_object()
+     * @param all container of QJsonObjects e.g. StoreSnapshot::alarms
      * @param request query with possibly "length" and "offset" parameters
      * @param response output writer
      */
@@ -134,7 +175,7 @@ namespace REST {
         try {
             QJsonArray j;
             for (const auto& p : container_from_range(all, offset, length)) {
-                j.push_back(QJsonValue(p->to_json_object()));
+                j.push_back(QJsonValue(p));
             }
             QJsonDocument jdoc;
             jdoc.setArray(j);
@@ -154,16 +195,14 @@ namespace REST {
      * Helper function to make a correct SuccessCreated JSON response with the
      * unique id as only content. Used for creation of Alarm, podcastSources and
      * PlayableItem i.e. RadioStations
-     * @tparam T a (smart) pointer to an object that implemntes QUuid get_id()
-     * @param item created item
+     * @param id unique id of created item
      * @param response
      */
-    template <typename T>
-    void respond_SuccessCreated(
-        const T& item, Pistache::Http::ResponseWriter& response) {
+    inline void respond_SuccessCreated(
+        const QUuid& id, Pistache::Http::ResponseWriter& response) {
         QJsonDocument jd;
         QJsonObject o;
-        o["id"] = item->get_id().toString(QUuid::WithoutBraces);
+        o["id"] = id.toString(QUuid::WithoutBraces);
         jd.setObject(o);
         response.setMime(Pistache::Http::Mime::MediaType::fromString("application/json"));
         response.send(Pistache::Http::Code::Ok, jd.toJson().toStdString());
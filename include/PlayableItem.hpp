@@ -23,6 +23,8 @@
 
 #include <memory>
 
+#include "episode_cache.hpp"
+
 namespace DigitalRooster {
 
 /**
@@ -151,7 +153,7 @@ signals:
     void position_updated(qint64 newpos);
 
     /**
-     * Any information changed
+     * Any information changed, except position (see \ref position_updated)
      */
     void data_changed();
 
@@ -218,6 +220,21 @@ public:
     void set_description(const QString& desc);
     const QString& get_description() const;
 
+    /**
+     * Description restored from a binary cache file, decoded with the first
+     * call of \ref get_description
+     * @param desc description in mapped cache file
+     */
+    void set_mapped_description(const MappedText& desc);
+
+    /**
+     * Description that has not been decoded yet
+     * @return mapped text, invalid after first \ref get_description
+     */
+    const MappedText& get_mapped_description() const {
+        return mapped_description;
+    }
+
     /**
      * Podcast publisher assinged unique ID can be URL or UUID formatted string
      * @param uid new unique ID
@@ -245,6 +262,12 @@ public:
      */
     bool already_listened() const;
 
+    /**
+     * Mark episode listened, e.g. restored from the position journal
+     *   emits \ref listened_changed(bool) if it was not listened before
+     */
+    void set_listened();
+
     /**
      * Total length of media in ms
      * @return
@@ -289,9 +312,15 @@ signals:
 
 private:
     /**
-     * Synopsis of this episode
+     * Synopsis of this episode, decoded from \ref mapped_description
+     * when needed
+     */
+    mutable QString description;
+
+    /**
+     * Synopsis in cache file that has not been decoded yet
      */
-    QString description;
+    mutable MappedText mapped_description;
 
     /**
      * Global Unique ID of podcast, assigned by publisher in RSS
@@ -17,6 +17,7 @@
 #include <QDate>
 #include <QDateTime>
 #include <QDir>
+#include <QHash>
 #include <QJsonObject>
 #include <QMap>
 #include <QObject>
@@ -31,10 +32,12 @@
 #include "appconstants.hpp"
 #include "PlayableItem.hpp"
 #include "UpdateTask.hpp"
+#include "episode_store.hpp"
 #include "podcast_serializer.hpp"
 
 namespace DigitalRooster {
 class HttpClient; // forward declaration
+class PositionJournal;
 
 /**
  * Class representing information form an RSS Podcast feed with
@@ -68,6 +71,14 @@ public:
      */
     void set_update_task(std::unique_ptr<UpdateTask>&& ut);
 
+    /**
+     * Podcast source can be refreshed
+     * @return true if an UpdateTask was set
+     */
+    bool has_update_task() const {
+        return updater != nullptr;
+    }
+
     /**
      * Serializer stores and restores data to/from cache file
      * A PodcastSerializer is responsible for only one PodcastSource,
@@ -76,11 +87,36 @@ public:
      */
     void set_serializer(std::unique_ptr<PodcastSerializer>&& pser);
 
+    /**
+     * Playback positions of episodes are recorded in the journal instead
+     * of triggering a write of the cache file. Positions found in the
+     * journal are applied to episodes when they are added.
+     * @param journal shared by all podcast sources
+     */
+    void set_position_journal(std::shared_ptr<PositionJournal> journal);
+
     /**
      * Add an episode to episodes
      */
     void add_episode(const std::shared_ptr<PodcastEpisode>& episode);
 
+    /**
+     * Add many episodes with one sorted merge. Known episodes and episodes
+     * older than the \ref max_episodes most recent are skipped.
+     * \ref episodes_changed and \ref episodes_count_changed are emitted
+     * once at the end, not for each episode.
+     * @param new_episodes episodes in any order
+     */
+    void add_episodes(
+        std::vector<std::shared_ptr<PodcastEpisode>> new_episodes);
+
+    /**
+     * Add episodes as plain values, no PodcastEpisode is created.
+     * Same rules and signals as \ref add_episodes
+     * @param records episodes in any order
+     */
+    void add_episode_records(std::vector<EpisodeRecord> records);
+
     /**
      * Description of the Channel (mandatory by RSS2.0 spec)
      */
@@ -88,6 +124,14 @@ public:
         return description;
     }
 
+    /**
+     * Plain text of \ref description for lists, computed when the
+     * description is set
+     */
+    const QString& get_description_summary() const {
+        return description_summary;
+    }
+
     /**
      * When was this podcast source last scanned for new items
      */
@@ -119,7 +163,24 @@ public:
      * @param id episode id (can be UUID or URL format)
      * @return the episode or nullptr
      */
-    std::shared_ptr<PodcastEpisode> get_episode_by_id(const QString& id) const;
+    std::shared_ptr<PodcastEpisode> get_episode_by_id(const QString& id);
+
+    /**
+     * QObject of the episode in a row, created when first requested and
+     * alive as long as it is referenced. Changes of the episode are written
+     * back to \ref episode_store
+     * @param row 0..get_episode_count()-1
+     * @return the episode or nullptr if row is out of range
+     */
+    std::shared_ptr<PodcastEpisode> get_episode(int row);
+
+    /**
+     * Read access to episode values without creating QObjects
+     * @return \ref episode_store
+     */
+    const EpisodeStore& get_episode_store() const {
+        return episode_store;
+    }
 
     /**
      * Website of RSS feed channel (not the rss xml URI but additional
@@ -155,6 +216,14 @@ public:
         return get_icon_impl();
     }
 
+    /**
+     * Download icon if the local cache file is missing, e.g. checked on a
+     * worker thread. emits \ref icon_changed once the file is stored.
+     */
+    void download_icon() {
+        trigger_image_download();
+    }
+
     /**
      * show max_episodes in the list
      */
@@ -162,6 +231,13 @@ public:
         return max_episodes;
     };
 
+    /**
+     * Number of latest episodes kept for offline playback
+     */
+    int get_offline_episodes() const {
+        return offline_episodes;
+    }
+
     /**
      * title element of RSS channel
      * @return \ref title
@@ -179,13 +255,65 @@ public:
     };
 
     /**
-     * Set the PodcastSourceAutoupdating
-     * will restart the timer if interval is less than current \ref
-     * update_interval
+     * Set the refresh interval, lower bound of the adaptive interval
+     * used by RefreshScheduler after the next refresh
      * @param interval
      */
     void set_update_interval(std::chrono::seconds interval);
 
+    /**
+     * Upper bound of adaptive refresh interval
+     * @return \ref max_update_interval
+     */
+    std::chrono::seconds get_max_update_interval() const {
+        return max_update_interval;
+    };
+
+    /**
+     * Set upper bound of adaptive refresh interval, a value less or equal
+     * \ref update_interval disables adaption
+     * @param interval
+     */
+    void set_max_update_interval(std::chrono::seconds interval);
+
+    /**
+     * Interval learned from publication dates and unchanged refreshes
+     * @return interval or 0 if nothing has been learned yet
+     */
+    std::chrono::seconds get_learned_update_interval() const {
+        return learned_update_interval;
+    };
+
+    /**
+     * Restore learned interval from cache
+     * @param interval learned interval
+     * @param unchanged refreshes without new episodes
+     */
+    void set_learned_update_interval(
+        std::chrono::seconds interval, int unchanged);
+
+    /**
+     * Number of refreshes without new episodes since the last new episode
+     * @return \ref unchanged_refreshes
+     */
+    int get_unchanged_refreshes() const {
+        return unchanged_refreshes;
+    }
+
+    /**
+     * Time until next refresh, learned interval within
+     * [\ref update_interval, \ref max_update_interval]
+     * @return interval used by RefreshScheduler
+     */
+    std::chrono::seconds get_effective_update_interval() const;
+
+    /**
+     * A refresh has completed, adapt the refresh interval to the
+     * publication cadence of the feed
+     * @param new_episodes the refresh found new episodes
+     */
+    void record_refresh(bool new_episodes);
+
     /**
      * URL for rss feed of this podcast
      * @return \ref rss_feed_uri
@@ -212,12 +340,50 @@ public:
      */
     void set_link(const QUrl& newVal);
 
+    /**
+     * ETag of the last RSS document that was parsed successfully
+     * @return \ref http_etag
+     */
+    const QString& get_http_etag() const {
+        return http_etag;
+    }
+
+    /**
+     * Last-Modified header of the last RSS document parsed successfully
+     * @return \ref http_last_modified
+     */
+    const QString& get_http_last_modified() const {
+        return http_last_modified;
+    }
+
+    /**
+     * Cache validators sent with the next update request
+     * (empty strings for unconditional request)
+     * @param etag ETag header value
+     * @param last_modified Last-Modified header value
+     */
+    void set_http_validators(
+        const QString& etag, const QString& last_modified);
+
+    /**
+     * Counters of the UpdateTask
+     * @return statistics or all zero if there is no UpdateTask
+     */
+    UpdateStatistics get_update_statistics() const;
+
     /**
      * set number of displayed/downloaded episodes
      * @param max value >=0
      */
     void set_max_episodes(int max);
 
+    /**
+     * set number of latest episodes downloaded for offline playback
+     *   emits \ref offline_episodes_changed
+     * @param count value >= 0, 0 disables downloads
+     */
+    void set_offline_episodes(int count);
+
     /**
      * title element of RSS channel
      * \param newTitle
@@ -225,9 +391,11 @@ public:
     void set_title(const QString& newTitle);
 
     /**
-     * Access to \ref episodes (the Playable items)
+     * QObjects for all episodes, newest first. Creates a PodcastEpisode
+     * for every episode, use \ref get_episode_store to read values
+     * @return episodes
      */
-    const std::vector<std::shared_ptr<PodcastEpisode>>& get_episodes() const {
+    std::vector<std::shared_ptr<PodcastEpisode>> get_episodes() {
         return get_episodes_impl();
     }
 
@@ -272,7 +440,8 @@ public:
     /**
      * Create PodcastSource from JSON JSonObject
      * @param json representation
-     * @return PodcastSource - default initialized if fields are missing
+     * @return PodcastSource - default initialized if fields are missing,
+     *         without UpdateTask
      */
     static std::shared_ptr<PodcastSource> from_json_object(
         const QJsonObject& json);
@@ -290,6 +459,11 @@ public slots:
      */
     void refresh();
 
+    /**
+     * Stop a refresh in progress, update_finished() is not emitted for it
+     */
+    void abort_refresh();
+
     /**
      * purges local cache, removes all episodes and updates from internet
      */
@@ -332,6 +506,25 @@ signals:
      */
     void episodes_count_changed(int count);
 
+    /**
+     * Summary of one \ref add_episodes call
+     * @param inserted number of episodes added
+     * @param removed number of oldest episodes dropped for new ones
+     */
+    void episodes_changed(int inserted, int removed);
+
+    /**
+     * Number of episodes kept for offline playback changed
+     * @param count new value
+     */
+    void offline_episodes_changed(int count);
+
+    /**
+     * A refresh of the RSS feed has ended
+     * @param success feed was parsed completely or has not been modified
+     */
+    void update_finished(bool success);
+
 private:
     /**
      * unique id for this Podcast RSS source
@@ -354,9 +547,14 @@ private:
     QString description;
 
     /**
-     * Container for Episodes of this podcast
+     * \ref description without HTML
+     */
+    QString description_summary;
+
+    /**
+     * Episodes of this podcast as plain values, newest first
      */
-    std::vector<std::shared_ptr<PodcastEpisode>> episodes;
+    EpisodeStore episode_store;
 
     /**
      * When was this podcast source last updated (by the publisher)
@@ -369,6 +567,16 @@ private:
      */
     QUrl link;
 
+    /**
+     * HTTP ETag of RSS feed for conditional requests
+     */
+    QString http_etag;
+
+    /**
+     * HTTP Last-Modified of RSS feed for conditional requests
+     */
+    QString http_last_modified;
+
     /**
      * Logo Image of podcast
      */
@@ -384,11 +592,31 @@ private:
      */
     size_t max_episodes = DigitalRooster::DEFAULT_MAX_EPISODES;
 
+    /**
+     * latest episodes downloaded for offline playback
+     */
+    int offline_episodes = DigitalRooster::DEFAULT_OFFLINE_EPISODES;
+
     /**
      * Interval in ms for auto refresh of content
      * default to 1h
      */
-    std::chrono::seconds update_interval{3600LL};
+    std::chrono::seconds update_interval{DEFAULT_UPDATE_INTERVAL};
+
+    /**
+     * Upper bound of adaptive refresh interval
+     */
+    std::chrono::seconds max_update_interval{DEFAULT_MAX_UPDATE_INTERVAL};
+
+    /**
+     * Refresh interval learned from publication cadence, 0 if unknown
+     */
+    std::chrono::seconds learned_update_interval{0};
+
+    /**
+     * Refreshes without new episodes (304 or known items only)
+     */
+    int unchanged_refreshes = 0;
 
     /**
      * Optional UpdateTask
@@ -400,10 +628,20 @@ private:
      */
     std::unique_ptr<PodcastSerializer> serializer = nullptr;
 
+    /**
+     * Optional journal for playback positions
+     */
+    std::shared_ptr<PositionJournal> position_journal;
+
     /**
      * Optional Icon Downloader - only used to refresh icon
      */
     std::unique_ptr<HttpClient> icon_downloader = nullptr;
+
+    /**
+     * URL downloaded by \ref icon_downloader
+     */
+    QUrl icon_download_url;
     /**
      * temporary connection to receive signal form icon_downloader
      */
@@ -420,13 +658,32 @@ private:
      * @return the episode or nullptr
      */
     virtual std::shared_ptr<PodcastEpisode> get_episode_by_id_impl(
-        const QString& id) const;
+        const QString& id);
     /**
      * implementation of \ref get_episodes
-     * @return \ref episodes
+     * @return QObjects for all episodes in \ref episode_store
+     */
+    virtual std::vector<std::shared_ptr<PodcastEpisode>> get_episodes_impl();
+
+    /**
+     * Remember episode as QObject of a row and write its changes back to
+     * \ref episode_store
+     * @param row 0..get_episode_count()-1
+     * @param episode QObject for this row
+     */
+    void attach_episode(
+        int row, const std::shared_ptr<PodcastEpisode>& episode);
+
+    /**
+     * Emit signals for a merge into \ref episode_store
+     * @param result of EpisodeStore::merge()
      */
-    virtual const std::vector<std::shared_ptr<PodcastEpisode>>&
-    get_episodes_impl() const;
+    void notify_merge(const EpisodeStore::MergeResult& result);
+
+    /**
+     * Apply positions from \ref position_journal to all episodes
+     */
+    void restore_positions();
 
     /**
      * Implementation of \ref get_episode_count()
@@ -445,5 +702,24 @@ private:
      */
     virtual void trigger_image_download();
 };
+
+/**
+ * Estimate the interval until the next refresh of a feed from the
+ * publication dates of its episodes. If the next episode is expected in the
+ * future, the refresh is shortly after the expected release. Overdue feeds
+ * are polled more often, feeds overdue for more than one cadence are
+ * polled less often with each unchanged refresh.
+ * @param publication_dates publication dates of episodes, newest first
+ * @param unchanged_refreshes refreshes without new episodes
+ * @param now current time
+ * @param min_interval lower bound, returned if there are too few dates
+ * @param max_interval upper bound
+ * @return interval in [min_interval, max(min_interval, max_interval)]
+ */
+std::chrono::seconds adaptive_update_interval(
+    const std::vector<QDateTime>& publication_dates, int unchanged_refreshes,
+    const QDateTime& now, std::chrono::seconds min_interval,
+    std::chrono::seconds max_interval);
+
 } // namespace DigitalRooster
 #endif // _PODCASTSOURCE_HPP_
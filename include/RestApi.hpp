@@ -15,11 +15,7 @@
 
 #include <memory>
 
-#include "IAlarmStore.hpp"
-#include "IPodcastStore.hpp"
-#include "IStationStore.hpp"
-#include "ITimeoutStore.hpp"
-#include "IWeatherConfigStore.hpp"
+#include "concurrent_store.hpp"
 
 namespace DigitalRooster {
 namespace REST {
@@ -28,23 +24,16 @@ namespace REST {
 
 /**
  * Interface class around the REST Server
- * glues ConfigurationManager interfaces to REST API
+ * glues ConfigurationManager to REST API, all access from the server threads
+ * goes through \ref ConcurrentStore
  */
 class RestApi {
 public:
 	/**
      * Constructor with all dependencies
-     * @param ws weather storage provider
-     * @param asr alarm storage provider
-     * @param ps  podcast storage provider
-     * @param sts station storage provider
-     * @param tos timeout storage provider
+     * @param store thread safe access to alarms, stations and podcasts
      */
-    RestApi(DigitalRooster::IWeatherConfigStore& ws,
-        DigitalRooster::IAlarmStore& asr,
-        DigitalRooster::IPodcastStore& ps,
-        DigitalRooster::IStationStore& sts,
-        DigitalRooster::ITimeOutStore& tos);
+    explicit RestApi(DigitalRooster::ConcurrentStore& store);
 
     ~RestApi();
     /* do not copy, move or assign */
@@ -14,37 +14,67 @@
 #define _UPDATETASK_HPP_
 
 #include <memory>
-#include <chrono>
 
+#include <QByteArray>
+#include <QFutureWatcher>
 #include <QObject>
 #include <QString>
-#include <QTimer>
 
 #include "httpclient.hpp"
 
 namespace DigitalRooster {
 class PodcastSource;
+class RssStreamParser;
+
 /**
- * Cyclic polling of RSS urls of PodcastSource for updates
+ * Counters of one UpdateTask to see how much conditional requests save
+ */
+struct UpdateStatistics {
+    /**
+     * Number of requests sent
+     */
+    unsigned int requests = 0;
+    /**
+     * Number of complete RSS documents received and parsed
+     */
+    unsigned int downloads = 0;
+    /**
+     * Number of 304 - Not Modified responses (parsing skipped)
+     */
+    unsigned int not_modified = 0;
+    /**
+     * Bytes of RSS documents received
+     */
+    qint64 bytes_downloaded = 0;
+    /**
+     * Estimated bytes not downloaded, size of last document for each 304
+     */
+    qint64 bytes_saved = 0;
+};
+
+/**
+ * Download and parse the RSS feed of a PodcastSource,
+ * refreshes are triggered by RefreshScheduler
  */
 class UpdateTask : public QObject {
     Q_OBJECT
 public:
     explicit UpdateTask(PodcastSource* source = nullptr);
-    virtual ~UpdateTask() = default;
+    virtual ~UpdateTask();
 
     /**
-     * Set the PodcastSourceAutoupdating
-     * will restart the timer
-     * @param interval in seconds
+     * Source to update when started
+     * @param ps
      */
-    void set_update_interval(std::chrono::seconds interval);
+    void set_podcast_source(PodcastSource* ps);
 
     /**
-     * Source to update when timer elapsed
-     * @param ps
+     * Counters for requests, 304 responses and downloaded bytes
+     * @return statistics since construction
      */
-    void set_podcast_source(PodcastSource* ps);
+    const UpdateStatistics& get_statistics() const {
+        return statistics;
+    }
 
 public slots:
     /**
@@ -52,17 +82,63 @@ public slots:
      * @param data content of networkreply
      */
     void dataAvailable(const QByteArray& data);
+
+    /**
+     * Called by HttpClient while downloading, chunk is queued for parsing
+     * on the worker pool
+     * @param chunk next part of RSS document
+     */
+    void chunkAvailable(const QByteArray& chunk);
+
+    /**
+     * Called by HttpClient when the streaming download has ended
+     * @param success download completed
+     */
+    void streamFinished(bool success);
+
+    /**
+     * Called by HttpClient if the feed did not change since last download
+     */
+    void notModified();
+
+    /**
+     * Called by HttpClient with cache validators before data is available
+     * @param etag ETag header value
+     * @param last_modified Last-Modified header value
+     */
+    void validatorsAvailable(
+        const QByteArray& etag, const QByteArray& last_modified);
+
     /**
-     * Starts download and parsing
+     * Parse job on the worker pool has finished, new episodes are added to
+     * the PodcastSource in one batch and the next job is started
+     */
+    void parseFinished();
+
+    /**
+     * Starts download and parsing, sends a conditional request if the
+     * PodcastSource knows ETag or Last-Modified of the last download.
+     * A download still in progress is aborted.
      */
     void start();
 
+    /**
+     * Stop download and parsing in progress without emitting finished()
+     */
+    void abort();
+
 signals:
     /**
      * Download and parsing has completed
      */
     void dataChanged();
 
+    /**
+     * Refresh started with \ref start has ended
+     * @param success feed was parsed completely or has not been modified
+     */
+    void finished(bool success);
+
 private:
     /**
      * podcast source to update
@@ -75,9 +151,85 @@ private:
     HttpClient dlm;
 
     /**
-     * Periodic timer for update action
+     * Validators of current response, only stored in PodcastSource
+     * after the document was parsed successfully
+     */
+    QByteArray response_etag;
+    QByteArray response_last_modified;
+
+    /**
+     * Size of last complete RSS document to estimate savings
+     */
+    qint64 last_document_size = 0;
+
+    /**
+     * Bytes received of the current download
+     */
+    qint64 current_document_size = 0;
+
+    /**
+     * Parser of the current download, episodes are added while downloading
+     */
+    std::shared_ptr<RssStreamParser> parser;
+
+    /**
+     * Parser the running job works on, may be an outdated parser if the
+     * download was restarted
+     */
+    std::shared_ptr<RssStreamParser> job_parser;
+
+    /**
+     * Chunks received while a parse job was running
+     */
+    QByteArray pending_data;
+
+    /**
+     * Download of current parser has ended
+     */
+    bool stream_ended = false;
+
+    /**
+     * Download of current parser has completed successfully
+     */
+    bool stream_complete = false;
+
+    /**
+     * Number of new items applied to the PodcastSource in current refresh
+     */
+    size_t new_items = 0;
+
+    /**
+     * Watches the parse job running on the worker pool
+     */
+    QFutureWatcher<void> parse_watcher;
+
+    /**
+     * Request and download counters
+     */
+    UpdateStatistics statistics;
+
+    /**
+     * Keep validators of the response if the document was parsed
+     * @param complete document was parsed without errors
+     */
+    void store_validators(bool complete);
+
+    /**
+     * Start a parse job for pending data if no job is running or finish
+     * the update if all data has been parsed
+     */
+    void schedule_parse();
+
+    /**
+     * All data of the download has been parsed, check document and
+     * update validators
+     */
+    void finish_update();
+
+    /**
+     * Drop parser, queued data and stream state of current download
      */
-    QTimer timer;
+    void reset_parser();
 };
 
 } /* namespace DigitalRooster */
@@ -56,6 +56,20 @@ public:
      */
     std::shared_ptr<DigitalRooster::Alarm> get_upcoming_alarm();
 
+    /**
+     * Time \ref alarm_pending is emitted before the alarm is due
+     * emits \ref prewarm_time_changed
+     * @param lead time, 0 disables alarm_pending
+     */
+    void set_prewarm_time(std::chrono::milliseconds lead);
+
+    /**
+     * Time \ref alarm_pending is emitted before the alarm is due
+     */
+    std::chrono::milliseconds get_prewarm_time() const {
+        return prewarm_time;
+    }
+
 public slots:
     /**
      * Will update upcoming alarm and schedule a timer
@@ -69,6 +83,18 @@ signals:
      */
     void alarm_triggered(DigitalRooster::Alarm*  alarm);
 
+    /**
+     * Alarm is due in \ref prewarm_time, time to prepare its media
+     * @param alarm upcoming alarm
+     */
+    void alarm_pending(DigitalRooster::Alarm* alarm);
+
+    /**
+     * Time \ref alarm_pending is emitted before the alarm changed
+     * @param lead new prewarm time
+     */
+    void prewarm_time_changed(std::chrono::milliseconds lead);
+
     /**
      * Upcoming alarm has changed
      * @param info - new display string
@@ -91,6 +117,16 @@ private:
      */
     QTimer timer;
 
+    /**
+     * Timer to emit alarm_pending ahead of upcoming alarm
+     */
+    QTimer prewarm_timer;
+
+    /**
+     * Time alarm_pending is emitted before the alarm
+     */
+    std::chrono::milliseconds prewarm_time;
+
     /**
      * Convenience method to dispatch alarm to receivers
      * @param alarm to dispatch
@@ -102,6 +138,11 @@ private slots:
      * Adapter slot to call dispatch(alarm) with upcoming_alarm
      */
     void trigger();
+
+    /**
+     * Adapter slot to emit alarm_pending with upcoming_alarm
+     */
+    void prewarm();
 };
 } // namespace DigitalRooster
 
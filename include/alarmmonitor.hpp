@@ -13,16 +13,20 @@
 #ifndef INCLUDE_ALARMMONITOR_HPP_
 #define INCLUDE_ALARMMONITOR_HPP_
 
+#include <QMediaPlayer>
 #include <QMediaPlaylist>
 #include <QObject>
 #include <QTimer>
+#include <QUuid>
 
 #include <chrono>
 #include <memory>
+#include <vector>
 
 namespace DigitalRooster {
 class MediaPlayer;
 class Alarm;
+class PlayableItem;
 
 /**
  * Supervision of alarm behavior. Makes sure I wake up even if the original
@@ -36,6 +40,7 @@ public:
      */
     enum MonitorState {
         Idle,           //!< idle, no alarm playing
+        PreArmed,       //!< alarm media is buffered silently before alarm
         Armed, 			//!< alarm should be playing soon
         FallBackMode    //!< alarm failed to start, playing fall back
     };
@@ -60,6 +65,29 @@ public:
         return state;
     };
 
+    /**
+     * Sources tried in order if the alarm media fails while pre-buffering,
+     * the fallback sound plays if none of them works
+     * @param sources alternative media, e.g. radio stations
+     */
+    void set_alternative_sources(
+        const std::vector<std::shared_ptr<PlayableItem>>& sources);
+
+    /**
+     * Time from the alarm being due until the player was playing
+     * @return latency of last alarm, -1 if no alarm has started yet
+     */
+    std::chrono::milliseconds get_start_latency() const {
+        return start_latency;
+    }
+
+    /**
+     * Pre-arming is abandoned if the alarm did not trigger within the
+     * pre-warm time and \ref ALARM_PREWARM_DEADLINE after alarm_pending
+     * @param lead same as AlarmDispatcher::get_prewarm_time()
+     */
+    void set_prewarm_time(std::chrono::milliseconds lead);
+
 public slots:
     /**
      * Monitor the trigged alarm if it has started in due time
@@ -67,6 +95,13 @@ public slots:
      */
     void alarm_triggered(const DigitalRooster::Alarm* alarm);
 
+    /**
+     * Connect to the media of an upcoming alarm and buffer it muted,
+     * ignored if the player is already playing
+     * @param alarm alarm that is due soon
+     */
+    void alarm_pending(const DigitalRooster::Alarm* alarm);
+
     /**
      * Do not trigger fallback behavior even if error occurs.
      */
@@ -100,12 +135,96 @@ private:
      */
     MonitorState state = Idle;
 
+    /**
+     * Alternatives for the alarm media in order of preference
+     */
+    std::vector<std::shared_ptr<PlayableItem>> alternatives;
+
+    /**
+     * Media tried while \ref PreArmed, alarm media followed by alternatives
+     */
+    std::vector<std::shared_ptr<PlayableItem>> candidates;
+
+    /**
+     * Index in \ref candidates being buffered
+     */
+    size_t candidate = 0;
+
+    /**
+     * Current candidate reached playing state and is paused
+     */
+    bool prewarmed = false;
+
+    /**
+     * Media of the player is changed for pre-arming, any other media
+     * change while \ref PreArmed comes from the user
+     */
+    bool switching_media = false;
+
+    /**
+     * Alarm that is pre-armed
+     */
+    QUuid pending_alarm;
+
+    /**
+     * Current candidate has to play within \ref ALARM_PREWARM_DEADLINE,
+     * a pre-buffered alarm within \ref ALARM_START_DEADLINE once due
+     */
+    QTimer deadline_timer;
+
+    /**
+     * Abandons pre-arming if the alarm was removed or rescheduled
+     */
+    QTimer prearm_expiry_timer;
+
+    /**
+     * Time the last alarm was due
+     */
+    std::chrono::steady_clock::time_point triggered_at;
+
+    /**
+     * Waiting for first playing state since alarm was due
+     */
+    bool measuring = false;
+
+    /**
+     * Latency of last alarm start
+     */
+    std::chrono::milliseconds start_latency{-1};
+
     /**
      * update \ref AlarmMonitor::state and emit state_changed
      * @param next_state next state
      */
     void set_state(MonitorState next_state);
 
+    /**
+     * Buffer \ref candidate muted, fallback sound if none is left
+     */
+    void prewarm_candidate();
+
+    /**
+     * Current candidate failed, try next one
+     */
+    void prewarm_next();
+
+    /**
+     * Stop pre-buffering and unmute player
+     */
+    void cancel_prearm();
+
+    /**
+     * The user started playback while \ref PreArmed, unmute and leave
+     * the player to the user, the alarm starts without pre-buffering
+     */
+    void release_player();
+
+    /**
+     * Player state changed, pauses pre-buffered media and records latency
+     * @param player_state new state
+     */
+    void playback_state_changed(QMediaPlayer::State player_state);
+
 private slots:
 
     /**
@@ -43,6 +43,11 @@ const QString KEY_GROUP_PODCAST_SOURCES("Podcasts");
  */
 const QString KEY_MAX_EPISODES("maxEpisodes");
 
+/**
+ * Number of latest episodes of a podcast kept for offline playback
+ */
+const QString KEY_OFFLINE_EPISODES("offlineEpisodes");
+
 /**
  * key for array of individual Podcast Episode objects
  */
@@ -127,6 +132,21 @@ const QString KEY_ALARM_DAILY("daily");
  */
 const QString KEY_UPDATE_INTERVAL("updateInterval");
 
+/**
+ * property keyword for upper bound of adaptive refresh interval
+ */
+const QString KEY_MAX_UPDATE_INTERVAL("maxUpdateInterval");
+
+/**
+ * key for refresh interval learned from publication dates
+ */
+const QString KEY_LEARNED_UPDATE_INTERVAL("learnedUpdateInterval");
+
+/**
+ * key for number of refreshes without new episodes
+ */
+const QString KEY_UNCHANGED_REFRESHES("unchangedRefreshes");
+
 /**
  * property keyword for alarms timeout
  */
@@ -207,6 +227,16 @@ const QString JSON_KEY_TITLE("title");
  */
 const QString KEY_TIMESTAMP("timestamp");
 
+/**
+ * key for HTTP ETag of last downloaded RSS feed
+ */
+const QString KEY_HTTP_ETAG("etag");
+
+/**
+ * key for HTTP Last-Modified header of last downloaded RSS feed
+ */
+const QString KEY_HTTP_LAST_MODIFIED("lastModified");
+
 /**
  * key for wpa control interface socket
  */
@@ -217,11 +247,141 @@ const QString KEY_WPA_SOCKET_NAME("wpa_ctrl");
  */
 const QString KEY_WIFI_DEV_NAME("net_dev");
 
+/**
+ * key for hash of the JSON file a binary snapshot was created from
+ */
+const QString KEY_SNAPSHOT_SOURCE("source");
+
+/**
+ * key for configuration object in binary snapshot
+ */
+const QString KEY_SNAPSHOT_CONFIG("config");
+
+/**
+ * File suffix of binary configuration snapshot, appended to config file path
+ */
+const QString CONFIG_SNAPSHOT_SUFFIX(".cbor");
+
+/**
+ * Layout version of binary configuration snapshot,
+ * snapshots with a different version are ignored
+ */
+const int CONFIG_SNAPSHOT_VERSION = 1;
+
+/**
+ * Layout version of binary podcast cache files, files with a different
+ * version are ignored and the feed is downloaded again
+ * (version 1 without description summaries is still read)
+ */
+const quint32 PODCAST_CACHE_VERSION = 2;
+
+/**
+ * Maximum characters of plain text description shown in lists
+ */
+const int DESCRIPTION_SUMMARY_LENGTH = 300;
+
+/**
+ * File suffix of settings journal, appended to config file path
+ */
+const QString CONFIG_JOURNAL_SUFFIX(".journal");
+
+/**
+ * Number of journal records after which the journal is merged into the
+ * configuration file
+ */
+const int CONFIG_JOURNAL_MAX_RECORDS = 120;
+
+/**
+ * Changed podcast sources are collected for this duration and their cache
+ * files are written together
+ */
+const std::chrono::milliseconds CACHE_WRITE_DELAY(1000);
+
+/**
+ * File name of playback position journal in cache directory
+ */
+const QString POSITION_JOURNAL_FILE_NAME("positions.journal");
+
+/**
+ * Layout version of playback position journal, journals with a different
+ * version are discarded
+ */
+const quint32 POSITION_JOURNAL_VERSION = 1;
+
+/**
+ * Changed playback positions are written at the latest after this interval
+ */
+const std::chrono::milliseconds POSITION_JOURNAL_INTERVAL(30 * 1000);
+
+/**
+ * Number of episodes in position journal, positions of the episodes
+ * played longest ago are dropped
+ */
+const int POSITION_JOURNAL_MAX_ENTRIES = 2000;
+
 /**
  * Directory for all downloaded RSS Files
  */
 const QString RSS_FILE_DIR(QDir::tempPath());
 
+/**
+ * Maximum size of buffered data when RSS feeds are parsed while downloading
+ */
+const qint64 RSS_STREAM_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * Number of threads for RSS parsing and podcast cache I/O
+ */
+const int WORKER_POOL_MAX_THREADS = 2;
+
+/**
+ * Maximum number of podcast feeds downloaded at the same time
+ */
+const int FEED_REFRESH_MAX_CONCURRENT = 2;
+
+/**
+ * Feed refreshes are delayed by a random time up to this value so
+ * feeds don't download at the same time after boot
+ */
+const std::chrono::milliseconds FEED_REFRESH_JITTER(60 * 1000);
+
+/**
+ * First retry delay after a failed feed download, doubled for each
+ * consecutive failure of the same host
+ */
+const std::chrono::seconds FEED_REFRESH_BACKOFF_MIN(60);
+
+/**
+ * Upper limit of retry delay for failing hosts
+ */
+const std::chrono::seconds FEED_REFRESH_BACKOFF_MAX(4 * 3600);
+
+/**
+ * Feed refresh without result after this time is considered failed
+ */
+const std::chrono::seconds FEED_REFRESH_TIMEOUT(300);
+
+/**
+ * Default refresh interval of podcast feeds, lower bound of the adaptive
+ * refresh interval
+ */
+const std::chrono::seconds DEFAULT_UPDATE_INTERVAL(3600);
+
+/**
+ * Default upper bound of the adaptive refresh interval
+ */
+const std::chrono::seconds DEFAULT_MAX_UPDATE_INTERVAL(24 * 3600);
+
+/**
+ * Poll this long after the expected release of the next episode
+ */
+const std::chrono::seconds FEED_RELEASE_GRACE(15 * 60);
+
+/**
+ * Number of most recent publication dates to estimate the cadence of a feed
+ */
+const int FEED_CADENCE_SAMPLES = 10;
+
 /**
  * Minimum percentage of Podcast episode played to be considered 'listened'
  */
@@ -233,6 +393,29 @@ const int MIN_LISTENED_PERC = 25;
  */
 const std::chrono::minutes DEFAULT_ALARM_TIMEOUT(30);
 
+/**
+ * Changes of podcast sources within this time are published in one
+ * configuration snapshot for the REST API
+ */
+const std::chrono::milliseconds SNAPSHOT_REFRESH_DELAY(200);
+
+/**
+ * Alarm media is connected and buffered silently this time before the alarm
+ */
+const std::chrono::milliseconds ALARM_PREWARM_TIME(20000);
+
+/**
+ * Time a pre-buffered alarm source has to start playing before the next
+ * alternative source is tried
+ */
+const std::chrono::milliseconds ALARM_PREWARM_DEADLINE(8000);
+
+/**
+ * Time a pre-buffered alarm has to start playing when it is due before the
+ * fallback sound plays
+ */
+const std::chrono::milliseconds ALARM_START_DEADLINE(3000);
+
 /**
  * Time after which media should stop playing
  * (probably because I am already asleep)
@@ -244,6 +427,12 @@ const std::chrono::minutes DEFAULT_SLEEP_TIMEOUT(60);
  */
 const std::chrono::milliseconds ALS_SAMPLING_PERIOD(300);
 
+/**
+ * Quiet period after the last change of the configuration file before it is
+ * reloaded (editors tend to emit several change events for one save)
+ */
+const std::chrono::milliseconds CONFIG_RELOAD_DELAY(500);
+
 /**
  * Default output volume
  */
@@ -270,6 +459,91 @@ const int DEFAULT_BRIGHTNESS = 25;
  */
 const int DEFAULT_ICON_WIDTH = 88;
 
+/**
+ * Maximum total size of podcast icons in cache directory, icons used
+ * longest ago are removed
+ */
+const qint64 ICON_CACHE_MAX_BYTES = 2 * 1024 * 1024;
+
+/**
+ * QML image provider for cached icons, image://icons/<key>
+ */
+const QString ICON_PROVIDER_ID("icons");
+
+/**
+ * Subdirectory of the application cache directory for HTTP responses
+ */
+const QString HTTP_CACHE_DIR_NAME("http");
+
+/**
+ * Maximum size of HTTP responses cached on disk
+ */
+const qint64 HTTP_CACHE_MAX_BYTES = 10 * 1024 * 1024;
+
+/**
+ * HTTP download fails if no response headers were received in this time
+ */
+const std::chrono::milliseconds HTTP_CONNECT_TIMEOUT(15 * 1000);
+
+/**
+ * HTTP download fails if no data was received for this time
+ */
+const std::chrono::milliseconds HTTP_TRANSFER_TIMEOUT(30 * 1000);
+
+/**
+ * Retries of an HTTP download after timeouts, network or server errors
+ */
+const int HTTP_MAX_RETRIES = 2;
+
+/**
+ * Delay of first retry, doubled for each following retry
+ */
+const std::chrono::milliseconds HTTP_RETRY_BACKOFF(2 * 1000);
+
+/**
+ * Consecutive failures of a host until its circuit breaker opens
+ */
+const int HTTP_CIRCUIT_FAILURES = 5;
+
+/**
+ * Requests to a host with open circuit breaker fail immediately for
+ * this time, afterwards requests are sent again
+ */
+const std::chrono::milliseconds HTTP_CIRCUIT_OPEN_TIME(5 * 60 * 1000);
+
+/**
+ * Background downloads running at the same time while media is playing,
+ * further requests wait so the stream is not starved on a weak link
+ */
+const int HTTP_BACKGROUND_LIMIT_PLAYING = 1;
+
+/**
+ * Running background downloads read one RSS_STREAM_CHUNK_SIZE per interval
+ * while media is playing, the network layer stops receiving in between
+ */
+const std::chrono::milliseconds HTTP_BACKGROUND_READ_INTERVAL(2 * 1000);
+
+/**
+ * Subdirectory of the application cache directory for downloaded episodes
+ */
+const QString EPISODE_DOWNLOAD_DIR_NAME("episodes");
+
+/**
+ * Maximum total size of downloaded episodes, episodes downloaded longest
+ * ago are removed
+ */
+const qint64 EPISODE_DOWNLOAD_QUOTA = 512 * 1024 * 1024;
+
+/**
+ * An interrupted episode download is resumed after this delay
+ */
+const std::chrono::milliseconds EPISODE_DOWNLOAD_RESUME_DELAY(60 * 1000);
+
+/**
+ * Resumes of an interrupted episode download before it is given up
+ */
+const int EPISODE_DOWNLOAD_MAX_RESUMES = 5;
+
 /**
  * number of forecasts to fetch
  * 8*3h =  24h
@@ -286,6 +560,11 @@ const double VOLUME_INCREMENT = 0.5;
  */
 const unsigned int DEFAULT_MAX_EPISODES = 100;
 
+/**
+ * Default number of latest episodes downloaded for offline playback
+ */
+const int DEFAULT_OFFLINE_EPISODES = 0;
+
 /**
  * Where to find icons for weather condition
  */
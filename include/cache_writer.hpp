@@ -0,0 +1,196 @@
+/******************************************************************************
+ * \filename
+ * \brief Write-behind of podcast cache files for all podcast sources
+ *
+ * \details Podcast sources that changed are collected and written together
+ *          when the delay of the first change has expired. Snapshots are
+ *          taken on the GUI thread, files are written one after the other
+ *          on a dedicated background thread.
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_CACHE_WRITER_HPP_
+#define INCLUDE_CACHE_WRITER_HPP_
+
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+
+#include "appconstants.hpp"
+#include "episode_cache.hpp"
+
+namespace DigitalRooster {
+class PodcastSerializer;
+
+/**
+ * Batches cache writes of all \ref PodcastSerializer instances
+ */
+class CacheWriter : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * Constructor
+     * @param delay sources are written at the latest after delay
+     * @param parent QObject
+     */
+    explicit CacheWriter(
+        std::chrono::milliseconds delay = CACHE_WRITE_DELAY,
+        QObject* parent = nullptr);
+
+    /**
+     * Waits for running writes, dirty sources have to be flushed before
+     */
+    ~CacheWriter();
+    CacheWriter(const CacheWriter&) = delete;
+    CacheWriter(CacheWriter&&) = delete;
+    CacheWriter& operator=(const CacheWriter&) = delete;
+    CacheWriter& operator=(CacheWriter&&) = delete;
+
+    /**
+     * Remember serializer of a changed source, its snapshot is taken with
+     * the next batch
+     * @param serializer calls PodcastSerializer::write() for the batch
+     */
+    void schedule(PodcastSerializer* serializer);
+
+    /**
+     * Forget serializer, e.g. if it is destroyed
+     * @param serializer previously scheduled
+     */
+    void cancel(PodcastSerializer* serializer);
+
+    /**
+     * Queue a snapshot for writing on the background thread, a queued
+     * snapshot of the same file that was not yet written is replaced
+     * @param file_path cache file
+     * @param cache snapshot of podcast source
+     */
+    void submit(const QString& file_path, PodcastCache cache);
+
+    /**
+     * Remove a queued snapshot and wait until a running write finished,
+     * e.g. before the file is deleted
+     * @param file_path cache file
+     */
+    void discard(const QString& file_path);
+
+    /**
+     * Block until all queued snapshots are written
+     */
+    void wait();
+
+    /**
+     * Number of sources waiting for the next batch
+     */
+    int dirty_sources() const {
+        return dirty.size();
+    }
+
+    /**
+     * Number of snapshots queued or being written
+     */
+    int pending_writes() const {
+        return pending;
+    }
+
+    /**
+     * Number of cache files written
+     */
+    int files_written() const {
+        return files;
+    }
+
+    /**
+     * Sum of all cache file sizes written
+     */
+    qint64 bytes_written() const {
+        return bytes;
+    }
+
+public slots:
+    /**
+     * Take snapshots of all dirty sources now and block until all files
+     * are written, e.g. before standby or shutdown
+     */
+    void flush();
+
+private:
+    /**
+     * Serializers of sources changed since last batch
+     */
+    QSet<PodcastSerializer*> dirty;
+
+    /**
+     * Single shot timer started by the first change of a batch
+     */
+    QTimer batch_timer;
+
+    /**
+     * One thread, files are written one after the other
+     */
+    QThreadPool io_thread;
+
+    /**
+     * Protects \ref queue, \ref queued, \ref writing and \ref draining
+     */
+    QMutex mutex;
+
+    /**
+     * Files in order of submission
+     */
+    std::deque<QString> queue;
+
+    /**
+     * Latest snapshot of each file in \ref queue
+     */
+    QHash<QString, PodcastCache> queued;
+
+    /**
+     * File currently written on \ref io_thread
+     */
+    QString writing;
+
+    /**
+     * A task is writing \ref queue on \ref io_thread
+     */
+    bool draining = false;
+
+    /**
+     * Running task, only accessed on the thread of the CacheWriter
+     */
+    QFuture<void> drain_task;
+
+    /**
+     * Statistics
+     */
+    std::atomic<int> pending{0};
+    std::atomic<int> files{0};
+    std::atomic<qint64> bytes{0};
+
+    /**
+     * Take snapshots of all dirty sources
+     */
+    void write_batch();
+
+    /**
+     * Write queued snapshots until the queue is empty, runs on \ref io_thread
+     */
+    void drain();
+};
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_CACHE_WRITER_HPP_ */
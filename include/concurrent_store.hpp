@@ -0,0 +1,206 @@
+/******************************************************************************
+ * \filename
+ * \brief Thread safe access to configuration items for non Qt threads
+ *
+ * \details Readers get an immutable snapshot of alarms, stations and podcasts
+ *          mutations are executed on the thread of the Configuration
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_CONCURRENT_STORE_HPP_
+#define INCLUDE_CONCURRENT_STORE_HPP_
+
+#include <QJsonObject>
+#include <QObject>
+#include <QTimer>
+#include <QUuid>
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace DigitalRooster {
+// forward decl
+class Configuration;
+
+/**
+ * Immutable copy of configuration items in JSON representation
+ */
+struct StoreSnapshot {
+    /**
+     * Incremented for each new snapshot
+     */
+    quint64 generation = 0;
+    /**
+     * Alarm::to_json_object() of all alarms
+     */
+    std::vector<QJsonObject> alarms;
+    /**
+     * PlayableItem::to_json_object() of all radio stations
+     */
+    std::vector<QJsonObject> stations;
+    /**
+     * PodcastSource::to_json_object() of all podcast sources
+     */
+    std::vector<QJsonObject> podcasts;
+};
+
+/**
+ * Find item with id in a snapshot collection
+ * @throws std::out_of_range if not found
+ * @param items e.g. StoreSnapshot::alarms
+ * @param id unique id of item
+ * @return JSON representation of item
+ */
+const QJsonObject& find_json_by_id(
+    const std::vector<QJsonObject>& items, const QUuid& id);
+
+/**
+ * Progress of a change posted to the thread of the configuration
+ */
+enum class StoreChangeState {
+    Pending,  //!< queued, not yet started
+    Running,  //!< started, will be applied
+    Cancelled //!< cancelled before it started, will never be applied
+};
+
+/**
+ * Change of the configuration executed on the thread of the configuration
+ */
+template <typename T> struct StoreChange {
+    /**
+     * Result or exception of the change, a cancelled change delivers
+     * std::future_error (broken_promise)
+     */
+    std::future<T> result;
+
+    /**
+     * Shared with the queued task
+     */
+    std::shared_ptr<std::atomic<StoreChangeState>> state;
+
+    /**
+     * Cancel the change if it did not start yet
+     * @return true if the change will never be applied,
+     *         false if it already started - the result follows
+     */
+    bool cancel() {
+        auto expected = StoreChangeState::Pending;
+        return state->compare_exchange_strong(
+            expected, StoreChangeState::Cancelled);
+    }
+};
+
+/**
+ * Access to Configuration from threads without Qt event loop (REST server)
+ * Reads never touch the live objects, they return a snapshot that is
+ * replaced (not modified) on the Qt thread whenever the configuration changes.
+ * Mutations are posted to the Qt thread, the result or exception is
+ * delivered through the std::future of a StoreChange. Waiting on the future
+ * on the Qt thread is not necessary, calls from the Qt thread are executed
+ * immediately.
+ */
+class ConcurrentStore : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * Constructor, must be called on the thread of the configuration
+     * @param cfg configuration to access
+     * @param parent owning QObject
+     */
+    explicit ConcurrentStore(Configuration& cfg, QObject* parent = nullptr);
+
+    /**
+     * Current snapshot - can be called from any thread
+     * @return immutable snapshot, valid as long as the caller holds it
+     */
+    std::shared_ptr<const StoreSnapshot> get_snapshot() const;
+
+    /**
+     * Create alarm from JSON and add it to configuration
+     * @param json alarm JSON representation
+     * @return id of new alarm, std::invalid_argument for bad JSON
+     */
+    StoreChange<QUuid> add_alarm(const QJsonObject& json);
+
+    /**
+     * Delete alarm
+     * @param id of alarm
+     * @return std::out_of_range if no alarm with id exists
+     */
+    StoreChange<void> delete_alarm(const QUuid& id);
+
+    /**
+     * Create radio station from JSON and add it to configuration
+     * @param json station JSON representation
+     * @return id of new station, std::invalid_argument for bad JSON
+     */
+    StoreChange<QUuid> add_radio_station(const QJsonObject& json);
+
+    /**
+     * Delete radio station
+     * @param id of station
+     * @return std::out_of_range if no station with id exists
+     */
+    StoreChange<void> delete_radio_station(const QUuid& id);
+
+    /**
+     * Create podcast source from JSON and add it to configuration
+     * @param json podcast source JSON representation
+     * @return id of new podcast source, std::invalid_argument for bad JSON
+     */
+    StoreChange<QUuid> add_podcast_source(const QJsonObject& json);
+
+    /**
+     * Delete podcast source
+     * @param id of podcast source
+     * @return std::out_of_range if no podcast source with id exists
+     */
+    StoreChange<void> delete_podcast_source(const QUuid& id);
+
+public slots:
+    /**
+     * Publish a new snapshot of the current configuration
+     */
+    void refresh_snapshot();
+
+private:
+    /**
+     * Configuration all mutations are forwarded to
+     */
+    Configuration& config;
+
+    /**
+     * Current snapshot, only accessed through std::atomic_load/atomic_store
+     */
+    std::shared_ptr<const StoreSnapshot> snapshot;
+
+    /**
+     * Generation of next snapshot
+     */
+    quint64 generation = 0;
+
+    /**
+     * Coalesces changes of podcast sources into one refresh
+     */
+    QTimer refresh_timer;
+
+    /**
+     * Execute fn on the thread of this object and refresh snapshot
+     * fn is skipped if the change was cancelled before it started
+     * @param fn mutation of configuration
+     * @return result of fn or exception thrown by fn
+     */
+    template <typename T>
+    StoreChange<T> run_on_store_thread(std::function<T()> fn);
+};
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_CONCURRENT_STORE_HPP_ */
@@ -13,6 +13,8 @@
 #define _CONFIGURATION_MANAGER_H_
 
 #include <QFileSystemWatcher>
+#include <QJsonObject>
+#include <QJsonValue>
 #include <QObject>
 #include <QString>
 #include <QTimer>
@@ -23,6 +25,9 @@
 #include <vector>
 
 #include "appconstants.hpp"
+#include "cache_writer.hpp"
+#include "episode_downloader.hpp"
+#include "position_journal.hpp"
 /* Implemented Interfaces */
 #include "IAlarmStore.hpp"
 #include "IBrightnessStore.hpp"
@@ -35,6 +40,7 @@ namespace DigitalRooster {
 // forward decl
 class PlayableItem;
 class PodcastSource;
+struct PodcastCache;
 class Alarm;
 
 /**
@@ -64,7 +70,10 @@ public:
      */
     Configuration(const QString& configpath, const QString& cachedir);
 
-    virtual ~Configuration() = default;
+    /**
+     * Writes changed configuration or flushes pending settings to journal
+     */
+    virtual ~Configuration();
 
     /**
      * return compile time version string
@@ -166,6 +175,30 @@ public:
         return get_cache_dir_name();
     };
 
+    /**
+     * Playback positions of all podcast episodes
+     * @return journal in cache directory
+     */
+    std::shared_ptr<PositionJournal> get_position_journal() const {
+        return position_journal;
+    }
+
+    /**
+     * Write-behind of all podcast cache files
+     * @return writer used by all podcast sources
+     */
+    std::shared_ptr<CacheWriter> get_cache_writer() const {
+        return cache_writer;
+    }
+
+    /**
+     * Offline copies of podcast episodes
+     * @return downloader for all podcast sources
+     */
+    std::shared_ptr<EpisodeDownloader> get_episode_downloader() const {
+        return episode_downloader;
+    }
+
 public slots:
     /**
      * Any Item (Alarm, PodcastSource...) changed
@@ -207,6 +240,7 @@ public slots:
      * The monitored file has changed -
      * adapter function since QFilesytemwatcher
      * emits fileChanged(const QString &path)
+     * restarts \ref reload_timer, the file is read once it settled
      */
     void fileChanged(const QString& path);
 
@@ -287,6 +321,12 @@ private:
      */
     QMetaObject::Connection fwConn;
 
+    /**
+     * Single shot timer to collapse bursts of fileChanged events
+     * into one reload
+     */
+    QTimer reload_timer;
+
     /**
      * Weather configuration
      */
@@ -302,6 +342,21 @@ private:
      */
     QDir application_cache_dir;
 
+    /**
+     * Playback positions of podcast episodes, shared by all podcast sources
+     */
+    std::shared_ptr<PositionJournal> position_journal;
+
+    /**
+     * Batches cache file writes of all podcast sources
+     */
+    std::shared_ptr<CacheWriter> cache_writer;
+
+    /**
+     * Downloads episodes to the cache directory
+     */
+    std::shared_ptr<EpisodeDownloader> episode_downloader;
+
     /**
      * Timer Id for writing data
      * assigned by \ref QObject::startTimer()
@@ -315,6 +370,17 @@ private:
      */
     std::atomic<bool> dirty{false};
 
+    /**
+     * Changed scalar settings (volume, brightness...) not yet appended
+     * to the journal
+     */
+    QJsonObject pending_settings;
+
+    /**
+     * Number of records in journal since last write of configuration file
+     */
+    int journal_records = 0;
+
     /**
      * WPA control socket path /var/lib/wpa_supplicant/wlan0
      */
@@ -339,9 +405,9 @@ private:
     void create_default_configuration();
 
     /**
-     * read file and return content as string
+     * read file and return raw content
      */
-    virtual QString get_json_from_file(const QString& path);
+    virtual QByteArray get_json_from_file(const QString& path);
 
     /**
      * Application wide cache dir, set by command line parameter
@@ -352,10 +418,36 @@ private:
     virtual QString get_cache_dir_name();
 
     /**
-     * interpret json string
+     * interpret json string and update the binary snapshot
      */
     virtual void parse_json(const QByteArray& json);
 
+    /**
+     * Update all configuration items from parsed configuration
+     * @param appconfig configuration object (from JSON or snapshot)
+     */
+    void read_configuration(const QJsonObject& appconfig);
+
+    /**
+     * Path of binary configuration snapshot next to configuration file
+     * @return get_configuration_path() + CONFIG_SNAPSHOT_SUFFIX
+     */
+    QString get_snapshot_path() const;
+
+    /**
+     * Read binary snapshot if it was created from the same JSON content
+     * @param json current content of configuration file
+     * @return configuration object, empty if snapshot is missing or stale
+     */
+    QJsonObject read_snapshot(const QByteArray& json) const;
+
+    /**
+     * Write binary snapshot of configuration
+     * @param appconfig configuration object
+     * @param json content of configuration file appconfig was created from
+     */
+    void write_snapshot(const QJsonObject& appconfig, const QByteArray& json);
+
     /**
      * Fills the vector stream_sources
      */
@@ -376,13 +468,81 @@ private:
      */
     virtual void read_weather(const QJsonObject& appconfig);
 
+    /**
+     * Create a new podcast source with serializer, the cache is restored
+     * by \ref restore_podcast_sources
+     * @throws invalid_argument if JSON is incomplete
+     * @param json configuration object of podcast source
+     * @return podcast source without update task
+     */
+    std::shared_ptr<PodcastSource> create_podcast_source(
+        const QJsonObject& json);
+
+    /**
+     * Give a podcast source its serializer, position journal and episode
+     * downloader and forward its dataChanged()
+     * @param ps new podcast source read from file or added by a client
+     */
+    void setup_podcast_source(const std::shared_ptr<PodcastSource>& ps);
+
+    /**
+     * Read cache files of new podcast sources in parallel on the worker
+     * pool, each source is restored on this thread when its read finished.
+     * podcast_sources_changed() is emitted once all sources are restored.
+     * @param sources podcast sources created by \ref create_podcast_source
+     */
+    void restore_podcast_sources(
+        const std::vector<std::shared_ptr<PodcastSource>>& sources);
+
+    /**
+     * Restore podcast source from cache read on the worker pool and give it
+     * an UpdateTask
+     * @param cache content of cache file, empty if not readable
+     * @param ps podcast source to restore
+     */
+    void apply_podcast_cache(
+        const PodcastCache& cache, const std::shared_ptr<PodcastSource>& ps);
+
+    /**
+     * All podcast sources of one \ref restore_podcast_sources are restored,
+     * sort them by restored title and announce the change
+     */
+    void podcast_sources_restored();
+
     /**
      * Store settings permanently to file
      */
     void write_config_file(const QJsonObject& appconfig);
 
+    /**
+     * Path of settings journal next to configuration file
+     * @return get_configuration_path() + CONFIG_JOURNAL_SUFFIX
+     */
+    QString get_journal_path() const;
+
+    /**
+     * Remember a changed scalar setting for the journal
+     * instead of rewriting the whole configuration file
+     * @param key configuration key e.g. KEY_VOLUME
+     * @param value new value
+     */
+    void journal_setting(const QString& key, const QJsonValue& value);
+
+    /**
+     * Append pending settings as one record to the journal
+     */
+    void append_journal();
+
+    /**
+     * Apply all records of the journal on top of configuration file,
+     * the journal is discarded if the file was edited after it
+     */
+    void replay_journal();
+
     /**
      * Update all configuration items
+     * Items that already exist (same id) are updated in place, items no
+     * longer in the file are removed
      */
     void refresh_configuration();
 
@@ -411,6 +571,11 @@ private slots:
      * catch all slot if any data of an alarm has changed
      */
     void alarm_data_changed();
+
+    /**
+     * configuration file settled after a change, read it again
+     */
+    void reload_configuration();
 };
 
 /**
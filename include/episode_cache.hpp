@@ -0,0 +1,179 @@
+/******************************************************************************
+ * \filename
+ * \brief Compact binary cache file of a podcast source and its episodes
+ *
+ * \details The file is memory mapped, episode descriptions are only decoded
+ *          when they are displayed. JSON cache files of older versions are
+ *          read for migration, the next write converts them.
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_EPISODE_CACHE_HPP_
+#define INCLUDE_EPISODE_CACHE_HPP_
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonObject>
+#include <QString>
+#include <QUrl>
+
+#include <memory>
+#include <vector>
+
+namespace DigitalRooster {
+
+/**
+ * Read only memory mapping of a cache file, shared by all texts that
+ * refer to it. The mapping stays valid if the file is replaced.
+ */
+class CacheFileMapping {
+public:
+    /**
+     * Open and map the file
+     * @throws std::system_error if the file can't be opened or mapped
+     * @param file_path file to map
+     */
+    explicit CacheFileMapping(const QString& file_path);
+    ~CacheFileMapping();
+    CacheFileMapping(const CacheFileMapping&) = delete;
+    CacheFileMapping(CacheFileMapping&&) = delete;
+    CacheFileMapping& operator=(const CacheFileMapping&) = delete;
+    CacheFileMapping& operator=(CacheFileMapping&&) = delete;
+
+    /**
+     * Start of mapped file
+     */
+    const char* data() const {
+        return reinterpret_cast<const char*>(mapped);
+    }
+
+    /**
+     * Size of mapped file in bytes
+     */
+    qint64 size() const {
+        return length;
+    }
+
+private:
+    QFile file;
+    uchar* mapped = nullptr;
+    qint64 length = 0;
+};
+
+/**
+ * UTF-8 text in a mapped cache file, decoded on demand
+ */
+class MappedText {
+public:
+    MappedText() = default;
+
+    /**
+     * Reference to text in mapping, range must be checked by caller
+     * @param mapping mapped cache file
+     * @param offset start of text in file
+     * @param size length in bytes
+     */
+    MappedText(std::shared_ptr<const CacheFileMapping> mapping,
+        quint32 offset, quint32 size);
+
+    /**
+     * Refers to a mapped file
+     * @return false for default constructed text
+     */
+    bool is_valid() const {
+        return mapping != nullptr;
+    }
+
+    /**
+     * Decode text
+     * @return text or empty string if not valid
+     */
+    QString to_string() const;
+
+    /**
+     * Copy of raw bytes, avoids decoding when writing a new cache file
+     * @return UTF-8 encoded text
+     */
+    QByteArray to_utf8() const;
+
+private:
+    std::shared_ptr<const CacheFileMapping> mapping;
+    quint32 offset = 0;
+    quint32 size = 0;
+};
+
+/**
+ * Values of one episode as stored in a cache file or in the EpisodeStore,
+ * plain values that can be created on any thread
+ */
+struct EpisodeRecord {
+    QString title;
+    QString publisher;
+    QString guid;
+    QUrl url;
+    QDateTime publication_date;
+    qint64 duration = 0;
+    qint64 position = 0;
+    /**
+     * description read from JSON or taken from a PodcastEpisode
+     */
+    QString description;
+    /**
+     * description in binary cache file, takes precedence if valid
+     */
+    MappedText mapped_description;
+    /**
+     * plain text description for lists, see description_summary()
+     */
+    QString summary;
+};
+
+/**
+ * Content of a podcast cache file
+ */
+struct PodcastCache {
+    /**
+     * PodcastSource properties as created by json_from_podcast_source()
+     */
+    QJsonObject source;
+    /**
+     * Episodes, newest first
+     */
+    std::vector<EpisodeRecord> episodes;
+};
+
+/**
+ * Read a binary cache file, or a JSON cache file of an older version.
+ * Does not access any podcast source thus can be called from any thread.
+ * @throws std::system_error if file can't be opened
+ * @throws PodcastSourceJSonCorrupted if file is truncated or the version
+ *         is not supported
+ * @param file_path file to read
+ * @return cache content
+ */
+PodcastCache read_podcast_cache(const QString& file_path);
+
+/**
+ * Write binary cache file. Does not access any podcast source thus can be
+ * called from any thread.
+ * @param cache content to write
+ * @param file_path file to write
+ * @return size of file written, 0 if the file could not be written
+ */
+qint64 write_podcast_cache(const PodcastCache& cache, const QString& file_path);
+
+/**
+ * Convert JSON cache representation, used to migrate old cache files
+ * @param tl_obj top level object = PodcastSource representation
+ * @return cache content
+ */
+PodcastCache podcast_cache_from_json(const QJsonObject& tl_obj);
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_EPISODE_CACHE_HPP_ */
@@ -0,0 +1,283 @@
+/******************************************************************************
+ * \filename
+ * \brief Download of podcast episodes for offline playback
+ *
+ * \details Episodes are streamed to a ".part" file in the download
+ *          directory, one at a time with background priority. Interrupted
+ *          downloads are resumed with an HTTP Range request. Completed
+ *          files are renamed and the oldest are removed above the quota,
+ *          the latest episodes of each podcast are never removed.
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_EPISODE_DOWNLOADER_HPP_
+#define INCLUDE_EPISODE_DOWNLOADER_HPP_
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+
+#include "appconstants.hpp"
+#include "httpclient.hpp"
+
+namespace DigitalRooster {
+class PodcastEpisode;
+class PodcastSource;
+
+/**
+ * Keeps selected and latest podcast episodes on disk
+ */
+class EpisodeDownloader : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * Constructor, reads the download directory once
+     * @param directory download directory, created if necessary
+     * @param quota maximum total size of completed downloads
+     * @param parent QObject
+     */
+    explicit EpisodeDownloader(const QString& directory,
+        qint64 quota = EPISODE_DOWNLOAD_QUOTA, QObject* parent = nullptr);
+
+    /**
+     * Closes the current ".part" file, it is resumed next time
+     */
+    ~EpisodeDownloader();
+    EpisodeDownloader(const EpisodeDownloader&) = delete;
+    EpisodeDownloader(EpisodeDownloader&&) = delete;
+    EpisodeDownloader& operator=(const EpisodeDownloader&) = delete;
+    EpisodeDownloader& operator=(EpisodeDownloader&&) = delete;
+
+    /**
+     * Name of the downloaded file without suffix
+     * @param guid episode guid
+     * @return hex encoded hash of guid
+     */
+    static QString file_key(const QString& guid);
+
+    /**
+     * Queue download of an episode, ignored if it is already downloaded
+     * or queued
+     * @param episode episode with enclosure URL
+     */
+    void download(const std::shared_ptr<PodcastEpisode>& episode);
+
+    /**
+     * Queue download of an episode, ignored if it is already downloaded
+     * or queued
+     * @param guid episode guid
+     * @param url enclosure URL
+     */
+    void download(const QString& guid, const QUrl& url);
+
+    /**
+     * Keep the latest PodcastSource::get_offline_episodes() episodes of
+     * a podcast downloaded whenever its episodes change
+     * @param ps podcast source
+     */
+    void add_podcast_source(const std::shared_ptr<PodcastSource>& ps);
+
+    /**
+     * Queue missing downloads of latest episodes of a podcast, reads the
+     * episode store without creating PodcastEpisode objects.
+     * Latest episodes are not removed to make room for other downloads,
+     * once they fill the quota no further episodes are queued.
+     * Downloads are Background requests, throttled while media is playing.
+     * @param ps podcast source
+     */
+    void download_latest(const PodcastSource& ps);
+
+    /**
+     * Local file of a completed download
+     * @param guid episode guid
+     * @return file URL or empty URL if not downloaded
+     */
+    QUrl get_local_url(const QString& guid);
+
+    /**
+     * Check for a completed download without filesystem access
+     * @param guid episode guid
+     */
+    bool is_downloaded(const QString& guid) const {
+        return completed.contains(file_key(guid));
+    }
+
+    /**
+     * Total size of completed downloads
+     */
+    qint64 get_used_bytes() const;
+
+    /**
+     * Number of episodes waiting, including the running download
+     */
+    int get_queue_length() const {
+        return static_cast<int>(queue.size());
+    }
+
+    /**
+     * Delay before an interrupted download is resumed
+     * @param delay time to wait
+     */
+    void set_resume_delay(std::chrono::milliseconds delay);
+
+signals:
+    /**
+     * Episode is available for offline playback
+     * @param guid episode guid
+     */
+    void episode_downloaded(const QString& guid);
+
+    /**
+     * Download was given up after EPISODE_DOWNLOAD_MAX_RESUMES
+     * @param guid episode guid
+     */
+    void download_failed(const QString& guid);
+
+private:
+    /**
+     * Queued download
+     */
+    struct Job {
+        QString guid;
+        QUrl url;
+        /**
+         * Number of resumes after interruptions
+         */
+        int resumes = 0;
+    };
+
+    /**
+     * Completed download
+     */
+    struct Entry {
+        QString file_name;
+        qint64 size = 0;
+        QDateTime downloaded;
+    };
+
+    QDir directory;
+    qint64 quota;
+
+    /**
+     * Jobs in order, front is running while \ref active
+     */
+    std::deque<Job> queue;
+
+    /**
+     * Front of \ref queue is downloading or waiting for resume
+     */
+    bool active = false;
+
+    /**
+     * Completed downloads by \ref file_key
+     */
+    QHash<QString, Entry> completed;
+
+    /**
+     * \ref file_key of the latest episodes of each podcast source
+     */
+    QHash<const PodcastSource*, QSet<QString>> latest;
+
+    /**
+     * Bytes received when a download was given up because it did not fit
+     * next to the latest episodes, by \ref file_key
+     */
+    QHash<QString, qint64> too_large;
+
+    /**
+     * Space of running download, \ref quota minus \ref reserved_bytes()
+     */
+    qint64 room = 0;
+
+    /**
+     * Partial file of running download
+     */
+    QFile part_file;
+
+    /**
+     * Streams the running download
+     */
+    HttpClient client;
+
+    /**
+     * Delays resume of an interrupted download
+     */
+    QTimer resume_timer;
+
+    /**
+     * Read completed downloads from \ref directory
+     */
+    void scan();
+
+    /**
+     * Start the download of the front of \ref queue
+     */
+    void start_next();
+
+    /**
+     * Server starts content at offset, truncate part file to it
+     * @param offset first byte of content
+     */
+    void stream_started(qint64 offset);
+
+    /**
+     * Append content to part file
+     * @param chunk content
+     */
+    void chunk_available(const QByteArray& chunk);
+
+    /**
+     * Finish, resume later or give up running download
+     * @param success complete content received
+     */
+    void stream_finished(bool success);
+
+    /**
+     * Remove downloads completed longest ago until below \ref quota,
+     * latest episodes are kept
+     * @param keep file key that is never removed
+     */
+    void enforce_quota(const QString& keep);
+
+    /**
+     * Check if an episode is one of the latest of a podcast source
+     * @param key \ref file_key of guid
+     */
+    bool is_latest(const QString& key) const;
+
+    /**
+     * Size of completed downloads of latest episodes, these are not
+     * removed to make room for other downloads
+     */
+    qint64 reserved_bytes() const;
+
+    /**
+     * Give up running download that does not fit into \ref room
+     */
+    void reject_running();
+
+    /**
+     * File name for an episode URL
+     * @param key \ref file_key of guid
+     * @param url enclosure URL, keeps its suffix for media type detection
+     */
+    static QString file_name(const QString& key, const QUrl& url);
+};
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_EPISODE_DOWNLOADER_HPP_ */
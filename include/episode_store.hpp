@@ -0,0 +1,347 @@
+/******************************************************************************
+ * \filename
+ * \brief Episodes of a podcast source stored column wise
+ *
+ * \details Episodes are kept as plain values, a PodcastEpisode QObject is
+ *          only created for an episode that is handed to QML or the player.
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_EPISODE_STORE_HPP_
+#define INCLUDE_EPISODE_STORE_HPP_
+
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <QUrl>
+
+#include <memory>
+#include <vector>
+
+#include "episode_cache.hpp"
+#include "string_pool.hpp"
+
+namespace DigitalRooster {
+class PodcastEpisode;
+
+/**
+ * Struct of arrays for the episodes of one podcast source, sorted by
+ * publication date, newest first.
+ * Each episode occupies a slot in the columns, slots are reused after an
+ * episode was dropped. Rows (position in the sorted list) map to slots,
+ * inserting an episode only moves slot numbers, not the values.
+ * Publisher, URL directory and description are interned, equal values of
+ * different episodes share one buffer.
+ */
+class EpisodeStore {
+public:
+    /**
+     * Number of episodes
+     */
+    int size() const {
+        return static_cast<int>(order.size());
+    }
+
+    /**
+     * Row of an episode in constant time
+     * @param guid publisher assigned id (or url)
+     * @return row or -1 if unknown
+     */
+    int row_of(const QString& guid) const;
+
+    /**
+     * Episode with this guid is stored
+     * @param guid publisher assigned id (or url)
+     */
+    bool contains(const QString& guid) const {
+        return slots_by_guid.contains(guid);
+    }
+
+    /**
+     * Result of \ref merge
+     */
+    struct MergeResult {
+        /** guids of inserted episodes, newest first */
+        std::vector<QString> inserted;
+        /** number of oldest episodes dropped */
+        int removed = 0;
+    };
+
+    /**
+     * Merge new episodes into the sorted list in one pass. Known guids,
+     * duplicates and episodes older than the max_episodes most recent
+     * are skipped.
+     * @param records new episodes in any order
+     * @param max_episodes maximum number of episodes kept
+     * @return inserted and removed episodes
+     */
+    MergeResult merge(std::vector<EpisodeRecord> records, size_t max_episodes);
+
+    /**
+     * Remove all episodes
+     */
+    void clear();
+
+    /**
+     * Values of one episode
+     * @param row 0..size()-1
+     */
+    EpisodeRecord record(int row) const;
+
+    /**
+     * Update values of an episode, guid and description are not changed
+     * @param row 0..size()-1
+     * @param values new values
+     */
+    void update(int row, const EpisodeRecord& values);
+
+    /**
+     * Replace description and its summary
+     * @param row 0..size()-1
+     * @param description new description (HTML)
+     */
+    void set_description(int row, const QString& description);
+
+    /**
+     * Update playback position only
+     * @param row 0..size()-1
+     * @param position position in ms
+     */
+    void set_position(int row, qint64 position);
+
+    /**
+     * Mark episode listened independent of its position, e.g. listened
+     * before and played again from the start
+     * @param row 0..size()-1
+     */
+    void set_listened(int row) {
+        listened_flags[slot(row)] = true;
+    }
+
+    /**
+     * Column access by row, row must be in 0..size()-1
+     */
+    const QString& guid(int row) const {
+        return guids[slot(row)];
+    }
+    const QString& title(int row) const {
+        return titles[slot(row)];
+    }
+    const QString& publisher(int row) const {
+        return publishers[slot(row)];
+    }
+    QUrl url(int row) const;
+    QDateTime publication_date(int row) const;
+    qint64 duration(int row) const {
+        return durations[slot(row)];
+    }
+    qint64 position(int row) const {
+        return positions[slot(row)];
+    }
+
+    /**
+     * Description, decoded from the cache file if necessary
+     * @param row 0..size()-1
+     */
+    QString description(int row) const;
+
+    /**
+     * Plain text of description for lists, see description_summary().
+     * Provided by parser and cache, otherwise computed on first access.
+     * @param row 0..size()-1
+     */
+    const QString& summary(int row) const;
+
+    /**
+     * Number of descriptions decoded from a cache file or summarized by
+     * the store, scrolling a list of summaries should not decode any
+     */
+    quint64 decoded_descriptions() const {
+        return decoded;
+    }
+
+    /**
+     * Same as PodcastEpisode::get_display_name()
+     * @param row 0..size()-1
+     * @return "publisher: title"
+     */
+    QString display_name(int row) const;
+
+    /**
+     * Same as PodcastEpisode::already_listened(), once listened an
+     * episode stays listened
+     * @param row 0..size()-1
+     */
+    bool listened(int row) const;
+
+    /**
+     * QObject of an episode that is still referenced
+     * @param row 0..size()-1
+     * @return episode or nullptr if none exists
+     */
+    std::shared_ptr<PodcastEpisode> facade(int row) const;
+
+    /**
+     * Remember QObject handed out for an episode, the store only keeps
+     * a weak reference
+     * @param row 0..size()-1
+     * @param episode QObject representing the row
+     */
+    void set_facade(int row, const std::shared_ptr<PodcastEpisode>& episode);
+
+    /**
+     * Create a QObject for a row, not remembered as facade
+     * @param row 0..size()-1
+     * @return new episode initialized with the values of the row
+     */
+    std::shared_ptr<PodcastEpisode> create_episode(int row) const;
+
+    /**
+     * Memory used by string values
+     */
+    struct StringUsage {
+        /** bytes of distinct string buffers */
+        qint64 stored = 0;
+        /** bytes if every value had its own buffer */
+        qint64 unshared = 0;
+    };
+
+    /**
+     * Account memory of string columns, shared buffers are counted once
+     * @return bytes used for strings
+     */
+    StringUsage string_usage() const;
+
+    /**
+     * Number of distinct interned strings
+     */
+    int pooled_strings() const {
+        return pool.size();
+    }
+
+private:
+    /**
+     * Columns, indexed by slot
+     */
+    std::vector<QString> guids;
+    std::vector<QString> titles;
+    std::vector<QString> publishers;
+    /** media URL up to the last '/', interned */
+    std::vector<QString> url_dirs;
+    /** media URL file name */
+    std::vector<QString> url_files;
+    std::vector<QString> descriptions;
+    std::vector<MappedText> mapped_descriptions;
+    /** empty until computed if \ref summarized is false */
+    mutable std::vector<QString> summaries;
+    mutable std::vector<bool> summarized;
+    /** ms since epoch, invalid dates are stored as min() */
+    std::vector<qint64> dates;
+    std::vector<qint64> durations;
+    std::vector<qint64> positions;
+    /** position was beyond MIN_LISTENED_PERC once or restored as listened */
+    std::vector<bool> listened_flags;
+
+    /**
+     * slots sorted by publication date, newest first
+     */
+    std::vector<int> order;
+
+    /**
+     * row of each slot, inverse of \ref order, -1 for free slots
+     */
+    std::vector<int> rows;
+
+    /**
+     * slots of dropped episodes to reuse
+     */
+    std::vector<int> free_slots;
+
+    /**
+     * slot of each guid for constant time \ref contains
+     */
+    QHash<QString, int> slots_by_guid;
+
+    /**
+     * QObjects handed out, only few episodes have one
+     */
+    QHash<int, std::weak_ptr<PodcastEpisode>> facades;
+
+    /**
+     * Interned values of this store, summaries are added on first access
+     */
+    mutable StringPool pool;
+
+    /**
+     * An interned value was replaced or released, \ref pool may hold
+     * strings no episode references
+     */
+    bool pool_stale = false;
+
+    /**
+     * see \ref decoded_descriptions
+     */
+    mutable quint64 decoded = 0;
+
+    int slot(int row) const {
+        return order[static_cast<size_t>(row)];
+    }
+
+    /**
+     * Update \ref rows after \ref order changed
+     */
+    void index_rows();
+
+    /**
+     * Store values in a free or new slot
+     * @return slot
+     */
+    int allocate(EpisodeRecord&& values);
+
+    /**
+     * Free strings of slot and make it available for reuse,
+     * \ref pool is pruned by caller with \ref prune_pool
+     */
+    void release(int slot);
+
+    /**
+     * Assign interned values to a slot, guid and description are not
+     * changed
+     */
+    void assign(int slot, const EpisodeRecord& values);
+
+    /**
+     * Assign description and summary, a missing summary is computed on
+     * first access
+     */
+    void assign_description(int slot, const EpisodeRecord& values);
+
+    /**
+     * Replace an interned value of a column, remembers that the old value
+     * may only be referenced by \ref pool anymore
+     * @param column value in a column
+     * @param value new value, interned
+     */
+    void assign_pooled(QString& column, const QString& value);
+
+    /**
+     * Remove strings from \ref pool that no episode references anymore,
+     * only if a value was replaced or released since the last prune
+     */
+    void prune_pool();
+};
+
+/**
+ * Values of an episode QObject
+ * @param episode the episode
+ * @return values, a description that has not been decoded stays mapped
+ */
+EpisodeRecord record_from_episode(const PodcastEpisode& episode);
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_EPISODE_STORE_HPP_ */
@@ -18,7 +18,12 @@
 #include <QByteArray>
 #include <QtCore>
 #include <QtNetwork>
-#include <QNetworkAccessManager>
+
+#include <chrono>
+#include <vector>
+
+#include "appconstants.hpp"
+#include "network_service.hpp"
 
 class QSslError;
 class QNetworkReply;
@@ -31,12 +36,70 @@ namespace DigitalRooster {
  */
 class HttpClient : public QObject {
     Q_OBJECT
-    QNetworkAccessManager manager;
-    std::vector<QNetworkReply*> pending_downloads;
 
 public:
     HttpClient();
+
+    /**
+     * Aborts pending downloads, replies belong to the shared
+     * NetworkService
+     */
+    ~HttpClient();
+
+    /**
+     * In streaming mode content is emitted in chunks with \ref chunkAvailable
+     * while downloading, \ref streamFinished signals the end of download.
+     * \ref dataAvailable is not emitted.
+     * @param enable streaming mode for following downloads
+     */
+    void set_streaming(bool enable);
+
+    /**
+     * Timeouts of following downloads
+     * @param connect time until response headers must be received
+     * @param transfer maximum time without receiving data afterwards
+     */
+    void set_timeouts(std::chrono::milliseconds connect,
+        std::chrono::milliseconds transfer);
+
+    /**
+     * Priority of following downloads, background downloads are
+     * throttled during playback: new ones wait in the queue, running
+     * ones in streaming mode are read one chunk per
+     * NetworkService::get_background_read_interval()
+     * @param priority queue priority
+     */
+    void set_priority(RequestPriority priority);
+
+    /**
+     * Retries of following downloads after timeouts, network errors and
+     * server errors (5xx), streamed downloads are only retried before the
+     * first chunk was emitted
+     * @param max_retries 0 disables retries
+     * @param backoff delay of first retry, doubled for each retry
+     */
+    void set_retries(int max_retries, std::chrono::milliseconds backoff);
+
     void doDownload(const QUrl& url);
+    /**
+     * Download with a prepared request, e.g. with conditional headers
+     * @param request request to send (redirect policy is set by HttpClient)
+     */
+    void doDownload(QNetworkRequest request);
+
+    /**
+     * Abort all pending downloads
+     */
+    void abort();
+
+    /**
+     * Check for running downloads
+     * @return true if a download has not finished yet
+     */
+    bool is_busy() const {
+        return !pending_downloads.empty() || scheduled > 0;
+    }
+
     static bool isHttpRedirect(QNetworkReply* reply);
 
 public slots:
@@ -46,6 +109,159 @@ public slots:
 signals:
     void dataAvailable(QByteArray content);
 
+    /**
+     * Server answered a conditional request with 304 - Not Modified
+     */
+    void notModified();
+
+    /**
+     * Cache validators of a successful response, emitted before
+     * \ref dataAvailable
+     * @param etag value of ETag header (can be empty)
+     * @param last_modified value of Last-Modified header (can be empty)
+     */
+    void validatorsAvailable(QByteArray etag, QByteArray last_modified);
+
+    /**
+     * Content of a download starts, emitted before the first
+     * \ref chunkAvailable of each request (streaming mode)
+     * @param offset position of first chunk in the resource, > 0 if the
+     *        server answered a Range request with 206 - Partial Content
+     */
+    void streamStarted(qint64 offset);
+
+    /**
+     * Next part of the content (streaming mode)
+     * @param chunk at most RSS_STREAM_CHUNK_SIZE bytes
+     */
+    void chunkAvailable(QByteArray chunk);
+
+    /**
+     * Download in streaming mode has ended
+     * @param success false if the download failed, chunks received so far
+     *        are incomplete
+     */
+    void streamFinished(bool success);
+
+    /**
+     * Download failed after all retries or was not sent because the host
+     * is unavailable, emitted in both modes after \ref streamFinished
+     */
+    void downloadFailed();
+
+private:
+    /**
+     * A download that has not finished yet
+     */
+    struct Download {
+        /**
+         * Reply of current attempt
+         */
+        QNetworkReply* reply;
+        /**
+         * Request for retries
+         */
+        QNetworkRequest request;
+        /**
+         * Number of retries before the current attempt
+         */
+        int attempt;
+        /**
+         * Chunks were emitted, a retry would repeat them
+         */
+        bool streamed;
+    };
+
+    std::vector<Download> pending_downloads;
+    bool streaming = false;
+    RequestPriority priority = RequestPriority::Normal;
+    std::chrono::milliseconds connect_timeout = HTTP_CONNECT_TIMEOUT;
+    std::chrono::milliseconds transfer_timeout = HTTP_TRANSFER_TIMEOUT;
+    int max_retries = HTTP_MAX_RETRIES;
+    std::chrono::milliseconds retry_backoff = HTTP_RETRY_BACKOFF;
+
+    /**
+     * Requests waiting in queue, retries and failures waiting for their
+     * timer
+     */
+    int scheduled = 0;
+
+    /**
+     * Incremented by \ref abort to cancel scheduled retries
+     */
+    unsigned int generation = 0;
+
+    /**
+     * Reads throttled streaming replies while media is playing
+     */
+    QTimer pace_timer;
+
+    /**
+     * Streamed background downloads are read at a limited rate
+     * @return true while NetworkService throttles background downloads
+     */
+    bool is_throttled() const;
+
+    /**
+     * Read one chunk of each pending reply, stops \ref pace_timer when
+     * nothing is buffered or throttling ended
+     */
+    void read_paced();
+
+    /**
+     * Emit buffered data of a pending streaming reply
+     * @param reply network reply
+     * @param max_chunks chunks to read at most, -1 reads all
+     */
+    void read_reply(QNetworkReply* reply, int max_chunks);
+
+    /**
+     * Queue request unless the circuit breaker of its host is open
+     * @param request prepared request
+     * @param attempt number of retries before
+     */
+    void send(const QNetworkRequest& request, int attempt);
+
+    /**
+     * Send request when the queue admits it
+     * @param request prepared request
+     * @param attempt number of retries before
+     */
+    void start(const QNetworkRequest& request, int attempt);
+
+    /**
+     * Abort a reply that did not receive data in time
+     * @param reply network reply
+     */
+    void timeout(QNetworkReply* reply);
+
+    /**
+     * Schedule a retry or report the failure of a download
+     * @param download failed download, already removed from pending
+     * @param transient failure may succeed when retried
+     */
+    void retry_or_fail(const Download& download, bool transient);
+
+    /**
+     * Report a failed download to receivers of both modes
+     */
+    void fail();
+
+    /**
+     * Find pending download of a reply
+     * @param reply network reply
+     * @return iterator or end()
+     */
+    std::vector<Download>::iterator find_download(QNetworkReply* reply);
+
+    /**
+     * Emit buffered data of a streaming reply
+     * @param reply network reply
+     * @param started \ref streamStarted was already emitted for reply
+     * @param max_chunks chunks to read at most, -1 reads all
+     * @return true if content was emitted
+     */
+    bool readChunk(QNetworkReply* reply, bool started, int max_chunks = -1);
 };
 
 } /* namespace DigitalRooster */
@@ -20,6 +20,7 @@
 #include "mediaplayer.hpp"
 
 namespace DigitalRooster {
+class EpisodeDownloader;
 class PlayableItem;
 class PodcastEpisode;
 
@@ -46,6 +47,13 @@ public:
         return position_updateable;
     }
 
+    /**
+     * Podcast episodes are played from their downloaded file if available
+     * @param downloader offline episodes
+     */
+    void set_episode_downloader(
+        std::shared_ptr<EpisodeDownloader> downloader);
+
 private:
     virtual bool is_seekable() const override;
     virtual bool is_muted() const override;
@@ -87,6 +95,10 @@ private:
      * currently selected media (Podcastepisode, RadioStream...)
      */
     std::shared_ptr<PlayableItem> current_item;
+    /**
+     * Optional offline episodes
+     */
+    std::shared_ptr<EpisodeDownloader> episode_downloader;
 }; // Player
 } // namespace DigitalRooster
 #endif // _MEDIAPLAYERPROXY_HPP_
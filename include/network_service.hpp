@@ -0,0 +1,383 @@
+/******************************************************************************
+ * \filename
+ * \brief Process-wide network access for all HTTP downloads
+ *
+ * \details All \ref HttpClient instances send their requests through one
+ *          QNetworkAccessManager so persistent connections, DNS results and
+ *          TLS sessions are reused. Responses are cached on disk according
+ *          to their HTTP cache headers.
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_NETWORK_SERVICE_HPP_
+#define INCLUDE_NETWORK_SERVICE_HPP_
+
+#include <QHash>
+#include <QMediaPlayer>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+
+#include "appconstants.hpp"
+
+class QNetworkDiskCache;
+class QNetworkReply;
+
+namespace DigitalRooster {
+
+/**
+ * Order in which queued requests are sent
+ */
+enum class RequestPriority {
+    Normal,    //!< shown to the user, e.g. icons, sent first
+    Background //!< feed refreshes, weather, throttled during playback
+};
+
+/**
+ * Counters of all replies from one host
+ */
+struct HostStatistics {
+    /**
+     * Number of requests sent
+     */
+    unsigned int requests = 0;
+    /**
+     * Replies served from the disk cache, including responses revalidated
+     * with 304 - Not Modified
+     */
+    unsigned int cache_hits = 0;
+    /**
+     * Replies transferred with HTTP/2
+     */
+    unsigned int http2 = 0;
+    /**
+     * Replies that failed or were aborted
+     */
+    unsigned int errors = 0;
+    /**
+     * Content bytes received over the network
+     */
+    qint64 bytes_received = 0;
+    /**
+     * Downloads aborted by connect or transfer timeout
+     */
+    unsigned int timeouts = 0;
+    /**
+     * Downloads sent again after a failure
+     */
+    unsigned int retries = 0;
+    /**
+     * Number of times the circuit breaker opened
+     */
+    unsigned int circuits_opened = 0;
+    /**
+     * Requests not sent because the circuit breaker was open
+     */
+    unsigned int rejected = 0;
+};
+
+/**
+ * Singleton owning the QNetworkAccessManager shared by all downloads,
+ * must only be used from the GUI thread
+ */
+class NetworkService : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * Create the process wide instance, main() creates it right after the
+     * application so the network access manager and its disk cache are
+     * destroyed before the application and after all clients
+     * @param parent QObject
+     */
+    explicit NetworkService(QObject* parent = nullptr);
+
+    /**
+     * Unregisters instance
+     */
+    ~NetworkService();
+
+    NetworkService(const NetworkService&) = delete;
+    NetworkService& operator=(const NetworkService&) = delete;
+
+    /**
+     * Singleton access
+     * @return instance created in main()
+     */
+    static NetworkService* get_instance();
+
+    /**
+     * Send a GET request with connection reuse and HTTP/2 enabled,
+     * call from the function passed to \ref enqueue
+     * @param request prepared request
+     * @param priority priority of request, counted while running
+     * @return reply, owned by the shared manager
+     */
+    QNetworkReply* get(QNetworkRequest request,
+        RequestPriority priority = RequestPriority::Normal);
+
+    /**
+     * Call start now if a request of this priority may be sent, otherwise
+     * queue it behind requests of the same or higher priority
+     * @param priority priority of request
+     * @param owner start is dropped if owner is destroyed meanwhile
+     * @param start sends the request with \ref get
+     */
+    void enqueue(RequestPriority priority, QObject* owner,
+        std::function<void()> start);
+
+    /**
+     * Drop all queued requests of owner, e.g. if they were aborted
+     * @param owner as passed to \ref enqueue
+     */
+    void dequeue(QObject* owner);
+
+    /**
+     * Number of requests waiting in queue
+     */
+    int get_queue_length() const {
+        return static_cast<int>(queue.size());
+    }
+
+    /**
+     * Number of background requests running
+     */
+    int get_active_background() const {
+        return active_background;
+    }
+
+    /**
+     * Maximum number of background requests while playing
+     * @param limit 0 pauses background requests during playback
+     */
+    void set_background_limit(int limit);
+
+    /**
+     * Running background downloads are read at a limited rate
+     * @return true while media is playing
+     */
+    bool is_background_throttled() const {
+        return playing;
+    }
+
+    /**
+     * Interval of reads of running background downloads while playing
+     * @param interval one chunk is read per interval
+     */
+    void set_background_read_interval(std::chrono::milliseconds interval);
+
+    /**
+     * Interval of reads of running background downloads while playing
+     */
+    std::chrono::milliseconds get_background_read_interval() const {
+        return background_read_interval;
+    }
+
+    /**
+     * Cache responses on disk, replaces a previous cache
+     * @param path directory for cache files, created if necessary
+     * @param max_bytes least recently used responses are removed above
+     */
+    void set_cache_directory(
+        const QString& path, qint64 max_bytes = HTTP_CACHE_MAX_BYTES);
+
+    /**
+     * Current size of the disk cache
+     * @return bytes or 0 without disk cache
+     */
+    qint64 get_cache_size() const;
+
+    /**
+     * Statistics per host since start
+     * @return counters by host name
+     */
+    const QHash<QString, HostStatistics>& get_host_statistics() const {
+        return hosts;
+    }
+
+    /**
+     * Sum of all host statistics
+     */
+    HostStatistics get_total_statistics() const;
+
+    /**
+     * Configure circuit breaker for all hosts
+     * @param failures consecutive failures of a host to open its circuit
+     * @param open_time requests are rejected this time after opening
+     */
+    void set_circuit_breaker(
+        int failures, std::chrono::milliseconds open_time);
+
+    /**
+     * Check circuit breaker before sending a request, counts rejections.
+     * After the open time the circuit is half open, a single request is
+     * let through as probe until its result is reported or the open time
+     * passed again.
+     * @param host host name of request
+     * @return false while the circuit of host is open or a probe runs
+     */
+    bool allow_request(const QString& host);
+
+    /**
+     * Check circuit breaker without counting
+     * @param host host name
+     * @return true while requests to host are rejected
+     */
+    bool is_circuit_open(const QString& host) const;
+
+    /**
+     * Update circuit breaker with the result of a download
+     * @param host host name of request
+     * @param host_failure timeout, network error or server error (5xx)
+     */
+    void report_result(const QString& host, bool host_failure);
+
+    /**
+     * Count a download aborted by timeout
+     * @param host host name of request
+     */
+    void count_timeout(const QString& host);
+
+    /**
+     * Count a download sent again
+     * @param host host name of request
+     */
+    void count_retry(const QString& host);
+
+public slots:
+    /**
+     * Background requests are throttled while media is playing
+     * @param state new playback state of media player
+     */
+    void playback_state_changed(QMediaPlayer::State state);
+
+    /**
+     * Log total and per host statistics, e.g. before standby
+     */
+    void log_statistics() const;
+
+signals:
+    /**
+     * Running background downloads must be read at a limited rate
+     * @param throttled true when playback started, false when it stopped
+     */
+    void background_throttled(bool throttled);
+
+private:
+    /**
+     * Circuit breaker state of a host
+     */
+    struct Circuit {
+        /**
+         * Failures since last success
+         */
+        int failures = 0;
+        /**
+         * Requests are rejected until this time
+         */
+        std::chrono::steady_clock::time_point open_until;
+        /**
+         * Half open: further requests are rejected until the probe
+         * reported its result or this time passed
+         */
+        std::chrono::steady_clock::time_point probe_until;
+    };
+
+    /**
+     * Request waiting for \ref dispatch
+     */
+    struct Queued {
+        RequestPriority priority;
+        QPointer<QObject> owner;
+        std::function<void()> start;
+    };
+
+    /**
+     * Requests in order of submission
+     */
+    std::deque<Queued> queue;
+
+    /**
+     * Media player is playing
+     */
+    bool playing = false;
+
+    /**
+     * Running requests of priority Background
+     */
+    int active_background = 0;
+
+    /**
+     * Maximum running background requests while playing
+     */
+    int background_limit = HTTP_BACKGROUND_LIMIT_PLAYING;
+
+    /**
+     * One chunk of a running background download is read per interval
+     * while playing
+     */
+    std::chrono::milliseconds background_read_interval =
+        HTTP_BACKGROUND_READ_INTERVAL;
+
+    /**
+     * The only network access manager of the process
+     */
+    QNetworkAccessManager manager;
+
+    /**
+     * Disk cache, owned by \ref manager
+     */
+    QNetworkDiskCache* disk_cache = nullptr;
+
+    /**
+     * Counters by host name
+     */
+    QHash<QString, HostStatistics> hosts;
+
+    /**
+     * Circuit breaker by host name
+     */
+    QHash<QString, Circuit> circuits;
+
+    /**
+     * Consecutive failures of a host to open its circuit
+     */
+    int circuit_failures = HTTP_CIRCUIT_FAILURES;
+
+    /**
+     * Time requests are rejected after the circuit opened
+     */
+    std::chrono::milliseconds circuit_open_time = HTTP_CIRCUIT_OPEN_TIME;
+
+    /**
+     * Update statistics of a finished reply
+     * @param reply finished reply
+     * @param bytes content bytes received
+     */
+    void count_reply(QNetworkReply* reply, qint64 bytes);
+
+    /**
+     * Check if a request of this priority may be sent now
+     * @param priority request priority
+     * @return true if the request does not need to wait
+     */
+    bool admit(RequestPriority priority) const;
+
+    /**
+     * Start queued requests by priority as long as they are admitted
+     */
+    void dispatch();
+};
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_NETWORK_SERVICE_HPP_ */
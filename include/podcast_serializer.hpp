@@ -15,17 +15,24 @@
 #define _PODCASTSERIALIZER_HPP_
 
 #include <QDir>
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QMutex>
 #include <QObject>
 #include <QTimer>
 
 #include <exception>
+#include <functional>
 #include <memory>
+#include <vector>
 
+#include "episode_cache.hpp"
 
 namespace DigitalRooster {
 class PodcastSource;
+class CacheWriter;
 
 /**
  * Serialization/Deserialization of PodcastSources and PodcastEpisodes
@@ -51,7 +58,14 @@ public:
     void set_podcast_source(PodcastSource* source);
 
     /**
-     * Need destructor to stop timer
+     * Batch delayed writes with other serializers and write the file on
+     * the background thread of the writer instead of the worker pool
+     * @param writer shared by all serializers
+     */
+    void set_cache_writer(std::shared_ptr<CacheWriter> writer);
+
+    /**
+     * Need destructor to stop timer and wait for a running write
      */
     virtual ~PodcastSerializer();
     PodcastSerializer(const PodcastSerializer&) = delete;
@@ -76,7 +90,8 @@ public slots:
      */
     void restore_info();
     /**
-     * Immediately write data to cache file
+     * Immediately write data to cache file, a snapshot of the podcast source
+     * is taken on the calling thread, the file is written on the worker pool
      */
     void write();
 
@@ -102,6 +117,50 @@ private:
      */
     const QDir& cache_dir;
 
+    /**
+     * Order of writes and deletes of the cache file on the worker pool,
+     * shared with the tasks that may outlive the serializer
+     */
+    struct FileOperations {
+        /** one file operation at a time */
+        QMutex mutex;
+        /** sequence number of the last submitted operation */
+        quint64 submitted = 0;
+        /** sequence number of the last finished operation, guarded by mutex */
+        quint64 completed = 0;
+    };
+    std::shared_ptr<FileOperations> file_ops =
+        std::make_shared<FileOperations>();
+
+    /**
+     * Run a write or delete of the cache file on the worker pool without
+     * waiting, an operation is skipped if a newer one already ran
+     * @param op file operation, must not access the podcast source
+     */
+    void run_file_operation(std::function<void()> op);
+
+    /**
+     * Optional write-behind for all cache files, replaces \ref writeTimer
+     * and \ref run_file_operation
+     */
+    std::shared_ptr<CacheWriter> cache_writer;
+
+    /**
+     * Icon decoded and saved on the worker pool, a newer download
+     * replaces the future so only the last result is reported
+     */
+    QFutureWatcher<bool> image_watcher;
+
+    /**
+     * File written by the task of \ref image_watcher
+     */
+    QString pending_image_path;
+
+    /**
+     * Report icon file to podcast source when \ref image_watcher finished
+     */
+    void image_stored();
+
     /**
      * NVI implementation of delete_cached_info()
      */
@@ -117,19 +176,96 @@ private:
 };
 
 /**
- * serializes podcast source to filesystem
+ * Decode an image scaled to fit width x width while reading and save it as
+ * PNG, does not access any podcast source thus can be called from any thread
+ * @param data image file content
+ * @param file_path PNG file to write
+ * @param width maximum width and height
+ * @return true if the image was decoded and saved
+ */
+bool store_icon(const QByteArray& data, const QString& file_path, int width);
+
+/**
+ * Remove icons (*.png) of a directory used longest ago until the total
+ * size is below max_bytes, can be called from any thread
+ * @param dir icon cache directory
+ * @param max_bytes maximum size of all icons
+ * @param keep icon that must not be removed, e.g. the one just stored
+ * @return bytes removed
+ */
+qint64 evict_icons(const QDir& dir, qint64 max_bytes, const QString& keep);
+
+/**
+ * Mark an icon as used for \ref evict_icons by updating its modification
+ * time
+ * @param file_path icon file
+ */
+void touch_icon(const QString& file_path);
+
+/**
+ * serializes podcast source to filesystem in binary cache format
  * @param ps podcastsource to write
  * @param file_path file to write
  */
 void store_to_file(PodcastSource* ps, const QString& file_path);
 
 /**
- * restore configuration of podcastsource form filesystem
+ * restore configuration of podcastsource form filesystem,
+ * reads binary and JSON cache files
  * @param ps podcastsource to restore
  * @param file_path file to read
  */
 void read_from_file(PodcastSource* ps, const QString& file_path);
 
+/**
+ * Snapshot of podcast source and episodes to write on another thread,
+ * descriptions that have not been decoded are not decoded for writing
+ * @param ps the PodcastSource to serialize
+ * @return content of cache file
+ */
+PodcastCache podcast_cache_from_podcast_source(const PodcastSource* ps);
+
+/**
+ * Restore podcast source and episodes from cache file content
+ * @param cache result of \ref read_podcast_cache
+ * @param ps podcast source to configure
+ */
+void restore_podcast_source(const PodcastCache& cache, PodcastSource* ps);
+
+/**
+ * Add cached episodes to ps, if episode already exists we update the
+ * position information
+ * @param episodes episodes of cache file
+ * @param ps PodcastSource to update
+ */
+void read_episodes_cache(
+    const std::vector<EpisodeRecord>& episodes, PodcastSource* ps);
+
+/**
+ * Read JSON cache file of a podcast source, does not access the podcast
+ * source thus can be called from any thread
+ * @throws std::system_error if file can't be opened
+ * @throws PodcastSourceJSonCorrupted if file is not a JSON object
+ * @param file_path file to read
+ * @return top level object = PodcastSource representation
+ */
+QJsonObject read_cache_json(const QString& file_path);
+
+/**
+ * Restore podcast source and episodes from cached JSON representation
+ * @param tl_obj result of \ref read_cache_json
+ * @param ps podcast source to configure
+ */
+void restore_podcast_source(const QJsonObject& tl_obj, PodcastSource* ps);
+
+/**
+ * Write JSON representation of a podcast source to file, does not access
+ * the podcast source thus can be called from any thread
+ * @param tl_obj result of \ref json_from_podcast_source with episodes
+ * @param file_path file to write
+ */
+void write_cache_json(const QJsonObject& tl_obj, const QString& file_path);
+
 /**
  * parse file and configure podcastsource accordingly
  * @param tl_obj top level object = PodcastSource representation
@@ -154,6 +290,14 @@ void read_episodes_cache(const QJsonObject& tl_obj, PodcastSource* ps);
  */
 QJsonObject json_from_podcast_source(const PodcastSource* ps);
 
+/**
+ * JSON Object representation of a PodcastSource including all episodes,
+ * i.e. the content of the cache file
+ * @param ps the PodcastSource to serialize
+ * @return JSON Object representation
+ */
+QJsonObject cache_json_from_podcast_source(const PodcastSource* ps);
+
 /**
  * Exception thrown if serialized podcast source is corrupted,
  */
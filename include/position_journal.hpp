@@ -0,0 +1,161 @@
+/******************************************************************************
+ * \filename
+ * \brief Playback positions of podcast episodes in fixed size records
+ *
+ * \details Position ticks of the player only update the journal in memory,
+ *          changed records are written in place when playback pauses or
+ *          stops, before standby and at a coarse interval. The podcast
+ *          cache files are only written for metadata changes.
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_POSITION_JOURNAL_HPP_
+#define INCLUDE_POSITION_JOURNAL_HPP_
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <chrono>
+
+#include "appconstants.hpp"
+
+namespace DigitalRooster {
+
+/**
+ * Map of episode guid hash to last playback position and listened flag
+ * backed by a file of fixed size records
+ */
+class PositionJournal : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * Position of one episode
+     */
+    struct Entry {
+        /** playback position in ms, -1 if unknown */
+        qint64 position = -1;
+        /** episode was considered listened once */
+        bool listened = false;
+    };
+
+    /**
+     * Read journal file
+     * @param file_path journal file, created with the first flush
+     * @param interval flush changed records at the latest after interval
+     * @param parent QObject
+     */
+    explicit PositionJournal(const QString& file_path,
+        std::chrono::milliseconds interval = POSITION_JOURNAL_INTERVAL,
+        QObject* parent = nullptr);
+
+    /**
+     * Flushes changed records
+     */
+    ~PositionJournal();
+
+    /**
+     * Remember position of an episode, only written with the next flush
+     * @param guid episode guid
+     * @param position playback position in ms
+     * @param listened episode is considered listened
+     */
+    void record(const QString& guid, qint64 position, bool listened);
+
+    /**
+     * Last known position of an episode
+     * @param guid episode guid
+     * @return entry with position -1 if the episode is not in the journal
+     */
+    Entry entry(const QString& guid) const;
+
+    /**
+     * Number of episodes in the journal
+     */
+    int size() const {
+        return entries.size();
+    }
+
+    /**
+     * Number of records changed since last flush
+     */
+    int pending() const {
+        return dirty;
+    }
+
+    /**
+     * Key of an episode in the journal
+     * @param guid episode guid
+     * @return first 64 bits of MD5 hash
+     */
+    static quint64 key(const QString& guid);
+
+public slots:
+    /**
+     * Write changed records in place, new records are appended
+     */
+    void flush();
+
+private:
+    /**
+     * Journal entry with bookkeeping
+     */
+    struct Record {
+        Entry value;
+        /** sequence number of last change, oldest records are dropped */
+        qint64 serial = 0;
+        /** index of record in file */
+        int index = -1;
+        /** changed since last flush */
+        bool changed = false;
+    };
+
+    /**
+     * Path of journal file
+     */
+    QString file_path;
+
+    /**
+     * All records by \ref key()
+     */
+    QHash<quint64, Record> entries;
+
+    /**
+     * Sequence number of the most recent change
+     */
+    qint64 last_serial = 0;
+
+    /**
+     * Number of records in file, next record is appended at this index
+     */
+    int file_records = 0;
+
+    /**
+     * Number of changed records
+     */
+    int dirty = 0;
+
+    /**
+     * Single shot timer started with the first change after a flush
+     */
+    QTimer flush_timer;
+
+    /**
+     * Read all records from file
+     */
+    void load();
+
+    /**
+     * Drop the oldest records and write all remaining records to a new file
+     */
+    void compact();
+};
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_POSITION_JOURNAL_HPP_ */
@@ -0,0 +1,200 @@
+/******************************************************************************
+ * \filename
+ * \brief Schedules periodic refresh of all podcast feeds
+ *
+ * \details One queue for all feeds instead of a timer per feed, limits the
+ *          number of concurrent downloads and backs off from failing hosts
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_REFRESH_SCHEDULER_HPP_
+#define INCLUDE_REFRESH_SCHEDULER_HPP_
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QUuid>
+
+#include <chrono>
+#include <memory>
+
+#include "appconstants.hpp"
+
+namespace DigitalRooster {
+// forward decl
+class Configuration;
+class PodcastSource;
+
+/**
+ * Refreshes the podcast sources of the configuration in intervals of
+ * PodcastSource::get_effective_update_interval().
+ * - at most max_concurrent feeds are downloaded at the same time, due feeds
+ *   wait in a queue
+ * - each refresh is delayed by a random jitter, feeds don't re-align on the
+ *   same boundary
+ * - after a failed refresh all feeds of the same host are deferred,
+ *   the delay doubles with each consecutive failure of the host
+ */
+class RefreshScheduler : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(int queue_depth READ get_queue_depth NOTIFY queue_changed)
+    Q_PROPERTY(int running READ get_running NOTIFY queue_changed)
+public:
+    /**
+     * Constructor, must be called on the thread of the configuration
+     * @param cfg configuration with podcast sources
+     * @param max_concurrent maximum number of concurrent feed downloads
+     * @param jitter maximum random delay added to each refresh
+     * @param parent owning QObject
+     */
+    explicit RefreshScheduler(Configuration& cfg,
+        int max_concurrent = FEED_REFRESH_MAX_CONCURRENT,
+        std::chrono::milliseconds jitter = FEED_REFRESH_JITTER,
+        QObject* parent = nullptr);
+
+    /**
+     * Number of feeds that are due but wait for a free download slot
+     * @return queue depth
+     */
+    int get_queue_depth() const;
+
+    /**
+     * Number of feed downloads in progress
+     * @return running refreshes
+     */
+    int get_running() const;
+
+    /**
+     * Time of next scheduled refresh of a podcast source
+     * @param id podcast source id
+     * @return next refresh or invalid QDateTime for unknown sources
+     *         or while the refresh is running
+     */
+    Q_INVOKABLE QDateTime get_next_refresh(const QUuid& id) const;
+
+    /**
+     * Current retry delay for a host
+     * @param host host part of feed url, whole url of local feeds
+     * @return 0 if the last refresh of this host succeeded
+     */
+    std::chrono::seconds get_backoff(const QString& host) const;
+
+public slots:
+    /**
+     * Add new and remove deleted podcast sources of the configuration,
+     * new sources are refreshed after a random jitter
+     */
+    void sync_sources();
+
+    /**
+     * Start due refreshes as long as download slots are free and
+     * restart the timer for the next due refresh
+     */
+    void dispatch();
+
+signals:
+    /**
+     * Queue depth, running refreshes or next refresh times changed
+     */
+    void queue_changed();
+
+private:
+    /**
+     * Scheduling state of one podcast source
+     */
+    struct Entry {
+        /**
+         * Sources are owned by the configuration
+         */
+        std::weak_ptr<PodcastSource> source;
+        /**
+         * host part of feed url for backoff, whole url of local feeds
+         */
+        QString host;
+        /**
+         * refresh is due at this time
+         */
+        QDateTime next_refresh;
+        /**
+         * refresh started and not yet finished, time of timeout
+         */
+        QDateTime deadline;
+        /**
+         * connection to PodcastSource::update_finished
+         */
+        QMetaObject::Connection finished_cnx;
+    };
+
+    /**
+     * Consecutive failures of a host
+     */
+    struct HostState {
+        int failures = 0;
+        /**
+         * no refresh for this host before this time
+         */
+        QDateTime blocked_until;
+    };
+
+    /**
+     * Configuration owning the podcast sources
+     */
+    Configuration& config;
+
+    /**
+     * Maximum number of running refreshes
+     */
+    int max_concurrent;
+
+    /**
+     * Maximum random delay in ms
+     */
+    std::chrono::milliseconds jitter;
+
+    /**
+     * All podcast sources by id
+     */
+    QHash<QUuid, Entry> entries;
+
+    /**
+     * Backoff state of failing hosts
+     */
+    QHash<QString, HostState> hosts;
+
+    /**
+     * Fires when the next refresh is due or a running refresh times out
+     */
+    QTimer timer;
+
+    /**
+     * PodcastSource has finished a refresh (scheduled or manual)
+     * @param id podcast source id
+     * @param success feed was downloaded and parsed or not modified
+     */
+    void refresh_finished(const QUuid& id, bool success);
+
+    /**
+     * Calculate next refresh after a refresh has finished or timed out
+     * and update the backoff state of the host
+     * @param entry scheduling state of podcast source
+     * @param success refresh was successful
+     * @param now current time
+     */
+    void reschedule(Entry& entry, bool success, const QDateTime& now);
+
+    /**
+     * Random delay in [0, jitter]
+     * @return time to add to next refresh
+     */
+    qint64 random_jitter_ms() const;
+};
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_REFRESH_SCHEDULER_HPP_ */
@@ -13,17 +13,254 @@
 #ifndef _RSS2PODCASTSOURCE_HPP_
 #define _RSS2PODCASTSOURCE_HPP_
 
+#include <QByteArray>
+#include <QDateTime>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+#include <QXmlStreamReader>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
 #include "PodcastSource.hpp"
+#include "string_pool.hpp"
 
 namespace DigitalRooster {
 
+/**
+ * Values of one RSS <item>, added as EpisodeRecord on the main thread
+ */
+struct FeedItem {
+    QString title;
+    QString description;
+    QString publisher;
+    QString guid;
+    QUrl url;
+    QDateTime publication_date;
+    qint64 duration = 0;
+    /** plain text of description, computed on the parser thread */
+    QString summary;
+};
+
+/**
+ * Channel information and new items parsed since the last update was taken
+ * Channel elements not (yet) found in the document are empty optionals.
+ */
+struct FeedUpdate {
+    std::optional<QString> title;
+    std::optional<QString> description;
+    std::optional<QUrl> link;
+    std::optional<QUrl> image_url;
+    std::vector<FeedItem> items;
+};
+
+/**
+ * Incremental RSS parser that does not touch the PodcastSource while
+ * parsing, thus it can run on a worker thread. Data can be added in chunks
+ * of any size, new items are collected in a \ref FeedUpdate that is taken
+ * and applied to the PodcastSource on the main thread with
+ * \ref apply_feed_update.
+ * Only the chunk and the element being parsed are kept in memory.
+ *
+ * Items already known (by guid) or older than the oldest episode kept under
+ * max_episodes are skipped without creating a PodcastEpisode. If the feed
+ * is sorted newest first, parsing stops at the first item outside of the
+ * retention window.
+ */
+class RssStreamParser {
+public:
+    /**
+     * Constructor, takes a snapshot of guids and publication dates of the
+     * episodes, must be called on the thread of the podcast source
+     * @param podcastsource podcast source to update
+     */
+    explicit RssStreamParser(const PodcastSource& podcastsource);
+
+    /**
+     * Parse as much as possible of the document received so far
+     * @param chunk next part of the RSS document
+     */
+    void add_data(const QByteArray& chunk);
+
+    /**
+     * All data has been added, check the document was complete
+     * @return true if the whole document was parsed without XML errors
+     */
+    bool finish();
+
+    /**
+     * Channel information and items parsed since last call
+     * @return update to apply to the podcast source
+     */
+    FeedUpdate take_update();
+
+    /**
+     * The document is not well-formed - remaining data is ignored
+     * @return true after a XML error
+     */
+    bool has_error() const {
+        return failed;
+    }
+
+    /**
+     * Remaining items are older than all episodes kept - the rest of the
+     * document is not needed
+     * @return true if parsing stopped before the end of document
+     */
+    bool stopped_early() const {
+        return done;
+    }
+
+    /**
+     * Number of items skipped because they were known or too old
+     * @return skipped item count
+     */
+    int get_skipped_items() const {
+        return skipped_items;
+    }
+
+private:
+    /**
+     * incremental reader, keeps only unparsed data
+     */
+    QXmlStreamReader xml;
+
+    /**
+     * guids of episodes in podcast source and of new items
+     */
+    QSet<QString> known_guids;
+
+    /**
+     * PodcastSource::get_max_episodes()
+     */
+    size_t max_episodes;
+
+    /**
+     * publication dates of episodes that would be kept by the podcast
+     * source after adding the new items, newest first
+     */
+    std::vector<QDateTime> kept_dates;
+
+    /**
+     * result collected since last \ref take_update
+     */
+    FeedUpdate update;
+
+    /**
+     * publisher and descriptions repeated in all items are kept once
+     */
+    StringPool strings;
+
+    /**
+     * depth of current element in document
+     */
+    int depth = 0;
+
+    /**
+     * depth of <channel> element or -1 outside of a channel
+     */
+    int channel_depth = -1;
+
+    /**
+     * depth of <item> element or -1 outside of an item
+     */
+    int item_depth = -1;
+
+    /**
+     * values of current <item>
+     */
+    FeedItem item;
+
+    /**
+     * current item is known or outside of retention window
+     */
+    bool skip_item = false;
+
+    /**
+     * character data of current element is needed
+     */
+    bool collect_text = true;
+
+    /**
+     * publication date of previous item to detect date sorted feeds
+     */
+    QDateTime previous_date;
+
+    /**
+     * all items so far were sorted newest first
+     */
+    bool date_sorted = true;
+
+    /**
+     * rest of the document is not needed
+     */
+    bool done = false;
+
+    /**
+     * number of known or too old items
+     */
+    int skipped_items = 0;
+
+    /**
+     * character data of current element, may arrive in several tokens
+     */
+    QString text;
+
+    /**
+     * XML error occurred
+     */
+    bool failed = false;
+
+    /**
+     * Read tokens until the reader runs out of data
+     */
+    void parse();
+
+    /**
+     * Handle a start element, elements with attributes are evaluated here
+     */
+    void start_element();
+
+    /**
+     * Handle end element, assign collected text to channel or item
+     */
+    void end_element();
+
+    /**
+     * Check the current item and add it to \ref update
+     */
+    void finish_episode();
+
+    /**
+     * Skip item if an episode with this guid exists
+     * @param guid guid of current item
+     */
+    void check_known(const QString& guid);
+
+    /**
+     * Skip item if it is older than the oldest episode kept,
+     * stop parsing if the feed is sorted newest first
+     */
+    void check_retention();
+};
+
+/**
+ * Apply parsed channel information and add new episodes to podcast source
+ * @param podcastsource podcast source
+ * @param update result of \ref RssStreamParser::take_update
+ */
+void apply_feed_update(PodcastSource& podcastsource, FeedUpdate&& update);
+
 /**
  * parse RSS feed and update podcastsource
  *
  * @param podcastsource podcast source
  * @param data - RSS XML feed from network reply or file or else
+ * @return true if the whole document was parsed without XML errors
  */
-void update_podcast(PodcastSource& podcastsource, const QByteArray& data);
+bool update_podcast(PodcastSource& podcastsource, const QByteArray& data);
 
 };     // namespace DigitalRooster
 
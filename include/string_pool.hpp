@@ -0,0 +1,69 @@
+/******************************************************************************
+ * \filename
+ * \brief Pool of shared strings for values repeated in every episode
+ *
+ * \details Publisher, media URL directory and boilerplate descriptions are
+ *          identical in many items of a feed. Interned strings share one
+ *          implicitly shared QString buffer.
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+
+#ifndef INCLUDE_STRING_POOL_HPP_
+#define INCLUDE_STRING_POOL_HPP_
+
+#include <QSet>
+#include <QString>
+
+namespace DigitalRooster {
+
+/**
+ * Set of strings handing out shared copies, not thread safe
+ */
+class StringPool {
+public:
+    /**
+     * Shared copy of an equal string in the pool, the string is added if
+     * the pool does not contain it yet
+     * @param str value
+     * @return string sharing its buffer with all equal interned strings
+     */
+    QString intern(const QString& str);
+
+    /**
+     * Remove strings only referenced by the pool
+     */
+    void prune();
+
+    /**
+     * Remove all strings
+     */
+    void clear() {
+        strings.clear();
+    }
+
+    /**
+     * Number of distinct strings
+     */
+    int size() const {
+        return strings.size();
+    }
+
+private:
+    QSet<QString> strings;
+};
+
+/**
+ * Split URL in directory (including the last '/') and file name, the
+ * directory is usually shared by all media of a feed
+ * @param url full URL as string
+ * @return position of file name in url
+ */
+int url_file_name_start(const QString& url);
+
+} // namespace DigitalRooster
+
+#endif /* INCLUDE_STRING_POOL_HPP_ */
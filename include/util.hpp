@@ -15,6 +15,7 @@
 
 #include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QThreadPool>
 #include <QUrl>
 #include <QUuid>
 
@@ -51,6 +52,22 @@ QUrl valid_url_from_string(const QString& urlstr);
  */
 QUuid valid_uuid_from_String(const QString& uuidstr);
 
+/**
+ * Bounded thread pool for parsing and file I/O off the GUI thread.
+ * Tasks must not access QObjects owned by the main thread.
+ * @return pool with at most WORKER_POOL_MAX_THREADS threads
+ */
+QThreadPool& worker_pool();
+
+/**
+ * Plain text of an HTML description for display in lists: tags removed,
+ * whitespace collapsed and cut after DESCRIPTION_SUMMARY_LENGTH characters.
+ * Computed once when a feed is parsed or a cache is read.
+ * @param html description as found in the feed
+ * @return plain text
+ */
+QString description_summary(const QString& html);
+
 
 } // namespace DigitalRooster
 #endif /* INCLUDE_UTIL_HPP_ */
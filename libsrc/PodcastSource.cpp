@@ -14,6 +14,7 @@
 #include "appconstants.hpp"
 #include "httpclient.hpp"
 #include "podcast_serializer.hpp"
+#include "position_journal.hpp"
 #include "util.hpp"
 
 using namespace DigitalRooster;
@@ -44,46 +45,146 @@ PodcastSource::~PodcastSource() {
 void PodcastSource::add_episode(
     const std::shared_ptr<PodcastEpisode>& episode) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO << episode->get_guid();
-    auto ep = get_episode_by_id(episode->get_guid());
-    /* If episode already in list - skip it */
-    if (ep) {
-        qCDebug(CLASS_LC) << episode->get_guid() << "already in list";
+    add_episodes({episode});
+}
+
+/*****************************************************************************/
+void PodcastSource::add_episodes(
+    std::vector<std::shared_ptr<PodcastEpisode>> new_episodes) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << new_episodes.size();
+    std::vector<EpisodeRecord> records;
+    records.reserve(new_episodes.size());
+    QHash<QString, std::shared_ptr<PodcastEpisode>> by_guid;
+    for (const auto& episode : new_episodes) {
+        /* first of two episodes with the same guid wins like in merge */
+        if (!by_guid.contains(episode->get_guid())) {
+            by_guid.insert(episode->get_guid(), episode);
+        }
+        records.push_back(record_from_episode(*episode));
+    }
+    auto result = episode_store.merge(std::move(records), max_episodes);
+    /* caller keeps using its objects, they represent the new rows */
+    for (const auto& guid : result.inserted) {
+        attach_episode(episode_store.row_of(guid), by_guid.value(guid));
+    }
+    notify_merge(result);
+}
+
+/*****************************************************************************/
+void PodcastSource::add_episode_records(std::vector<EpisodeRecord> records) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << records.size();
+    notify_merge(episode_store.merge(std::move(records), max_episodes));
+}
+
+/*****************************************************************************/
+void PodcastSource::notify_merge(const EpisodeStore::MergeResult& result) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto inserted = static_cast<int>(result.inserted.size());
+    if (inserted == 0 && result.removed == 0) {
         return;
     }
-    // Only add if still space left or if episode more recent than oldest
-    // episode
-    // For an empty vector episodes.size() <= max_episodes holds true
-    // otherwise episodes.back() is guaranteed to have a value
-    if (episodes.size() <= max_episodes or
-        episodes.back()->get_publication_date() <
-            episode->get_publication_date()) {
-        // insert sorted by publication date
-        auto iterator =
-            std::lower_bound(episodes.begin(), episodes.end(), episode,
-                [](const std::shared_ptr<PodcastEpisode>& lhs,
-                    const std::shared_ptr<PodcastEpisode>& rhs) {
-                    return lhs->get_publication_date() >
-                        rhs->get_publication_date();
-                });
-        episodes.insert(iterator, episode);
-        /* Remove oldest episode if max episodes has been reached */
-        if (episodes.size() > max_episodes) {
-            qCDebug(CLASS_LC) << "max episodes reached, removing";
-            episodes.pop_back();
-        }
+    qCDebug(CLASS_LC) << "inserted" << inserted << "removed" << result.removed;
+    if (inserted > 0) {
+        restore_positions();
     }
+    emit episodes_changed(inserted, result.removed);
+    emit episodes_count_changed(episode_store.size());
+}
+
+/*****************************************************************************/
+void PodcastSource::attach_episode(
+    int row, const std::shared_ptr<PodcastEpisode>& episode) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << row;
+    episode_store.set_facade(row, episode);
+    auto raw = episode.get();
+    /* episode may have been attached before it was dropped or purged */
+    raw->disconnect(this);
     /* get notified if any data changes */
-    connect(episode.get(), &PodcastEpisode::data_changed, this,
-        &PodcastSource::episode_info_changed);
-    emit episodes_count_changed(episodes.size());
+    connect(raw, &PodcastEpisode::data_changed, this, [this, raw]() {
+        auto r = episode_store.row_of(raw->get_guid());
+        /* episode was dropped or is represented by another object */
+        if (r < 0 || episode_store.facade(r).get() != raw) {
+            return;
+        }
+        episode_store.update(r, record_from_episode(*raw));
+        episode_info_changed();
+    });
+    /* position ticks of the player only go to the journal */
+    connect(raw, &PodcastEpisode::position_updated, this,
+        [this, raw](qint64 position) {
+            auto r = episode_store.row_of(raw->get_guid());
+            if (r < 0 || episode_store.facade(r).get() != raw) {
+                return;
+            }
+            episode_store.set_position(r, position);
+            if (position_journal) {
+                position_journal->record(
+                    raw->get_guid(), position, episode_store.listened(r));
+            }
+        });
+    /* summary is only computed again if the description changes */
+    connect(raw, &PodcastEpisode::description_changed, this,
+        [this, raw](const QString& desc) {
+            auto r = episode_store.row_of(raw->get_guid());
+            if (r < 0 || episode_store.facade(r).get() != raw) {
+                return;
+            }
+            episode_store.set_description(r, desc);
+        });
 }
 
 /*****************************************************************************/
 void PodcastSource::set_update_interval(std::chrono::seconds interval) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* RefreshScheduler uses the new interval for the next refresh */
     update_interval = interval;
-    if (updater != nullptr) {
-        updater->set_update_interval(interval);
+}
+
+/*****************************************************************************/
+void PodcastSource::set_max_update_interval(std::chrono::seconds interval) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    max_update_interval = interval;
+}
+
+/*****************************************************************************/
+void PodcastSource::set_learned_update_interval(
+    std::chrono::seconds interval, int unchanged) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    learned_update_interval = std::max(interval, std::chrono::seconds(0));
+    unchanged_refreshes = std::max(unchanged, 0);
+}
+
+/*****************************************************************************/
+std::chrono::seconds PodcastSource::get_effective_update_interval() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (learned_update_interval.count() <= 0) {
+        return update_interval;
+    }
+    /* bounds may have changed in the configuration since learning */
+    return std::clamp(learned_update_interval, update_interval,
+        std::max(update_interval, max_update_interval));
+}
+
+/*****************************************************************************/
+void PodcastSource::record_refresh(bool new_episodes) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << new_episodes;
+    auto unchanged = new_episodes ? 0 : unchanged_refreshes + 1;
+    std::vector<QDateTime> dates;
+    for (int row = 0; row < episode_store.size(); row++) {
+        auto date = episode_store.publication_date(row);
+        if (date.isValid()) {
+            dates.push_back(date);
+        }
+    }
+    auto interval = adaptive_update_interval(dates, unchanged,
+        QDateTime::currentDateTime(), update_interval, max_update_interval);
+    qCDebug(CLASS_LC) << "next refresh in" << interval.count() << "s";
+    /* both are cached, the counter keeps backing off after a restart */
+    if (interval != learned_update_interval ||
+        unchanged != unchanged_refreshes) {
+        learned_update_interval = interval;
+        unchanged_refreshes = unchanged;
+        emit dataChanged();
     }
 }
 
@@ -91,6 +192,7 @@ void PodcastSource::set_update_interval(std::chrono::seconds interval) {
 void PodcastSource::set_description(const QString& newVal) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     description = newVal;
+    description_summary = DigitalRooster::description_summary(newVal);
     emit descriptionChanged();
     emit dataChanged();
 }
@@ -108,6 +210,26 @@ void PodcastSource::set_link(const QUrl& newVal) {
     emit dataChanged();
 }
 
+/*****************************************************************************/
+void PodcastSource::set_http_validators(
+    const QString& etag, const QString& last_modified) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (etag != http_etag || last_modified != http_last_modified) {
+        http_etag = etag;
+        http_last_modified = last_modified;
+        emit dataChanged();
+    }
+}
+
+/*****************************************************************************/
+UpdateStatistics PodcastSource::get_update_statistics() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (updater) {
+        return updater->get_statistics();
+    }
+    return UpdateStatistics();
+}
+
 /*****************************************************************************/
 void PodcastSource::set_max_episodes(int max) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
@@ -119,6 +241,19 @@ void PodcastSource::set_max_episodes(int max) {
     }
 }
 
+/*****************************************************************************/
+void PodcastSource::set_offline_episodes(int count) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << count;
+    if (count < 0) {
+        QString what(KEY_OFFLINE_EPISODES + "< 0 is not allowed!");
+        throw std::invalid_argument(what.toStdString());
+    }
+    if (offline_episodes != count) {
+        offline_episodes = count;
+        emit offline_episodes_changed(count);
+    }
+}
+
 /*****************************************************************************/
 void PodcastSource::set_title(const QString& newTitle) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
@@ -145,7 +280,8 @@ void PodcastSource::set_update_task(std::unique_ptr<UpdateTask>&& ut) {
     updater = std::move(ut);
     // make sure updater is not constructed with another podcastsource
     updater->set_podcast_source(this);
-    updater->set_update_interval(update_interval);
+    connect(updater.get(), &UpdateTask::finished, this,
+        &PodcastSource::update_finished);
 }
 
 /*****************************************************************************/
@@ -159,12 +295,49 @@ void PodcastSource::set_serializer(std::unique_ptr<PodcastSerializer>&& pser) {
         &PodcastSerializer::delayed_write);
 }
 
+/*****************************************************************************/
+void PodcastSource::set_position_journal(
+    std::shared_ptr<PositionJournal> journal) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    position_journal = std::move(journal);
+    restore_positions();
+}
+
+/*****************************************************************************/
+void PodcastSource::restore_positions() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (!position_journal) {
+        return;
+    }
+    for (int row = 0; row < episode_store.size(); row++) {
+        auto entry = position_journal->entry(episode_store.guid(row));
+        if (entry.position < 0) {
+            continue;
+        }
+        auto episode = episode_store.facade(row);
+        /* journal is written after the cache, its position is newer */
+        if (entry.position != episode_store.position(row)) {
+            episode_store.set_position(row, entry.position);
+            if (episode) {
+                episode->set_position(entry.position);
+            }
+        }
+        /* listened before, possibly played again from the start */
+        if (entry.listened && !episode_store.listened(row)) {
+            episode_store.set_listened(row);
+            if (episode) {
+                episode->set_listened();
+            }
+        }
+    }
+}
+
 /*****************************************************************************/
 std::vector<QString> PodcastSource::get_episodes_names() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     auto ret = std::vector<QString>();
-    for (const auto& e : episodes) {
-        ret.push_back(e->get_display_name());
+    for (int row = 0; row < episode_store.size(); row++) {
+        ret.push_back(episode_store.display_name(row));
     }
     return ret;
 }
@@ -172,7 +345,17 @@ std::vector<QString> PodcastSource::get_episodes_names() {
 /*****************************************************************************/
 void PodcastSource::refresh() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    updater->start();
+    if (updater) {
+        updater->start();
+    }
+}
+
+/*****************************************************************************/
+void PodcastSource::abort_refresh() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (updater) {
+        updater->abort();
+    }
 }
 
 /*****************************************************************************/
@@ -193,8 +376,11 @@ void PodcastSource::purge_icon_cache() {
 /*****************************************************************************/
 void PodcastSource::purge_episodes() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    episodes.clear();
-    emit episodes_count_changed(episodes.size());
+    episode_store.clear();
+    /* next update has to download the complete feed again */
+    http_etag.clear();
+    http_last_modified.clear();
+    emit episodes_count_changed(episode_store.size());
 }
 
 /*****************************************************************************/
@@ -216,38 +402,52 @@ void PodcastSource::episode_info_changed() {
 
 /*****************************************************************************/
 std::shared_ptr<PodcastEpisode> PodcastSource::get_episode_by_id(
-    const QString& id) const {
+    const QString& id) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     return get_episode_by_id_impl(id);
 }
 
 /*****************************************************************************/
 std::shared_ptr<PodcastEpisode> PodcastSource::get_episode_by_id_impl(
-    const QString& id) const {
+    const QString& id) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    auto ep = std::find_if(episodes.begin(), episodes.end(),
-        [id](const std::shared_ptr<PodcastEpisode>& episode) {
-            return episode->get_guid() == id;
-        });
+    if (!episode_store.contains(id)) {
+        qCDebug(CLASS_LC) << id << "not in store";
+        return std::shared_ptr<PodcastEpisode>();
+    }
+    return get_episode(episode_store.row_of(id));
+}
 
-    if (ep == episodes.end()) {
-        qCDebug(CLASS_LC) << id << "not in vector";
+/*****************************************************************************/
+std::shared_ptr<PodcastEpisode> PodcastSource::get_episode(int row) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << row;
+    if (row < 0 || row >= episode_store.size()) {
         return std::shared_ptr<PodcastEpisode>();
     }
-    return *ep;
+    auto episode = episode_store.facade(row);
+    if (!episode) {
+        episode = episode_store.create_episode(row);
+        attach_episode(row, episode);
+    }
+    return episode;
 }
 
 /*****************************************************************************/
-const std::vector<std::shared_ptr<PodcastEpisode>>&
-PodcastSource::get_episodes_impl() const {
+std::vector<std::shared_ptr<PodcastEpisode>>
+PodcastSource::get_episodes_impl() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    std::vector<std::shared_ptr<PodcastEpisode>> episodes;
+    episodes.reserve(episode_store.size());
+    for (int row = 0; row < episode_store.size(); row++) {
+        episodes.push_back(get_episode(row));
+    }
     return episodes;
 }
 
 /*****************************************************************************/
 int DigitalRooster::PodcastSource::get_episode_count_impl() const {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    return get_episodes().size();
+    return episode_store.size();
 }
 
 /*****************************************************************************/
@@ -279,7 +479,7 @@ void PodcastSource::set_image_file_path(const QString& path) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     /* clean previous cache file */
     QFile oldfile(image_file_path);
-    if (oldfile.exists()) {
+    if (path != image_file_path && oldfile.exists()) {
         oldfile.remove();
     }
 
@@ -292,6 +492,13 @@ void PodcastSource::set_image_file_path(const QString& path) {
 void PodcastSource::trigger_image_download() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     if (!icon_url.isEmpty() && serializer) {
+        /* every icon_changed makes QML ask again while downloading */
+        if (icon_downloader && icon_downloader->is_busy() &&
+            icon_download_url == icon_url) {
+            qCDebug(CLASS_LC) << "icon download already running";
+            return;
+        }
+        icon_download_url = icon_url;
         icon_downloader = std::make_unique<HttpClient>();
         download_cnx =
             connect(icon_downloader.get(), &HttpClient::dataAvailable,
@@ -306,6 +513,8 @@ QUrl PodcastSource::get_icon_impl() {
     /* If we find a cache file, return it, otherwise the url must do */
     if (QFile(image_file_path).exists()) {
         qCDebug(CLASS_LC) << "found cached icon:" << image_file_path;
+        /* recently used icons are not evicted */
+        touch_icon(image_file_path);
         return QUrl::fromLocalFile(image_file_path);
     } else {
         qCDebug(CLASS_LC) << "start download for icon cache:";
@@ -344,9 +553,18 @@ std::shared_ptr<PodcastSource> PodcastSource::from_json_object(
     } catch (const std::invalid_argument& exc) {
         qCWarning(CLASS_LC) << exc.what() << "- will use default";
     }
+    try {
+        ps->set_offline_episodes(json[KEY_OFFLINE_EPISODES].toInt(
+            DEFAULT_OFFLINE_EPISODES));
+    } catch (const std::invalid_argument& exc) {
+        qCWarning(CLASS_LC) << exc.what() << "- will use default";
+    }
     ps->set_update_interval(
-        std::chrono::seconds(json[KEY_UPDATE_INTERVAL].toInt(3600)));
-    ps->set_update_task(std::make_unique<UpdateTask>(ps.get()));
+        std::chrono::seconds(json[KEY_UPDATE_INTERVAL].toInt(
+            static_cast<int>(DEFAULT_UPDATE_INTERVAL.count()))));
+    ps->set_max_update_interval(
+        std::chrono::seconds(json[KEY_MAX_UPDATE_INTERVAL].toInt(
+            static_cast<int>(DEFAULT_MAX_UPDATE_INTERVAL.count()))));
     return ps;
 }
 
@@ -358,9 +576,49 @@ QJsonObject PodcastSource::to_json_object() const {
     json[KEY_URI] = get_url().toString();
     json[JSON_KEY_TITLE] = get_title();
     json[KEY_MAX_EPISODES] = static_cast<qint64>(max_episodes);
+    json[KEY_OFFLINE_EPISODES] = offline_episodes;
     json[KEY_UPDATE_INTERVAL] =
         static_cast<qint64>(get_update_interval().count());
+    json[KEY_MAX_UPDATE_INTERVAL] =
+        static_cast<qint64>(get_max_update_interval().count());
     return json;
 }
 
 /*****************************************************************************/
+
+/*****************************************************************************/
+std::chrono::seconds DigitalRooster::adaptive_update_interval(
+    const std::vector<QDateTime>& publication_dates, int unchanged_refreshes,
+    const QDateTime& now, std::chrono::seconds min_interval,
+    std::chrono::seconds max_interval) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    max_interval = std::max(min_interval, max_interval);
+    /* median of the most recent gaps, robust against a single special */
+    std::vector<qint64> gaps;
+    auto samples = std::min<size_t>(
+        publication_dates.size(), FEED_CADENCE_SAMPLES + 1);
+    for (size_t i = 1; i < samples; i++) {
+        auto gap = publication_dates[i].secsTo(publication_dates[i - 1]);
+        if (gap > 0) {
+            gaps.push_back(gap);
+        }
+    }
+    if (gaps.size() < 2) {
+        return min_interval;
+    }
+    std::nth_element(gaps.begin(), gaps.begin() + gaps.size() / 2, gaps.end());
+    auto cadence = gaps[gaps.size() / 2];
+
+    auto expected = publication_dates.front().addSecs(cadence);
+    qint64 wait = 0;
+    if (now < expected) {
+        wait = now.secsTo(expected) + FEED_RELEASE_GRACE.count();
+    } else if (expected.secsTo(now) < cadence) {
+        /* release is due, look a few times */
+        wait = cadence / 8;
+    } else {
+        /* feed stalled, slow down with each unchanged refresh */
+        wait = (cadence / 8) << std::min(std::max(unchanged_refreshes, 0), 6);
+    }
+    return std::clamp(std::chrono::seconds(wait), min_interval, max_interval);
+}
@@ -4,11 +4,15 @@
  * Licensed under GNU PUBLIC LICENSE Version 3 or later
  */
 
+#include <QDateTime>
 #include <QLoggingCategory>
+#include <QNetworkRequest>
+#include <QtConcurrent>
 
 #include "PodcastSource.hpp"
 #include "UpdateTask.hpp"
 #include "rss2podcastsource.hpp"
+#include "util.hpp"
 
 using namespace DigitalRooster;
 static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.UpdateTask");
@@ -18,43 +22,225 @@ static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.UpdateTask");
 UpdateTask::UpdateTask(PodcastSource* source)
     : ps(source) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* parse RSS while downloading */
+    dlm.set_streaming(true);
+    /* refreshes can wait while media is playing */
+    dlm.set_priority(RequestPriority::Background);
     connect(&dlm, &HttpClient::dataAvailable, this, &UpdateTask::dataAvailable);
+    connect(
+        &dlm, &HttpClient::chunkAvailable, this, &UpdateTask::chunkAvailable);
+    connect(
+        &dlm, &HttpClient::streamFinished, this, &UpdateTask::streamFinished);
+    connect(&dlm, &HttpClient::notModified, this, &UpdateTask::notModified);
+    connect(&dlm, &HttpClient::validatorsAvailable, this,
+        &UpdateTask::validatorsAvailable);
+    connect(&parse_watcher, &QFutureWatcher<void>::finished, this,
+        &UpdateTask::parseFinished);
+}
 
-    // Start timer
-    timer.setSingleShot(false);
-    connect(&timer, &QTimer::timeout, this, &UpdateTask::start);
-    if (ps) {
-        timer.start(source->get_update_interval());
-    }
-    // initial download immediately
-    start();
+/*****************************************************************************/
+UpdateTask::~UpdateTask() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* no more chunks for a parser of a destroyed task */
+    dlm.disconnect(this);
+    /* a running job keeps its parser alive, nothing else is shared */
+    parse_watcher.disconnect(this);
 }
 
 /*****************************************************************************/
 
 void UpdateTask::dataAvailable(const QByteArray& data) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    update_podcast(*ps, data);
+    if (!ps) {
+        statistics.downloads++;
+        statistics.bytes_downloaded += data.size();
+        last_document_size = data.size();
+        return;
+    }
+    /* complete document, same as a stream with a single chunk */
+    if (!parser) {
+        reset_parser();
+        parser = std::make_shared<RssStreamParser>(*ps);
+    }
+    chunkAvailable(data);
+    streamFinished(true);
 }
 
+/*****************************************************************************/
+void UpdateTask::chunkAvailable(const QByteArray& chunk) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    statistics.bytes_downloaded += chunk.size();
+    current_document_size += chunk.size();
+    if (parser && !stream_ended) {
+        pending_data.append(chunk);
+        schedule_parse();
+    }
+}
 
 /*****************************************************************************/
-void UpdateTask::set_podcast_source(PodcastSource* ps) {
+void UpdateTask::streamFinished(bool success) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    this->ps = ps;
+    if (!parser) {
+        return;
+    }
+    /* chunks still queued are parsed before the update is finished */
+    stream_ended = true;
+    stream_complete = success;
+    schedule_parse();
+}
+
+/*****************************************************************************/
+void UpdateTask::schedule_parse() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (!parser || parse_watcher.isRunning()) {
+        /* parseFinished() will call again */
+        return;
+    }
+    if (pending_data.isEmpty()) {
+        if (stream_ended) {
+            finish_update();
+        }
+        return;
+    }
+    auto data = std::move(pending_data);
+    pending_data = QByteArray();
+    job_parser = parser;
+    auto job = job_parser;
+    parse_watcher.setFuture(QtConcurrent::run(
+        &worker_pool(), [job, data]() { job->add_data(data); }));
 }
 
 /*****************************************************************************/
+void UpdateTask::parseFinished() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto finished_parser = std::move(job_parser);
+    /* results of a parser of an aborted download are dropped */
+    if (finished_parser && finished_parser == parser && ps) {
+        auto update = parser->take_update();
+        new_items += update.items.size();
+        apply_feed_update(*ps, std::move(update));
+        if (parser->stopped_early() && !stream_ended) {
+            /* remaining items are older than all episodes we keep */
+            dlm.abort();
+            pending_data.clear();
+            stream_ended = true;
+            stream_complete = true;
+        }
+    }
+    schedule_parse();
+}
 
-void UpdateTask::start() {
+/*****************************************************************************/
+void UpdateTask::finish_update() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto finished_parser = std::move(parser);
+    auto success = stream_complete;
+    auto new_episodes = new_items > 0;
+    reset_parser();
+    if (!success) {
+        /* episodes parsed so far are fine, validators stay as they were */
+        emit finished(false);
+        return;
+    }
+    statistics.downloads++;
+    last_document_size = current_document_size;
+    auto complete = finished_parser->finish();
+    if (complete) {
+        ps->set_last_updated(QDateTime::currentDateTime());
+        ps->record_refresh(new_episodes);
+    }
+    store_validators(complete);
+    emit finished(complete);
+}
+
+/*****************************************************************************/
+void UpdateTask::abort() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* aborted downloads are not reported, running parse jobs are dropped */
+    dlm.abort();
+    reset_parser();
+}
+
+/*****************************************************************************/
+void UpdateTask::reset_parser() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    parser.reset();
+    pending_data.clear();
+    stream_ended = false;
+    stream_complete = false;
+    new_items = 0;
+}
+
+/*****************************************************************************/
+void UpdateTask::store_validators(bool complete) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* only remember validators if we actually have the content */
+    if (complete) {
+        ps->set_http_validators(QString::fromLatin1(response_etag),
+            QString::fromLatin1(response_last_modified));
+    } else {
+        ps->set_http_validators(QString(), QString());
+    }
+}
+
+/*****************************************************************************/
+void UpdateTask::notModified() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    statistics.not_modified++;
+    statistics.bytes_saved += last_document_size;
+    reset_parser();
     if (ps) {
-        dlm.doDownload(ps->get_url());
+        ps->set_last_updated(QDateTime::currentDateTime());
+        ps->record_refresh(false);
+    }
+    emit finished(true);
+}
+
+/*****************************************************************************/
+void UpdateTask::validatorsAvailable(
+    const QByteArray& etag, const QByteArray& last_modified) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    response_etag = etag;
+    response_last_modified = last_modified;
+}
+
+
+/*****************************************************************************/
+void UpdateTask::set_podcast_source(PodcastSource* ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* parser of running download refers to the previous source */
+    if (this->ps != ps) {
+        dlm.abort();
+        reset_parser();
     }
+    this->ps = ps;
 }
 
 /*****************************************************************************/
-void UpdateTask::set_update_interval(std::chrono::seconds interval) {
+
+void UpdateTask::start() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    timer.start(interval);
+    if (ps) {
+        /* a new request supersedes the one in progress */
+        dlm.abort();
+        reset_parser();
+        parser = std::make_shared<RssStreamParser>(*ps);
+        current_document_size = 0;
+        QNetworkRequest request(ps->get_url());
+        /* feeds are revalidated with the validators of the podcast cache,
+         * keep them out of the HTTP disk cache */
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+            QNetworkRequest::AlwaysNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+        if (!ps->get_http_etag().isEmpty()) {
+            request.setRawHeader(
+                "If-None-Match", ps->get_http_etag().toLatin1());
+        }
+        if (!ps->get_http_last_modified().isEmpty()) {
+            request.setRawHeader(
+                "If-Modified-Since", ps->get_http_last_modified().toLatin1());
+        }
+        statistics.requests++;
+        dlm.doDownload(request);
+    }
 }
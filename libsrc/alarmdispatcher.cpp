@@ -11,6 +11,7 @@
 #include "IAlarmStore.hpp"
 #include "alarm.hpp"
 #include "alarmdispatcher.hpp"
+#include "appconstants.hpp"
 #include "timeprovider.hpp"
 
 using namespace DigitalRooster;
@@ -22,10 +23,13 @@ static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.AlarmDispatcher");
 
 AlarmDispatcher::AlarmDispatcher(IAlarmStore& store, QObject* parent)
     : QObject(parent)
-    , config(store) {
+    , config(store)
+    , prewarm_time(ALARM_PREWARM_TIME) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     timer.setSingleShot(true);
     connect(&timer, &QTimer::timeout, this, &AlarmDispatcher::trigger);
+    prewarm_timer.setSingleShot(true);
+    connect(&prewarm_timer, &QTimer::timeout, this, &AlarmDispatcher::prewarm);
     /* make sure alarms are updated and timer started */
     check_alarms();
 }
@@ -38,12 +42,36 @@ void AlarmDispatcher::check_alarms() {
     if (!upcoming_alarm || !upcoming_alarm->is_enabled()) {
         emit upcoming_alarm_info_changed("");
         timer.stop();
+        prewarm_timer.stop();
     } else {
         auto alm_dt = get_next_instance(*upcoming_alarm);
         emit upcoming_alarm_info_changed(alm_dt.toString("ddd hh:mm"));
         auto delta =
             alm_dt.toMSecsSinceEpoch() - wallclock->now().toMSecsSinceEpoch();
         timer.start(delta);
+        /* too late to prepare, the alarm starts without pre-buffering */
+        auto lead = delta - prewarm_time.count();
+        if (prewarm_time.count() > 0 && lead > 0) {
+            prewarm_timer.start(lead);
+        } else {
+            prewarm_timer.stop();
+        }
+    }
+}
+
+/*****************************************************************************/
+void AlarmDispatcher::set_prewarm_time(std::chrono::milliseconds lead) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << lead.count();
+    prewarm_time = lead;
+    emit prewarm_time_changed(lead);
+    check_alarms();
+}
+
+/*****************************************************************************/
+void AlarmDispatcher::prewarm() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (upcoming_alarm && upcoming_alarm->is_enabled()) {
+        emit alarm_pending(upcoming_alarm.get());
     }
 }
 
@@ -28,6 +28,14 @@ AlarmMonitor::AlarmMonitor(MediaPlayer& player,
         static_cast<void (MediaPlayer::*)(QMediaPlayer::Error)>(
             &MediaPlayer::error),
         [&](QMediaPlayer::Error error) {
+            if (error != QMediaPlayer::NoError && state == PreArmed) {
+                /* nothing left to try if all candidates failed */
+                if (candidate < candidates.size()) {
+                    qCWarning(CLASS_LC) << "player error while pre-buffering";
+                    prewarm_next();
+                }
+                return;
+            }
             /* if any error occurs while we are expecting or playing an alarm */
             if (error != QMediaPlayer::NoError &&
                 fallback_alarm_timer.isActive()) {
@@ -52,12 +60,64 @@ AlarmMonitor::AlarmMonitor(MediaPlayer& player,
                 << "fallback_alarm_timer elapsed without player error!";
             set_state(Idle);
         });
+
+    QObject::connect(&mpp, &MediaPlayer::playback_state_changed, this,
+        &AlarmMonitor::playback_state_changed);
+
+    /* Candidate or pre-buffered alarm did not play in time */
+    deadline_timer.setSingleShot(true);
+    QObject::connect(&deadline_timer, &QTimer::timeout, [&]() {
+        if (state == PreArmed) {
+            qCWarning(CLASS_LC) << "alarm source did not start in time";
+            prewarm_next();
+        } else if (state == Armed &&
+            mpp.playback_state() != QMediaPlayer::PlayingState) {
+            qCWarning(CLASS_LC) << "pre-buffered alarm did not start in time";
+            trigger_fallback_behavior();
+        }
+    });
+
+    /* Alarm was not triggered after pre-arming, e.g. it was disabled */
+    prearm_expiry_timer.setSingleShot(true);
+    set_prewarm_time(ALARM_PREWARM_TIME);
+    QObject::connect(&prearm_expiry_timer, &QTimer::timeout, [&]() {
+        if (state == PreArmed) {
+            qCInfo(CLASS_LC) << "pending alarm did not trigger";
+            cancel_prearm();
+        }
+    });
+
+    /* User selected other media while buffering silently */
+    QObject::connect(&mpp, &MediaPlayer::media_changed, this, [&]() {
+        if (state == PreArmed && !switching_media) {
+            qCInfo(CLASS_LC) << "user changed media while pre-arming";
+            release_player();
+        }
+    });
+}
+
+/*****************************************************************************/
+void AlarmMonitor::set_prewarm_time(std::chrono::milliseconds lead) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << lead.count();
+    prearm_expiry_timer.setInterval(lead + ALARM_PREWARM_DEADLINE);
+}
+
+/*****************************************************************************/
+void AlarmMonitor::set_alternative_sources(
+    const std::vector<std::shared_ptr<PlayableItem>>& sources) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << sources.size();
+    alternatives = sources;
 }
 
 /*****************************************************************************/
 void AlarmMonitor::stop() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     fallback_alarm_timer.stop();
+    deadline_timer.stop();
+    measuring = false;
+    if (state == PreArmed) {
+        cancel_prearm();
+    }
     set_state(Idle);
 }
 
@@ -70,6 +130,28 @@ void AlarmMonitor::set_state(MonitorState next_state) {
 /*****************************************************************************/
 void AlarmMonitor::alarm_triggered(const DigitalRooster::Alarm* alarm) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    triggered_at = std::chrono::steady_clock::now();
+    measuring = true;
+    if (state == PreArmed && alarm->get_id() == pending_alarm) {
+        prearm_expiry_timer.stop();
+        deadline_timer.stop();
+        set_state(Armed);
+        mpp.set_volume(alarm->get_volume());
+        mpp.set_muted(false);
+        if (candidate >= candidates.size()) {
+            qCWarning(CLASS_LC) << "no alarm source available";
+            trigger_fallback_behavior();
+            return;
+        }
+        /* resume the paused or still connecting candidate */
+        deadline_timer.start(ALARM_START_DEADLINE);
+        fallback_alarm_timer.start(timeout);
+        mpp.play();
+        return;
+    }
+    if (state == PreArmed) {
+        cancel_prearm();
+    }
     set_state(Armed);
     mpp.set_media(alarm->get_media());
     mpp.set_volume(alarm->get_volume());
@@ -80,6 +162,10 @@ void AlarmMonitor::alarm_triggered(const DigitalRooster::Alarm* alarm) {
 /*****************************************************************************/
 void AlarmMonitor::trigger_fallback_behavior() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    deadline_timer.stop();
+    if (mpp.muted()) {
+        mpp.set_muted(false);
+    }
     fallback_alarm.setCurrentIndex(0);
     set_state(FallBackMode);
     mpp.set_volume(DEFAULT_FALLBACK_VOLUME);
@@ -88,3 +174,99 @@ void AlarmMonitor::trigger_fallback_behavior() {
 }
 
 /*****************************************************************************/
+void AlarmMonitor::alarm_pending(const DigitalRooster::Alarm* alarm) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (state != Idle) {
+        return;
+    }
+    if (mpp.playback_state() == QMediaPlayer::PlayingState) {
+        qCInfo(CLASS_LC) << "player busy, alarm starts without pre-buffering";
+        return;
+    }
+    pending_alarm = alarm->get_id();
+    candidates.clear();
+    candidates.push_back(alarm->get_media());
+    candidates.insert(
+        candidates.end(), alternatives.begin(), alternatives.end());
+    candidate = 0;
+    set_state(PreArmed);
+    prearm_expiry_timer.start();
+    mpp.set_muted(true);
+    prewarm_candidate();
+}
+
+/*****************************************************************************/
+void AlarmMonitor::prewarm_candidate() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << candidate;
+    prewarmed = false;
+    if (candidate >= candidates.size()) {
+        /* alarm_triggered plays the fallback sound right away */
+        qCWarning(CLASS_LC) << "no alarm source could be buffered";
+        deadline_timer.stop();
+        mpp.stop();
+        return;
+    }
+    deadline_timer.start(ALARM_PREWARM_DEADLINE);
+    switching_media = true;
+    mpp.set_media(candidates[candidate]);
+    switching_media = false;
+    mpp.play();
+}
+
+/*****************************************************************************/
+void AlarmMonitor::prewarm_next() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    candidate++;
+    prewarm_candidate();
+}
+
+/*****************************************************************************/
+void AlarmMonitor::cancel_prearm() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* stopped before it is unmuted */
+    mpp.stop();
+    release_player();
+}
+
+/*****************************************************************************/
+void AlarmMonitor::release_player() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    deadline_timer.stop();
+    prearm_expiry_timer.stop();
+    candidates.clear();
+    prewarmed = false;
+    mpp.set_muted(false);
+    set_state(Idle);
+}
+
+/*****************************************************************************/
+void AlarmMonitor::playback_state_changed(QMediaPlayer::State player_state) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << player_state;
+    if (player_state != QMediaPlayer::PlayingState) {
+        return;
+    }
+    if (state == PreArmed) {
+        /* buffered media is paused until the alarm, the user resumed it */
+        if (prewarmed) {
+            qCInfo(CLASS_LC) << "user started playback while pre-arming";
+            release_player();
+            return;
+        }
+        if (candidate < candidates.size()) {
+            /* connected and buffered, hold it until the alarm is due */
+            qCInfo(CLASS_LC) << "alarm source" << candidate << "ready";
+            prewarmed = true;
+            deadline_timer.stop();
+            mpp.pause();
+        }
+        return;
+    }
+    if (measuring) {
+        measuring = false;
+        deadline_timer.stop();
+        start_latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - triggered_at);
+        qCInfo(CLASS_LC) << "alarm started after" << start_latency.count()
+                         << "ms";
+    }
+}
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <utility>
+
+#include "cache_writer.hpp"
+#include "podcast_serializer.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.CacheWriter");
+
+/*****************************************************************************/
+CacheWriter::CacheWriter(std::chrono::milliseconds delay, QObject* parent)
+    : QObject(parent) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    io_thread.setMaxThreadCount(1);
+    batch_timer.setSingleShot(true);
+    batch_timer.setInterval(delay);
+    connect(&batch_timer, &QTimer::timeout, this, &CacheWriter::write_batch);
+}
+
+/*****************************************************************************/
+CacheWriter::~CacheWriter() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    batch_timer.stop();
+    wait();
+}
+
+/*****************************************************************************/
+void CacheWriter::schedule(PodcastSerializer* serializer) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    dirty.insert(serializer);
+    /* the delay is counted from the first change, not the last */
+    if (!batch_timer.isActive()) {
+        batch_timer.start();
+    }
+}
+
+/*****************************************************************************/
+void CacheWriter::cancel(PodcastSerializer* serializer) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    dirty.remove(serializer);
+}
+
+/*****************************************************************************/
+void CacheWriter::write_batch() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << dirty.size();
+    batch_timer.stop();
+    /* write() may schedule again, e.g. if the source changes meanwhile */
+    auto batch = std::move(dirty);
+    dirty.clear();
+    for (auto* serializer : batch) {
+        serializer->write();
+    }
+}
+
+/*****************************************************************************/
+void CacheWriter::submit(const QString& file_path, PodcastCache cache) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << file_path;
+    bool start = false;
+    {
+        QMutexLocker lock(&mutex);
+        if (!queued.contains(file_path)) {
+            queue.push_back(file_path);
+            pending++;
+        }
+        /* a newer snapshot replaces one that was not written yet */
+        queued.insert(file_path, std::move(cache));
+        if (!draining) {
+            draining = true;
+            start = true;
+        }
+    }
+    if (start) {
+        drain_task = QtConcurrent::run(&io_thread, [this]() { drain(); });
+    }
+}
+
+/*****************************************************************************/
+void CacheWriter::discard(const QString& file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << file_path;
+    bool running = false;
+    {
+        QMutexLocker lock(&mutex);
+        if (queued.remove(file_path) > 0) {
+            queue.erase(std::remove(queue.begin(), queue.end(), file_path),
+                queue.end());
+            pending--;
+        }
+        running = (writing == file_path);
+    }
+    if (running) {
+        wait();
+    }
+}
+
+/*****************************************************************************/
+void CacheWriter::wait() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    drain_task.waitForFinished();
+}
+
+/*****************************************************************************/
+void CacheWriter::flush() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    write_batch();
+    wait();
+    qCInfo(CLASS_LC) << "cache files written:" << files << "bytes:" << bytes;
+}
+
+/*****************************************************************************/
+void CacheWriter::drain() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    while (true) {
+        PodcastCache cache;
+        QString file_path;
+        {
+            QMutexLocker lock(&mutex);
+            writing.clear();
+            if (queue.empty()) {
+                draining = false;
+                return;
+            }
+            file_path = queue.front();
+            queue.pop_front();
+            cache = queued.take(file_path);
+            writing = file_path;
+        }
+        auto written = write_podcast_cache(cache, file_path);
+        if (written > 0) {
+            files++;
+            bytes += written;
+        }
+        pending--;
+    }
+}
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QLoggingCategory>
+#include <QThread>
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include "PlayableItem.hpp"
+#include "PodcastSource.hpp"
+#include "alarm.hpp"
+#include "appconstants.hpp"
+#include "concurrent_store.hpp"
+#include "configuration.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.ConcurrentStore");
+
+/*****************************************************************************/
+const QJsonObject& DigitalRooster::find_json_by_id(
+    const std::vector<QJsonObject>& items, const QUuid& id) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto item = std::find_if(items.begin(), items.end(),
+        [&](const QJsonObject& item) {
+            return QUuid::fromString(item[KEY_ID].toString()) == id;
+        });
+    if (item == items.end()) {
+        throw std::out_of_range(id.toString().toStdString());
+    }
+    return *item;
+}
+
+/*****************************************************************************/
+ConcurrentStore::ConcurrentStore(Configuration& cfg, QObject* parent)
+    : QObject(parent)
+    , config(cfg) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    connect(&config, &Configuration::configuration_changed, this,
+        &ConcurrentStore::refresh_snapshot);
+    connect(&config, &Configuration::alarms_changed, this,
+        &ConcurrentStore::refresh_snapshot);
+    connect(&config, &Configuration::stations_changed, this,
+        &ConcurrentStore::refresh_snapshot);
+    connect(&config, &Configuration::podcast_sources_changed, this,
+        &ConcurrentStore::refresh_snapshot);
+    refresh_timer.setSingleShot(true);
+    refresh_timer.setInterval(SNAPSHOT_REFRESH_DELAY);
+    connect(&refresh_timer, &QTimer::timeout, this,
+        &ConcurrentStore::refresh_snapshot);
+    refresh_snapshot();
+}
+
+/*****************************************************************************/
+std::shared_ptr<const StoreSnapshot> ConcurrentStore::get_snapshot() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return std::atomic_load(&snapshot);
+}
+
+/*****************************************************************************/
+void ConcurrentStore::refresh_snapshot() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto next = std::make_shared<StoreSnapshot>();
+    next->generation = ++generation;
+    for (const auto& alarm : config.get_alarms()) {
+        next->alarms.push_back(alarm->to_json_object());
+    }
+    for (const auto& station : config.get_stations()) {
+        next->stations.push_back(station->to_json_object());
+    }
+    for (const auto& ps : config.get_podcast_sources()) {
+        next->podcasts.push_back(ps->to_json_object());
+        /* e.g. title and settings change with the next feed update */
+        connect(ps.get(), &PodcastSource::dataChanged, &refresh_timer,
+            static_cast<void (QTimer::*)()>(&QTimer::start),
+            Qt::UniqueConnection);
+    }
+    /* readers still holding the old snapshot keep it alive */
+    std::atomic_store(
+        &snapshot, std::shared_ptr<const StoreSnapshot>(std::move(next)));
+}
+
+/*****************************************************************************/
+template <typename T>
+StoreChange<T> ConcurrentStore::run_on_store_thread(std::function<T()> fn) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto promise = std::make_shared<std::promise<T>>();
+    StoreChange<T> change{promise->get_future(),
+        std::make_shared<std::atomic<StoreChangeState>>(
+            StoreChangeState::Pending)};
+    auto task = [this, promise, fn, state = change.state]() {
+        auto expected = StoreChangeState::Pending;
+        if (!state->compare_exchange_strong(
+                expected, StoreChangeState::Running)) {
+            qCWarning(CLASS_LC) << "change cancelled by client";
+            return;
+        }
+        try {
+            if constexpr (std::is_void_v<T>) {
+                fn();
+                refresh_snapshot();
+                promise->set_value();
+            } else {
+                auto value = fn();
+                refresh_snapshot();
+                promise->set_value(value);
+            }
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    };
+    /* On our own thread waiting for the queued call would dead-lock */
+    if (QThread::currentThread() == thread()) {
+        task();
+    } else {
+        QMetaObject::invokeMethod(this, task, Qt::QueuedConnection);
+    }
+    return change;
+}
+
+/*****************************************************************************/
+StoreChange<QUuid> ConcurrentStore::add_alarm(const QJsonObject& json) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return run_on_store_thread<QUuid>([this, json]() {
+        auto alarm = Alarm::from_json_object(json);
+        config.add_alarm(alarm);
+        return alarm->get_id();
+    });
+}
+
+/*****************************************************************************/
+StoreChange<void> ConcurrentStore::delete_alarm(const QUuid& id) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return run_on_store_thread<void>(
+        [this, id]() { config.delete_alarm(id); });
+}
+
+/*****************************************************************************/
+StoreChange<QUuid> ConcurrentStore::add_radio_station(
+    const QJsonObject& json) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return run_on_store_thread<QUuid>([this, json]() {
+        auto station = PlayableItem::from_json_object(json);
+        config.add_radio_station(station);
+        return station->get_id();
+    });
+}
+
+/*****************************************************************************/
+StoreChange<void> ConcurrentStore::delete_radio_station(const QUuid& id) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return run_on_store_thread<void>(
+        [this, id]() { config.delete_radio_station(id); });
+}
+
+/*****************************************************************************/
+StoreChange<QUuid> ConcurrentStore::add_podcast_source(
+    const QJsonObject& json) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* PodcastSource owns timers and network objects -> create on Qt thread */
+    return run_on_store_thread<QUuid>([this, json]() {
+        auto ps = PodcastSource::from_json_object(json);
+        config.add_podcast_source(ps);
+        return ps->get_id();
+    });
+}
+
+/*****************************************************************************/
+StoreChange<void> ConcurrentStore::delete_podcast_source(const QUuid& id) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return run_on_store_thread<void>(
+        [this, id]() { config.delete_podcast_source(id); });
+}
+
+/*****************************************************************************/
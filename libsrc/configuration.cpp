@@ -4,14 +4,22 @@
  * Licensed under GNU PUBLIC LICENSE Version 3 or later
  */
 
+#include <QCborMap>
+#include <QCborValue>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QFutureWatcher>
 #include <QLoggingCategory>
 #include <QSaveFile>
 #include <QStandardPaths>
 #include <QString>
 #include <QTime>
+#include <QtConcurrent>
 
+#include <algorithm>
 #include <chrono>
 #include <stdexcept>
+#include <system_error>
 
 #include "PlayableItem.hpp"
 #include "PodcastSource.hpp"
@@ -68,6 +76,137 @@ void delete_by_id(std::vector<std::shared_ptr<T>>& container, const QUuid& id) {
     }
 }
 
+/*****************************************************************************/
+/**
+ * Remove item with id from container and hand it to the caller
+ * @return item or nullptr if no item with this id exists
+ */
+template <typename T>
+std::shared_ptr<T> take_by_id(
+    std::vector<std::shared_ptr<T>>& container, const QUuid& id) {
+    auto item = std::find_if(container.begin(), container.end(),
+        [&](const std::shared_ptr<T> item) { return item->get_id() == id; });
+    if (item == container.end()) {
+        return nullptr;
+    }
+    auto res = *item;
+    container.erase(item);
+    return res;
+}
+
+/*****************************************************************************/
+/**
+ * Copy settings of a station read from file to the existing station
+ * @return true if anything changed
+ */
+static bool update_station(PlayableItem& station, const PlayableItem& src) {
+    bool changed = false;
+    if (station.get_display_name() != src.get_display_name()) {
+        station.set_display_name(src.get_display_name());
+        changed = true;
+    }
+    if (station.get_url() != src.get_url()) {
+        station.set_url(src.get_url());
+        changed = true;
+    }
+    return changed;
+}
+
+/*****************************************************************************/
+/**
+ * Copy settings of an alarm read from file to the existing alarm
+ * @return true if anything changed
+ */
+static bool update_alarm(Alarm& alarm, const Alarm& src) {
+    bool changed = false;
+    if (alarm.get_time() != src.get_time()) {
+        alarm.set_time(src.get_time());
+        changed = true;
+    }
+    if (alarm.get_period() != src.get_period()) {
+        alarm.set_period(src.get_period());
+        changed = true;
+    }
+    if (alarm.is_enabled() != src.is_enabled()) {
+        alarm.enable(src.is_enabled());
+        changed = true;
+    }
+    if (alarm.get_media_url() != src.get_media_url()) {
+        alarm.update_media_url(src.get_media_url());
+        changed = true;
+    }
+    if (alarm.get_volume() != src.get_volume()) {
+        alarm.set_volume(src.get_volume());
+        changed = true;
+    }
+    if (alarm.get_timeout() != src.get_timeout()) {
+        alarm.set_timeout(src.get_timeout());
+        changed = true;
+    }
+    return changed;
+}
+
+/*****************************************************************************/
+/**
+ * Podcast sources are presented sorted by title
+ */
+static void sort_podcast_sources(
+    std::vector<std::shared_ptr<PodcastSource>>& sources) {
+    std::sort(sources.begin(), sources.end(),
+        [](const std::shared_ptr<PodcastSource>& lhs,
+            const std::shared_ptr<PodcastSource>& rhs) {
+            return lhs->get_title() < rhs->get_title();
+        });
+}
+
+/*****************************************************************************/
+/**
+ * Apply user editable settings to an existing podcast source
+ * does not touch the update task or cache
+ * @return true if anything changed
+ */
+static bool update_podcast_source(PodcastSource& ps, const QJsonObject& json) {
+    bool changed = false;
+    auto title = json[JSON_KEY_TITLE].toString();
+    /* empty title in file - keep what we got from RSS */
+    if (!title.isEmpty() && ps.get_title() != title) {
+        ps.set_title(title);
+        changed = true;
+    }
+    auto max_episodes = json[KEY_MAX_EPISODES].toInt(DEFAULT_MAX_EPISODES);
+    if (ps.get_max_episodes() != static_cast<size_t>(max_episodes)) {
+        try {
+            ps.set_max_episodes(max_episodes);
+            changed = true;
+        } catch (const std::invalid_argument& exc) {
+            qCWarning(CLASS_LC) << exc.what() << "- ignored";
+        }
+    }
+    auto offline = json[KEY_OFFLINE_EPISODES].toInt(DEFAULT_OFFLINE_EPISODES);
+    if (ps.get_offline_episodes() != offline) {
+        try {
+            ps.set_offline_episodes(offline);
+            changed = true;
+        } catch (const std::invalid_argument& exc) {
+            qCWarning(CLASS_LC) << exc.what() << "- ignored";
+        }
+    }
+    auto interval = std::chrono::seconds(json[KEY_UPDATE_INTERVAL].toInt(
+        static_cast<int>(ps.get_update_interval().count())));
+    if (ps.get_update_interval() != interval) {
+        ps.set_update_interval(interval);
+        changed = true;
+    }
+    auto max_interval =
+        std::chrono::seconds(json[KEY_MAX_UPDATE_INTERVAL].toInt(
+            static_cast<int>(ps.get_max_update_interval().count())));
+    if (ps.get_max_update_interval() != max_interval) {
+        ps.set_max_update_interval(max_interval);
+        changed = true;
+    }
+    return changed;
+}
+
 /*****************************************************************************/
 Configuration::Configuration(
     const QString& configpath, const QString& cachedir)
@@ -95,6 +234,11 @@ Configuration::Configuration(
         application_cache_dir.setPath(DEFAULT_CACHE_DIR_PATH);
         QDir().mkpath(DEFAULT_CACHE_DIR_PATH);
     }
+    position_journal = std::make_shared<PositionJournal>(
+        application_cache_dir.filePath(POSITION_JOURNAL_FILE_NAME));
+    cache_writer = std::make_shared<CacheWriter>();
+    episode_downloader = std::make_shared<EpisodeDownloader>(
+        application_cache_dir.filePath(EPISODE_DOWNLOAD_DIR_NAME));
 
 
     // Check or create config dir
@@ -115,16 +259,40 @@ Configuration::Configuration(
     fwConn = connect(&filewatcher, &QFileSystemWatcher::fileChanged, this,
         &Configuration::fileChanged);
 
+    reload_timer.setSingleShot(true);
+    reload_timer.setInterval(CONFIG_RELOAD_DELAY);
+    connect(&reload_timer, &QTimer::timeout, this,
+        &Configuration::reload_configuration);
+
     // Event loop timer every 5 seconds to update remaining time
     evt_timer_id = startTimer(std::chrono::seconds(5));
 };
 
+/*****************************************************************************/
+Configuration::~Configuration() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (dirty) {
+        /* also contains the pending settings */
+        store_current_config();
+    } else if (!pending_settings.isEmpty()) {
+        append_journal();
+    }
+    /* podcast sources may outlive the configuration */
+    cache_writer->flush();
+}
+
 /*****************************************************************************/
 void Configuration::timerEvent(QTimerEvent* evt) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     if (evt->timerId() == evt_timer_id && dirty) {
         store_current_config();
         dirty = !dirty; // toggle
+    } else if (evt->timerId() == evt_timer_id && !pending_settings.isEmpty()) {
+        append_journal();
+        /* compaction, journal is truncated when config file is written */
+        if (journal_records >= CONFIG_JOURNAL_MAX_RECORDS) {
+            store_current_config();
+        }
     } else {
         QObject::timerEvent(evt);
     }
@@ -133,18 +301,23 @@ void Configuration::timerEvent(QTimerEvent* evt) {
 /*****************************************************************************/
 void Configuration::refresh_configuration() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-
-    alarms.clear();
-    podcast_sources.clear();
-    stream_sources.clear();
     auto content = get_json_from_file(get_configuration_path());
-    parse_json(content.toUtf8());
+    /* Binary snapshot is faster to read as long as it matches the JSON */
+    auto appconfig = read_snapshot(content);
+    if (appconfig.isEmpty()) {
+        parse_json(content);
+    } else {
+        read_configuration(appconfig);
+    }
+    replay_journal();
+    /* values read from file and journal are already persisted */
+    pending_settings = QJsonObject();
     emit configuration_changed();
 }
 
 /*****************************************************************************/
-QString Configuration::get_json_from_file(const QString& path) {
-    QString content;
+QByteArray Configuration::get_json_from_file(const QString& path) {
+    QByteArray content;
     QFile file(path);
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
 
@@ -164,8 +337,19 @@ QString Configuration::get_json_from_file(const QString& path) {
 /*****************************************************************************/
 void Configuration::parse_json(const QByteArray& json) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    QJsonDocument doc = QJsonDocument::fromJson(json);
+    QJsonParseError err;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &err);
     QJsonObject appconfig = doc.object();
+    read_configuration(appconfig);
+    /* next start can use the snapshot */
+    if (err.error == QJsonParseError::NoError) {
+        write_snapshot(appconfig, json);
+    }
+}
+
+/*****************************************************************************/
+void Configuration::read_configuration(const QJsonObject& appconfig) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
     /*
      * get application config
      */
@@ -201,11 +385,20 @@ void Configuration::read_radio_streams(const QJsonObject& appconfig) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     QJsonArray stations =
         appconfig[DigitalRooster::KEY_GROUP_IRADIO_SOURCES].toArray();
+    /* stations still found in the file are moved from here to 'updated' */
+    auto current = stream_sources;
+    std::vector<std::shared_ptr<PlayableItem>> updated;
+    bool changed = false;
     for (const auto& json_station : stations) {
         try {
             auto station =
                 PlayableItem::from_json_object(json_station.toObject());
-            stream_sources.push_back(station);
+            auto existing = take_by_id(current, station->get_id());
+            if (existing) {
+                changed |= update_station(*existing, *station);
+                station = existing;
+            }
+            updated.push_back(station);
         } catch (std::invalid_argument& exc) {
             qCWarning(CLASS_LC)
                 << "cannot create station form JSON " << exc.what();
@@ -213,12 +406,18 @@ void Configuration::read_radio_streams(const QJsonObject& appconfig) {
         }
     }
     /* Sort alphabetically */
-    std::sort(stream_sources.begin(), stream_sources.end(),
+    std::sort(updated.begin(), updated.end(),
         [](const std::shared_ptr<PlayableItem>& lhs,
             const std::shared_ptr<PlayableItem>& rhs) {
             return lhs->get_display_name() < rhs->get_display_name();
         });
+    /* added, removed or reordered items */
+    changed |= (updated != stream_sources);
+    stream_sources = std::move(updated);
     qCDebug(CLASS_LC) << "read" << stream_sources.size() << "streams";
+    if (changed) {
+        emit stations_changed();
+    }
 }
 
 /*****************************************************************************/
@@ -226,33 +425,134 @@ void Configuration::read_podcasts(const QJsonObject& appconfig) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     QJsonArray podcasts =
         appconfig[DigitalRooster::KEY_GROUP_PODCAST_SOURCES].toArray();
+    /* sources still found in the file are moved from here to 'updated' */
+    auto current = podcast_sources;
+    std::vector<std::shared_ptr<PodcastSource>> updated;
+    std::vector<std::shared_ptr<PodcastSource>> created;
+    bool changed = false;
     for (const auto pc : podcasts) {
         try {
-            auto ps = PodcastSource::from_json_object(pc.toObject());
-            auto serializer = std::make_unique<PodcastSerializer>(
-                application_cache_dir, ps.get());
-            // populate podcast source from cached info
-            serializer->restore_info();
-            // Move ownership to Podcast Source and setup signal/slot
-            // connections
-            ps->set_serializer(std::move(serializer));
-
-            ps->set_update_task(std::make_unique<UpdateTask>(ps.get()));
-
-            // Get notifications if name etc. changes
-            connect(ps.get(), &PodcastSource::dataChanged, this,
-                &Configuration::dataChanged);
-            podcast_sources.push_back(ps);
+            auto json = pc.toObject();
+            auto id = valid_uuid_from_String(
+                json[KEY_ID].toString(QUuid::createUuid().toString()));
+            auto url = valid_url_from_string(json[KEY_URI].toString());
+            /*
+             * Keep existing sources with their episodes, update task and
+             * serializer - a new feed url is a new source
+             */
+            auto ps = take_by_id(current, id);
+            if (ps && ps->get_url() == url) {
+                changed |= update_podcast_source(*ps, json);
+            } else {
+                ps = create_podcast_source(json);
+                created.push_back(ps);
+            }
+            updated.push_back(ps);
         } catch (std::invalid_argument& exc) {
             qCDebug(CLASS_LC) << "invalid argument" << exc.what();
         }
     }
-    std::sort(podcast_sources.begin(), podcast_sources.end(),
-        [](const std::shared_ptr<PodcastSource>& lhs,
-            const std::shared_ptr<PodcastSource>& rhs) {
-            return lhs->get_title() < rhs->get_title();
-        });
+    /* titles of new sources are sorted again after restore */
+    restore_podcast_sources(created);
+    sort_podcast_sources(updated);
+    /* added, removed or reordered items */
+    changed |= (updated != podcast_sources);
+    podcast_sources = std::move(updated);
     qCDebug(CLASS_LC) << "read" << podcast_sources.size() << "podcasts";
+    if (changed) {
+        emit podcast_sources_changed();
+    }
+}
+
+/*****************************************************************************/
+std::shared_ptr<PodcastSource> Configuration::create_podcast_source(
+    const QJsonObject& json) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto ps = PodcastSource::from_json_object(json);
+    setup_podcast_source(ps);
+    return ps;
+}
+
+/*****************************************************************************/
+void Configuration::setup_podcast_source(
+    const std::shared_ptr<PodcastSource>& ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto serializer =
+        std::make_unique<PodcastSerializer>(application_cache_dir, ps.get());
+    serializer->set_cache_writer(cache_writer);
+    // Move ownership to Podcast Source and setup signal/slot
+    // connections
+    ps->set_serializer(std::move(serializer));
+    ps->set_position_journal(position_journal);
+    episode_downloader->add_podcast_source(ps);
+
+    // Get notifications if name etc. changes
+    connect(ps.get(), &PodcastSource::dataChanged, this,
+        &Configuration::dataChanged);
+}
+
+/*****************************************************************************/
+void Configuration::restore_podcast_sources(
+    const std::vector<std::shared_ptr<PodcastSource>>& sources) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (sources.empty()) {
+        return;
+    }
+    /* file I/O and parsing on the pool, sources stay on this thread */
+    auto pending = std::make_shared<size_t>(sources.size());
+    for (const auto& ps : sources) {
+        auto cache_file = application_cache_dir.filePath(ps->get_id_string());
+        auto watcher = new QFutureWatcher<PodcastCache>(this);
+        std::weak_ptr<PodcastSource> source = ps;
+        connect(watcher, &QFutureWatcher<PodcastCache>::finished, this,
+            [this, watcher, source, pending]() {
+                watcher->deleteLater();
+                /* source may have been removed while reading */
+                auto ps = source.lock();
+                if (ps) {
+                    apply_podcast_cache(watcher->result(), ps);
+                }
+                if (--(*pending) == 0) {
+                    podcast_sources_restored();
+                }
+            });
+        watcher->setFuture(QtConcurrent::run(&worker_pool(), [cache_file]() {
+            try {
+                return read_podcast_cache(cache_file);
+            } catch (std::system_error&) {
+                qCWarning(CLASS_LC) << "Cache file not found" << cache_file;
+            } catch (PodcastSourceJSonCorrupted& jsexc) {
+                qCWarning(CLASS_LC)
+                    << "corrupted cache file" << cache_file << ": "
+                    << jsexc.what();
+            }
+            return PodcastCache();
+        }));
+    }
+}
+
+/*****************************************************************************/
+void Configuration::apply_podcast_cache(
+    const PodcastCache& cache, const std::shared_ptr<PodcastSource>& ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (!cache.source.isEmpty()) {
+        try {
+            restore_podcast_source(cache, ps.get());
+        } catch (PodcastSourceJSonCorrupted& jsexc) {
+            qCWarning(CLASS_LC) << "corrupted cache of" << ps->get_id_string()
+                                << jsexc.what();
+        }
+    }
+    /* RefreshScheduler starts updates with restored episodes */
+    ps->set_update_task(std::make_unique<UpdateTask>(ps.get()));
+}
+
+/*****************************************************************************/
+void Configuration::podcast_sources_restored() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* titles are restored from cache, sort again */
+    sort_podcast_sources(podcast_sources);
+    emit podcast_sources_changed();
 }
 
 /*****************************************************************************/
@@ -260,18 +560,41 @@ void Configuration::read_alarms(const QJsonObject& appconfig) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     QJsonArray alarm_config =
         appconfig[DigitalRooster::KEY_GROUP_ALARMS].toArray();
+    /* alarms still found in the file are moved from here to 'updated' */
+    auto current = alarms;
+    std::vector<std::shared_ptr<Alarm>> updated;
+    bool changed = false;
     for (const auto al : alarm_config) {
         try {
             auto alarm = Alarm::from_json_object(al.toObject());
+            auto existing = take_by_id(current, alarm->get_id());
+            if (existing) {
+                /* collect all changes in one alarms_changed() */
+                disconnect(existing.get(), &Alarm::dataChanged, this,
+                    &Configuration::alarm_data_changed);
+                changed |= update_alarm(*existing, *alarm);
+                alarm = existing;
+            }
             connect(alarm.get(), &Alarm::dataChanged, this,
                 &Configuration::alarm_data_changed);
-            alarms.push_back(alarm);
+            updated.push_back(alarm);
         } catch (std::invalid_argument& exc) {
             qCWarning(CLASS_LC)
                 << "Invalid JSON values for Alarm" << exc.what();
         }
     }
+    /* Alarms no longer configured must not notify us anymore */
+    for (const auto& removed : current) {
+        disconnect(removed.get(), &Alarm::dataChanged, this,
+            &Configuration::alarm_data_changed);
+    }
+    /* added, removed or reordered items */
+    changed |= (updated != alarms);
+    alarms = std::move(updated);
     qCDebug(CLASS_LC) << "read" << alarms.size() << "alarms";
+    if (changed) {
+        emit alarms_changed();
+    }
 }
 
 /*****************************************************************************/
@@ -294,21 +617,36 @@ void Configuration::dataChanged() {
 /*****************************************************************************/
 void Configuration::fileChanged(const QString& /*path*/) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    refresh_configuration();
+    reload_timer.start();
+}
+
+/*****************************************************************************/
+void Configuration::reload_configuration() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto path = get_configuration_path();
+    /* Editors replace the file on save, the watcher then drops the path */
+    if (!filewatcher.files().contains(path) && QFile::exists(path)) {
+        filewatcher.addPath(path);
+    }
+    try {
+        refresh_configuration();
+    } catch (std::system_error& exc) {
+        qCWarning(CLASS_LC) << "reloading configuration failed" << exc.what();
+    }
 }
 
 /*****************************************************************************/
 void Configuration::set_volume(double vol) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO << vol;
     this->volume = std::clamp(vol, 0.0, 100.0);
-    dirty = true;
+    journal_setting(KEY_VOLUME, volume);
 }
 
 /*****************************************************************************/
 void Configuration::set_standby_brightness(int brightness) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO << brightness;
     this->brightness_sb = std::clamp(brightness, 0, 100);
-    dirty = true;
+    journal_setting(KEY_BRIGHTNESS_SB, brightness_sb);
 }
 
 /*****************************************************************************/
@@ -321,7 +659,7 @@ void Configuration::set_active_brightness(int brightness) {
 void Configuration::do_set_brightness_act(int brightness) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO << brightness;
     this->brightness_act = brightness;
-    dirty = true;
+    journal_setting(KEY_BRIGHTNESS_ACT, brightness_act);
 }
 
 /*****************************************************************************/
@@ -397,8 +735,15 @@ void Configuration::write_config_file(const QJsonObject& appconfig) {
         config_file.open(
             QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
         QJsonDocument doc(appconfig);
-        config_file.write(doc.toJson());
-        config_file.commit();
+        auto json = doc.toJson();
+        config_file.write(json);
+        if (config_file.commit()) {
+            write_snapshot(appconfig, json);
+            /* all journaled settings are now in the configuration file */
+            QFile::remove(get_journal_path());
+            journal_records = 0;
+            pending_settings = QJsonObject();
+        }
     } catch (std::exception& exc) {
         qCCritical(CLASS_LC) << exc.what();
     }
@@ -411,6 +756,100 @@ void Configuration::write_config_file(const QJsonObject& appconfig) {
     filewatcher.addPath(file_path);
 }
 
+/*****************************************************************************/
+QString Configuration::get_journal_path() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return get_configuration_path() + CONFIG_JOURNAL_SUFFIX;
+}
+
+/*****************************************************************************/
+void Configuration::journal_setting(
+    const QString& key, const QJsonValue& value) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << key;
+    pending_settings[key] = value;
+}
+
+/*****************************************************************************/
+void Configuration::append_journal() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    QFile journal(get_journal_path());
+    if (!journal.open(QIODevice::ReadWrite)) {
+        qCWarning(CLASS_LC) << "cannot open journal" << journal.errorString();
+        /* fall back to writing the whole configuration */
+        dirty = true;
+        return;
+    }
+    /* one record per line, partially written records are skipped on replay */
+    auto record =
+        QJsonDocument(pending_settings).toJson(QJsonDocument::Compact) + '\n';
+    auto size = journal.size();
+    if (size > 0 && journal.seek(size - 1) && journal.read(1) != "\n") {
+        /* last append was torn, don't glue this record onto it */
+        record.prepend('\n');
+    }
+    journal.seek(size);
+    if (journal.write(record) != record.size() || !journal.flush()) {
+        qCWarning(CLASS_LC) << "cannot write journal" << journal.errorString();
+        dirty = true;
+        return;
+    }
+    journal.close();
+    pending_settings = QJsonObject();
+    journal_records++;
+}
+
+/*****************************************************************************/
+void Configuration::replay_journal() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    QFile journal(get_journal_path());
+    journal_records = 0;
+    /*
+     * Writing the configuration file removes the journal, a configuration
+     * file newer than the journal was edited by hand and takes precedence
+     */
+    QFileInfo config_info(get_configuration_path());
+    QFileInfo journal_info(journal);
+    if (journal_info.exists() &&
+        config_info.lastModified() > journal_info.lastModified()) {
+        qCInfo(CLASS_LC) << "configuration edited, discarding journal";
+        journal.remove();
+        return;
+    }
+    if (!journal.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    /* later records override earlier ones */
+    QJsonObject settings;
+    while (!journal.atEnd()) {
+        auto record = QJsonDocument::fromJson(journal.readLine()).object();
+        if (record.isEmpty()) {
+            qCWarning(CLASS_LC) << "skipping invalid journal record";
+            continue;
+        }
+        for (auto it = record.constBegin(); it != record.constEnd(); ++it) {
+            settings[it.key()] = it.value();
+        }
+        journal_records++;
+    }
+    if (settings.contains(KEY_VOLUME)) {
+        set_volume(settings[KEY_VOLUME].toDouble(volume));
+    }
+    if (settings.contains(KEY_BRIGHTNESS_SB)) {
+        set_standby_brightness(
+            settings[KEY_BRIGHTNESS_SB].toInt(brightness_sb));
+    }
+    if (settings.contains(KEY_BRIGHTNESS_ACT)) {
+        set_active_brightness(
+            settings[KEY_BRIGHTNESS_ACT].toInt(brightness_act));
+    }
+    if (settings.contains(KEY_SLEEP_TIMEOUT)) {
+        set_sleep_timeout(
+            std::chrono::minutes(settings[KEY_SLEEP_TIMEOUT].toInt(
+                static_cast<int>(sleep_timeout.count()))));
+    }
+    qCDebug(CLASS_LC) << "replayed" << journal_records << "journal records";
+}
+
 /*****************************************************************************/
 void Configuration::create_default_configuration() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
@@ -423,15 +862,16 @@ void Configuration::create_default_configuration() {
         QUrl("https://st01.sslstream.dlf.de/dlf/01/128/mp3/stream.mp3"),
         QTime::fromString("09:00", "hh:mm"), Alarm::Weekend, false));
 
-    /* Podcasts */
-    podcast_sources.push_back(std::make_shared<PodcastSource>(
-        QUrl("http://armscontrolwonk.libsyn.com/rss")));
-
-    podcast_sources.push_back(std::make_shared<PodcastSource>(
-        QUrl("https://rss.acast.com/mydadwroteaporno")));
-
-    podcast_sources.push_back(std::make_shared<PodcastSource>(
-        QUrl("https://alternativlos.org/alternativlos.rss")));
+    /* Podcasts, set up like sources read from the file */
+    for (const auto* url : {"http://armscontrolwonk.libsyn.com/rss",
+             "https://rss.acast.com/mydadwroteaporno",
+             "https://alternativlos.org/alternativlos.rss"}) {
+        QJsonObject json;
+        json[KEY_URI] = url;
+        podcast_sources.push_back(create_podcast_source(json));
+    }
+    /* gives the sources their UpdateTask */
+    restore_podcast_sources(podcast_sources);
 
     /* Radio Streams */
     stream_sources.push_back(std::make_shared<PlayableItem>("Deutschlandfunk",
@@ -453,6 +893,54 @@ QString Configuration::get_configuration_path() const {
     return config_file;
 }
 
+/*****************************************************************************/
+QString Configuration::get_snapshot_path() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return get_configuration_path() + CONFIG_SNAPSHOT_SUFFIX;
+}
+
+/*****************************************************************************/
+QJsonObject Configuration::read_snapshot(const QByteArray& json) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    QFile file(get_snapshot_path());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+    QCborParserError err;
+    auto snapshot = QCborValue::fromCbor(file.readAll(), &err).toMap();
+    if (err.error != QCborError::NoError) {
+        qCWarning(CLASS_LC) << "corrupt snapshot" << err.errorString();
+        return QJsonObject();
+    }
+    if (snapshot.value(KEY_VERSION).toInteger() != CONFIG_SNAPSHOT_VERSION ||
+        snapshot.value(KEY_SNAPSHOT_SOURCE).toByteArray() !=
+            QCryptographicHash::hash(json, QCryptographicHash::Sha1)) {
+        qCInfo(CLASS_LC) << "snapshot outdated, reading JSON";
+        return QJsonObject();
+    }
+    return snapshot.value(KEY_SNAPSHOT_CONFIG).toMap().toJsonObject();
+}
+
+/*****************************************************************************/
+void Configuration::write_snapshot(
+    const QJsonObject& appconfig, const QByteArray& json) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    QCborMap snapshot;
+    snapshot.insert(KEY_VERSION, CONFIG_SNAPSHOT_VERSION);
+    snapshot.insert(KEY_SNAPSHOT_SOURCE,
+        QCryptographicHash::hash(json, QCryptographicHash::Sha1));
+    snapshot.insert(KEY_SNAPSHOT_CONFIG, QCborMap::fromJsonObject(appconfig));
+
+    QSaveFile snapshot_file(get_snapshot_path());
+    if (!snapshot_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(CLASS_LC) << "cannot write snapshot"
+                            << snapshot_file.errorString();
+        return;
+    }
+    snapshot_file.write(QCborValue(snapshot).toCbor());
+    snapshot_file.commit();
+}
+
 /*****************************************************************************/
 QString Configuration::get_wpa_socket_name() const {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
@@ -573,6 +1061,10 @@ Configuration::get_stations() const {
 void Configuration::add_podcast_source(
     std::shared_ptr<PodcastSource> podcast) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    setup_podcast_source(podcast);
+    if (!podcast->has_update_task()) {
+        podcast->set_update_task(std::make_unique<UpdateTask>(podcast.get()));
+    }
     this->podcast_sources.push_back(podcast);
     dataChanged();
     emit podcast_sources_changed();
@@ -644,7 +1136,8 @@ std::chrono::minutes Configuration::get_sleep_timeout() const {
 void Configuration::set_sleep_timeout(std::chrono::minutes timeout) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     sleep_timeout = timeout;
-    dirty = true;
+    journal_setting(
+        KEY_SLEEP_TIMEOUT, static_cast<qint64>(sleep_timeout.count()));
 }
 
 /*****************************************************************************/
@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QCborMap>
+#include <QCborValue>
+#include <QHash>
+#include <QJsonArray>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <system_error>
+
+#include "appconstants.hpp"
+#include "episode_cache.hpp"
+#include "podcast_serializer.hpp"
+#include "string_pool.hpp"
+#include "util.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.EpisodeCache");
+
+/*
+ * File layout, all integers little endian:
+ *  header:  "DRPC", version, source offset, source size, episode count,
+ *           records offset, strings offset, strings size (8 x quint32)
+ *  source:  CBOR map of PodcastSource properties
+ *  records: per episode title, publisher, guid, url, description and
+ *           summary as (offset, size) in string table (6 x 2 x quint32),
+ *           publication date in ms since epoch, duration, position
+ *           (3 x qint64). Version 1 records have no summary.
+ *  strings: UTF-8 text, identical strings are stored once
+ */
+static const char CACHE_MAGIC[] = {'D', 'R', 'P', 'C'};
+static const quint32 HEADER_SIZE = 8 * sizeof(quint32);
+static const int STRINGS_PER_RECORD = 6;
+static const quint32 VALUES_SIZE = 3 * sizeof(qint64);
+static const quint32 RECORD_SIZE =
+    STRINGS_PER_RECORD * 2 * sizeof(quint32) + VALUES_SIZE;
+/* without summary */
+static const int STRINGS_PER_RECORD_V1 = 5;
+static const quint32 RECORD_SIZE_V1 =
+    STRINGS_PER_RECORD_V1 * 2 * sizeof(quint32) + VALUES_SIZE;
+static const qint64 INVALID_DATE = std::numeric_limits<qint64>::min();
+
+/*****************************************************************************/
+static void append_u32(QByteArray& out, quint32 value) {
+    char buf[sizeof(value)];
+    qToLittleEndian(value, buf);
+    out.append(buf, sizeof(buf));
+}
+
+/*****************************************************************************/
+static void append_i64(QByteArray& out, qint64 value) {
+    char buf[sizeof(value)];
+    qToLittleEndian(value, buf);
+    out.append(buf, sizeof(buf));
+}
+
+/*****************************************************************************/
+CacheFileMapping::CacheFileMapping(const QString& file_path)
+    : file(file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << file_path;
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCCritical(CLASS_LC) << file.errorString();
+        throw std::system_error(
+            make_error_code(std::errc::no_such_file_or_directory),
+            file.errorString().toStdString());
+    }
+    length = file.size();
+    /* an empty file can't be mapped */
+    if (length > 0) {
+        mapped = file.map(0, length);
+        if (mapped == nullptr) {
+            qCCritical(CLASS_LC) << "map failed" << file.errorString();
+            throw std::system_error(make_error_code(std::errc::io_error),
+                file.errorString().toStdString());
+        }
+    }
+}
+
+/*****************************************************************************/
+CacheFileMapping::~CacheFileMapping() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (mapped != nullptr) {
+        file.unmap(mapped);
+    }
+}
+
+/*****************************************************************************/
+MappedText::MappedText(std::shared_ptr<const CacheFileMapping> mapping,
+    quint32 offset, quint32 size)
+    : mapping(std::move(mapping))
+    , offset(offset)
+    , size(size) {
+}
+
+/*****************************************************************************/
+QString MappedText::to_string() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (!mapping) {
+        return QString();
+    }
+    return QString::fromUtf8(mapping->data() + offset, size);
+}
+
+/*****************************************************************************/
+QByteArray MappedText::to_utf8() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (!mapping) {
+        return QByteArray();
+    }
+    return QByteArray(mapping->data() + offset, size);
+}
+
+/*****************************************************************************/
+PodcastCache DigitalRooster::read_podcast_cache(const QString& file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto mapping = std::make_shared<const CacheFileMapping>(file_path);
+    const auto* data = mapping->data();
+    const auto file_size = mapping->size();
+    if (file_size < static_cast<qint64>(sizeof(CACHE_MAGIC)) ||
+        std::memcmp(data, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+        /* cache file of a previous version, converted with next write */
+        qCInfo(CLASS_LC) << "reading JSON cache" << file_path;
+        return podcast_cache_from_json(read_cache_json(file_path));
+    }
+    if (file_size < HEADER_SIZE) {
+        throw PodcastSourceJSonCorrupted("cache file truncated");
+    }
+    auto header = [data](int field) {
+        return qFromLittleEndian<quint32>(data + field * sizeof(quint32));
+    };
+    auto version = header(1);
+    if (version != PODCAST_CACHE_VERSION && version != 1) {
+        throw PodcastSourceJSonCorrupted(
+            "unsupported cache version " + std::to_string(version));
+    }
+    auto strings_per_record =
+        version == 1 ? STRINGS_PER_RECORD_V1 : STRINGS_PER_RECORD;
+    auto record_size = version == 1 ? RECORD_SIZE_V1 : RECORD_SIZE;
+    auto source_offset = header(2);
+    auto source_size = header(3);
+    auto episode_count = header(4);
+    auto records_offset = header(5);
+    auto strings_offset = header(6);
+    auto strings_size = header(7);
+    auto in_file = [file_size](qint64 offset, qint64 size) {
+        return offset + size <= file_size;
+    };
+    if (!in_file(source_offset, source_size) ||
+        !in_file(records_offset,
+            static_cast<qint64>(episode_count) * record_size) ||
+        !in_file(strings_offset, strings_size)) {
+        throw PodcastSourceJSonCorrupted("cache file truncated");
+    }
+
+    PodcastCache cache;
+    QCborParserError err;
+    auto source_cbor = QByteArray::fromRawData(
+        data + source_offset, static_cast<int>(source_size));
+    cache.source =
+        QCborValue::fromCbor(source_cbor, &err).toMap().toJsonObject();
+    if (err.error != QCborError::NoError) {
+        throw PodcastSourceJSonCorrupted(
+            "corrupt source " + err.errorString().toStdString());
+    }
+
+    const char* strings = data + strings_offset;
+    /* identical strings have the same offset, decode publisher once */
+    QHash<quint32, QString> publishers;
+    cache.episodes.resize(episode_count);
+    for (quint32 i = 0; i < episode_count; i++) {
+        const char* record = data + records_offset + i * record_size;
+        quint32 offsets[STRINGS_PER_RECORD];
+        quint32 sizes[STRINGS_PER_RECORD];
+        for (int s = 0; s < strings_per_record; s++) {
+            offsets[s] = qFromLittleEndian<quint32>(record);
+            sizes[s] = qFromLittleEndian<quint32>(record + sizeof(quint32));
+            record += 2 * sizeof(quint32);
+            if (static_cast<qint64>(offsets[s]) + sizes[s] > strings_size) {
+                throw PodcastSourceJSonCorrupted("string out of range");
+            }
+        }
+        auto text = [&](int s) {
+            return QString::fromUtf8(strings + offsets[s], sizes[s]);
+        };
+        auto& episode = cache.episodes[i];
+        episode.title = text(0);
+        auto publisher = publishers.constFind(offsets[1]);
+        if (publisher == publishers.constEnd()) {
+            publisher = publishers.insert(offsets[1], text(1));
+        }
+        episode.publisher = publisher.value();
+        episode.guid = text(2);
+        episode.url = QUrl(text(3));
+        /* descriptions are the bulk of the file, decoded when needed */
+        episode.mapped_description =
+            MappedText(mapping, strings_offset + offsets[4], sizes[4]);
+        if (version == 1) {
+            /* migration, the next write stores the summary */
+            episode.summary =
+                description_summary(episode.mapped_description.to_string());
+        } else {
+            episode.summary = text(5);
+        }
+        auto date = qFromLittleEndian<qint64>(record);
+        if (date != INVALID_DATE) {
+            episode.publication_date = QDateTime::fromMSecsSinceEpoch(date);
+        }
+        episode.duration = qFromLittleEndian<qint64>(record + sizeof(qint64));
+        episode.position =
+            qFromLittleEndian<qint64>(record + 2 * sizeof(qint64));
+    }
+    return cache;
+}
+
+/*****************************************************************************/
+qint64 DigitalRooster::write_podcast_cache(
+    const PodcastCache& cache, const QString& file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto source = QCborValue(QCborMap::fromJsonObject(cache.source)).toCbor();
+
+    QByteArray records;
+    records.reserve(static_cast<int>(cache.episodes.size() * RECORD_SIZE));
+    QByteArray strings;
+    QHash<QByteArray, quint32> string_offsets;
+    auto add_string = [&](const QByteArray& utf8) {
+        auto known = string_offsets.constFind(utf8);
+        quint32 offset;
+        if (known != string_offsets.constEnd()) {
+            offset = known.value();
+        } else {
+            offset = static_cast<quint32>(strings.size());
+            string_offsets.insert(utf8, offset);
+            strings.append(utf8);
+        }
+        append_u32(records, offset);
+        append_u32(records, static_cast<quint32>(utf8.size()));
+    };
+    for (const auto& episode : cache.episodes) {
+        add_string(episode.title.toUtf8());
+        add_string(episode.publisher.toUtf8());
+        add_string(episode.guid.toUtf8());
+        add_string(episode.url.toString().toUtf8());
+        /* copy a description that was never displayed without decoding */
+        add_string(episode.mapped_description.is_valid()
+                ? episode.mapped_description.to_utf8()
+                : episode.description.toUtf8());
+        add_string(episode.summary.toUtf8());
+        append_i64(records,
+            episode.publication_date.isValid()
+                ? episode.publication_date.toMSecsSinceEpoch()
+                : INVALID_DATE);
+        append_i64(records, episode.duration);
+        append_i64(records, episode.position);
+    }
+
+    QByteArray header(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    auto records_offset = HEADER_SIZE + static_cast<quint32>(source.size());
+    auto strings_offset = records_offset + static_cast<quint32>(records.size());
+    append_u32(header, PODCAST_CACHE_VERSION);
+    append_u32(header, HEADER_SIZE);
+    append_u32(header, static_cast<quint32>(source.size()));
+    append_u32(header, static_cast<quint32>(cache.episodes.size()));
+    append_u32(header, records_offset);
+    append_u32(header, strings_offset);
+    append_u32(header, static_cast<quint32>(strings.size()));
+
+    QSaveFile cache_file(file_path);
+    if (!cache_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCCritical(CLASS_LC) << "cannot write cache"
+                             << cache_file.errorString();
+        return 0;
+    }
+    cache_file.write(header);
+    cache_file.write(source);
+    cache_file.write(records);
+    cache_file.write(strings);
+    if (!cache_file.commit()) {
+        qCCritical(CLASS_LC) << "cannot write cache"
+                             << cache_file.errorString();
+        return 0;
+    }
+    return header.size() + source.size() + records.size() + strings.size();
+}
+
+/*****************************************************************************/
+PodcastCache DigitalRooster::podcast_cache_from_json(
+    const QJsonObject& tl_obj) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    PodcastCache cache;
+    StringPool strings;
+    cache.source = tl_obj;
+    cache.source.remove(KEY_EPISODES);
+    auto episodes_json_array = tl_obj[KEY_EPISODES].toArray();
+    cache.episodes.reserve(episodes_json_array.size());
+    for (const auto& ep : episodes_json_array) {
+        auto json_episode = ep.toObject();
+        EpisodeRecord episode;
+        episode.title = json_episode[JSON_KEY_TITLE].toString();
+        episode.url = QUrl(json_episode[KEY_URI].toString());
+        episode.duration =
+            static_cast<qint64>(json_episode[KEY_DURATION].toDouble(1));
+        episode.position =
+            static_cast<qint64>(json_episode[KEY_POSITION].toDouble(0));
+        episode.publication_date =
+            QDateTime::fromString(json_episode[KEY_PUBLISHED].toString());
+        episode.publisher =
+            strings.intern(json_episode[KEY_PUBLISHER].toString());
+        episode.description =
+            strings.intern(json_episode[KEY_DESCRIPTION].toString());
+        episode.summary = description_summary(episode.description);
+        episode.guid = json_episode[KEY_ID].toString();
+        cache.episodes.push_back(std::move(episode));
+    }
+    return cache;
+}
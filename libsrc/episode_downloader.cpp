@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QNetworkRequest>
+
+#include <algorithm>
+
+#include "PlayableItem.hpp"
+#include "PodcastSource.hpp"
+#include "episode_downloader.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.EpisodeDownloader");
+
+/**
+ * Suffix of files still downloading
+ */
+static const QString PART_SUFFIX("part");
+
+/*****************************************************************************/
+EpisodeDownloader::EpisodeDownloader(
+    const QString& directory, qint64 quota, QObject* parent)
+    : QObject(parent)
+    , directory(directory)
+    , quota(quota) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << directory;
+    this->directory.mkpath(".");
+    scan();
+
+    client.set_streaming(true);
+    /* never compete with the stream that is playing */
+    client.set_priority(RequestPriority::Background);
+    connect(&client, &HttpClient::streamStarted, this,
+        &EpisodeDownloader::stream_started);
+    connect(&client, &HttpClient::chunkAvailable, this,
+        &EpisodeDownloader::chunk_available);
+    connect(&client, &HttpClient::streamFinished, this,
+        &EpisodeDownloader::stream_finished);
+
+    resume_timer.setSingleShot(true);
+    resume_timer.setInterval(EPISODE_DOWNLOAD_RESUME_DELAY);
+    connect(&resume_timer, &QTimer::timeout, this, [this]() {
+        active = false;
+        start_next();
+    });
+}
+
+/*****************************************************************************/
+EpisodeDownloader::~EpisodeDownloader() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    resume_timer.stop();
+    client.abort();
+    part_file.close();
+}
+
+/*****************************************************************************/
+QString EpisodeDownloader::file_key(const QString& guid) {
+    return QString::fromLatin1(
+        QCryptographicHash::hash(guid.toUtf8(), QCryptographicHash::Md5)
+            .toHex());
+}
+
+/*****************************************************************************/
+QString EpisodeDownloader::file_name(const QString& key, const QUrl& url) {
+    auto suffix = QFileInfo(url.path()).suffix();
+    if (suffix.isEmpty() || suffix.size() > 5 || suffix == PART_SUFFIX) {
+        suffix = "media";
+    }
+    return key + "." + suffix;
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::scan() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    for (const auto& info : directory.entryInfoList(QDir::Files)) {
+        /* partial files are resumed when the episode is downloaded again */
+        if (info.suffix() == PART_SUFFIX) {
+            continue;
+        }
+        completed.insert(info.baseName(),
+            Entry{info.fileName(), info.size(), info.lastModified()});
+    }
+    qCInfo(CLASS_LC) << completed.size() << "episodes downloaded,"
+                     << get_used_bytes() << "bytes";
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::set_resume_delay(std::chrono::milliseconds delay) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << delay.count();
+    resume_timer.setInterval(delay);
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::download(
+    const std::shared_ptr<PodcastEpisode>& episode) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    download(episode->get_guid(), episode->get_url());
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::download(const QString& guid, const QUrl& url) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << guid;
+    if (is_downloaded(guid)) {
+        return;
+    }
+    auto reserved = reserved_bytes();
+    auto rejected = too_large.constFind(file_key(guid));
+    if (rejected != too_large.constEnd() && reserved + *rejected > quota) {
+        qCDebug(CLASS_LC) << "does not fit next to latest episodes" << guid;
+        return;
+    }
+    if (reserved >= quota) {
+        qCInfo(CLASS_LC) << "quota filled with latest episodes";
+        return;
+    }
+    auto queued = std::any_of(queue.begin(), queue.end(),
+        [&guid](const Job& job) { return job.guid == guid; });
+    if (queued) {
+        return;
+    }
+    queue.push_back(Job{guid, url, 0});
+    start_next();
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::add_podcast_source(
+    const std::shared_ptr<PodcastSource>& ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto raw = ps.get();
+    connect(raw, &PodcastSource::episodes_changed, this,
+        [this, raw]() { download_latest(*raw); });
+    connect(raw, &PodcastSource::offline_episodes_changed, this,
+        [this, raw]() { download_latest(*raw); });
+    connect(raw, &QObject::destroyed, this, [this, raw]() {
+        /* its episodes may be removed again */
+        latest.remove(raw);
+    });
+    download_latest(*raw);
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::download_latest(const PodcastSource& ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto count = ps.get_offline_episodes();
+    /* episodes are sorted newest first */
+    const auto& store = ps.get_episode_store();
+    auto& keys = latest[&ps];
+    keys.clear();
+    for (int row = 0; row < count && row < store.size(); row++) {
+        keys.insert(file_key(store.guid(row)));
+    }
+    for (int row = 0; row < count && row < store.size(); row++) {
+        download(store.guid(row), store.url(row));
+    }
+}
+
+/*****************************************************************************/
+QUrl EpisodeDownloader::get_local_url(const QString& guid) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto entry = completed.find(file_key(guid));
+    if (entry == completed.end()) {
+        return QUrl();
+    }
+    auto path = directory.filePath(entry->file_name);
+    if (!QFile::exists(path)) {
+        qCWarning(CLASS_LC) << "downloaded episode was removed" << path;
+        completed.erase(entry);
+        return QUrl();
+    }
+    return QUrl::fromLocalFile(path);
+}
+
+/*****************************************************************************/
+qint64 EpisodeDownloader::get_used_bytes() const {
+    qint64 used = 0;
+    for (const auto& entry : completed) {
+        used += entry.size;
+    }
+    return used;
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::start_next() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    while (!active && !queue.empty()) {
+        const auto& job = queue.front();
+        room = quota - reserved_bytes();
+        if (room <= 0) {
+            qCInfo(CLASS_LC) << "quota filled with latest episodes";
+            queue.pop_front();
+            continue;
+        }
+        part_file.setFileName(
+            directory.filePath(file_key(job.guid) + "." + PART_SUFFIX));
+        if (!part_file.open(QIODevice::ReadWrite)) {
+            qCWarning(CLASS_LC) << "cannot write" << part_file.fileName()
+                                << part_file.errorString();
+            emit download_failed(job.guid);
+            queue.pop_front();
+            continue;
+        }
+        active = true;
+        auto offset = part_file.size();
+        part_file.seek(offset);
+
+        QNetworkRequest request(job.url);
+        /* media files are too large for the HTTP disk cache */
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+            QNetworkRequest::AlwaysNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+        if (offset > 0) {
+            qCInfo(CLASS_LC) << "resuming" << job.url << "at" << offset;
+            request.setRawHeader(
+                "Range", "bytes=" + QByteArray::number(offset) + "-");
+        }
+        client.doDownload(request);
+    }
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::stream_started(qint64 offset) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << offset;
+    if (offset > part_file.size()) {
+        /* cannot fill the gap, start over with the next attempt */
+        qCWarning(CLASS_LC) << "server skipped content, restarting";
+        part_file.resize(0);
+        client.abort();
+        stream_finished(false);
+        return;
+    }
+    /* offset 0 if the server ignored the Range header */
+    part_file.resize(offset);
+    part_file.seek(offset);
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::chunk_available(const QByteArray& chunk) {
+    if (part_file.write(chunk) != chunk.size()) {
+        qCWarning(CLASS_LC) << "write failed" << part_file.errorString();
+        client.abort();
+        stream_finished(false);
+        return;
+    }
+    if (part_file.size() > room) {
+        reject_running();
+    }
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::reject_running() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    qCWarning(CLASS_LC) << "episode does not fit into quota, giving up";
+    client.abort();
+    auto guid = queue.front().guid;
+    /* not queued again before latest episodes make room for it */
+    too_large.insert(file_key(guid), part_file.size());
+    part_file.remove();
+    queue.pop_front();
+    active = false;
+    emit download_failed(guid);
+    start_next();
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::stream_finished(bool success) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << success;
+    if (!active || queue.empty()) {
+        return;
+    }
+    auto job = queue.front();
+    part_file.close();
+    if (success) {
+        auto key = file_key(job.guid);
+        auto name = file_name(key, job.url);
+        auto path = directory.filePath(name);
+        QFile::remove(path);
+        if (part_file.rename(path)) {
+            completed.insert(key,
+                Entry{name, QFileInfo(path).size(),
+                    QDateTime::currentDateTime()});
+            too_large.remove(key);
+            enforce_quota(key);
+            emit episode_downloaded(job.guid);
+        } else {
+            qCWarning(CLASS_LC) << "cannot rename" << part_file.fileName();
+            part_file.remove();
+            emit download_failed(job.guid);
+        }
+    } else if (job.resumes < EPISODE_DOWNLOAD_MAX_RESUMES) {
+        /* the part file is kept, resume_timer starts the next attempt */
+        queue.front().resumes++;
+        resume_timer.start();
+        return;
+    } else {
+        qCWarning(CLASS_LC) << "giving up" << job.url;
+        /* e.g. 416 - Range Not Satisfiable would repeat forever */
+        part_file.remove();
+        emit download_failed(job.guid);
+    }
+    queue.pop_front();
+    active = false;
+    start_next();
+}
+
+/*****************************************************************************/
+void EpisodeDownloader::enforce_quota(const QString& keep) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto used = get_used_bytes();
+    while (used > quota) {
+        auto oldest = completed.end();
+        for (auto it = completed.begin(); it != completed.end(); ++it) {
+            if (it.key() != keep && !is_latest(it.key()) &&
+                (oldest == completed.end() ||
+                    it->downloaded < oldest->downloaded)) {
+                oldest = it;
+            }
+        }
+        if (oldest == completed.end()) {
+            break;
+        }
+        qCInfo(CLASS_LC) << "quota exceeded, removing" << oldest->file_name;
+        QFile::remove(directory.filePath(oldest->file_name));
+        used -= oldest->size;
+        completed.erase(oldest);
+    }
+}
+
+/*****************************************************************************/
+bool EpisodeDownloader::is_latest(const QString& key) const {
+    return std::any_of(latest.begin(), latest.end(),
+        [&key](const QSet<QString>& keys) { return keys.contains(key); });
+}
+
+/*****************************************************************************/
+qint64 EpisodeDownloader::reserved_bytes() const {
+    qint64 reserved = 0;
+    for (auto it = completed.begin(); it != completed.end(); ++it) {
+        if (is_latest(it.key())) {
+            reserved += it->size;
+        }
+    }
+    return reserved;
+}
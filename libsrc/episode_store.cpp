@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QLoggingCategory>
+#include <QSet>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+#include "PlayableItem.hpp"
+#include "appconstants.hpp"
+#include "episode_store.hpp"
+#include "util.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.EpisodeStore");
+
+static const qint64 INVALID_DATE = std::numeric_limits<qint64>::min();
+
+/*****************************************************************************/
+static qint64 date_key(const QDateTime& date) {
+    /* invalid dates sort after all valid dates like in QDateTime */
+    return date.isValid() ? date.toMSecsSinceEpoch() : INVALID_DATE;
+}
+
+/*****************************************************************************/
+int EpisodeStore::row_of(const QString& guid) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto s = slots_by_guid.constFind(guid);
+    if (s == slots_by_guid.constEnd()) {
+        return -1;
+    }
+    return rows[static_cast<size_t>(s.value())];
+}
+
+/*****************************************************************************/
+void EpisodeStore::index_rows() {
+    /* merges are rare compared to lookups by guid */
+    for (size_t row = 0; row < order.size(); row++) {
+        rows[static_cast<size_t>(order[row])] = static_cast<int>(row);
+    }
+}
+
+/*****************************************************************************/
+EpisodeStore::MergeResult EpisodeStore::merge(
+    std::vector<EpisodeRecord> records, size_t max_episodes) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << records.size();
+    MergeResult result;
+    /* If episode already in list or twice in the batch - skip it */
+    QSet<QString> batch_guids;
+    auto known = [&](EpisodeRecord& record) {
+        if (record.guid.isEmpty()) {
+            record.guid = record.url.toString();
+        }
+        if (slots_by_guid.contains(record.guid) ||
+            batch_guids.contains(record.guid)) {
+            qCDebug(CLASS_LC) << record.guid << "already in list";
+            return true;
+        }
+        batch_guids.insert(record.guid);
+        return false;
+    };
+    records.erase(std::remove_if(records.begin(), records.end(), known),
+        records.end());
+    if (records.empty()) {
+        return result;
+    }
+    /* later episodes of the batch go before earlier ones of the same date,
+     * new episodes before existing ones - same order as single inserts */
+    std::reverse(records.begin(), records.end());
+    std::stable_sort(records.begin(), records.end(),
+        [](const EpisodeRecord& lhs, const EpisodeRecord& rhs) {
+            return date_key(lhs.publication_date) >
+                date_key(rhs.publication_date);
+        });
+
+    QSet<int> new_slots;
+    std::vector<int> batch;
+    batch.reserve(records.size());
+    for (auto& record : records) {
+        auto s = allocate(std::move(record));
+        new_slots.insert(s);
+        batch.push_back(s);
+    }
+    /* parsed copies are no longer needed, slots use pooled strings */
+    records.clear();
+    /* one merge of two sorted ranges of slot numbers, values stay put */
+    order.insert(order.begin(), batch.begin(), batch.end());
+    std::inplace_merge(order.begin(),
+        order.begin() + static_cast<std::ptrdiff_t>(batch.size()), order.end(),
+        [this](int lhs, int rhs) { return dates[lhs] > dates[rhs]; });
+    while (order.size() > max_episodes) {
+        auto oldest = order.back();
+        order.pop_back();
+        /* new episode older than all kept episodes is never added */
+        if (!new_slots.remove(oldest)) {
+            result.removed++;
+        }
+        release(oldest);
+    }
+    prune_pool();
+    index_rows();
+    for (auto s : batch) {
+        if (new_slots.contains(s)) {
+            result.inserted.push_back(guids[s]);
+        }
+    }
+    return result;
+}
+
+/*****************************************************************************/
+void EpisodeStore::clear() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    *this = EpisodeStore();
+}
+
+/*****************************************************************************/
+EpisodeRecord EpisodeStore::record(int row) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto s = slot(row);
+    EpisodeRecord values;
+    values.title = titles[s];
+    values.publisher = publishers[s];
+    values.guid = guids[s];
+    values.url = url(row);
+    values.publication_date = publication_date(row);
+    values.duration = durations[s];
+    values.position = positions[s];
+    values.description = descriptions[s];
+    values.mapped_description = mapped_descriptions[s];
+    values.summary = summaries[s];
+    return values;
+}
+
+/*****************************************************************************/
+void EpisodeStore::update(int row, const EpisodeRecord& values) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    assign(slot(row), values);
+    /* updates come from setters of episode objects and are rare */
+    prune_pool();
+}
+
+/*****************************************************************************/
+void EpisodeStore::set_position(int row, qint64 position) {
+    auto s = slot(row);
+    positions[s] = position;
+    if (!listened_flags[s] && listened(row)) {
+        listened_flags[s] = true;
+    }
+}
+
+/*****************************************************************************/
+void EpisodeStore::set_description(int row, const QString& description) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    EpisodeRecord values;
+    values.description = description;
+    assign_description(slot(row), values);
+    prune_pool();
+}
+
+/*****************************************************************************/
+QUrl EpisodeStore::url(int row) const {
+    auto s = slot(row);
+    return QUrl(url_dirs[s] + url_files[s]);
+}
+
+/*****************************************************************************/
+QDateTime EpisodeStore::publication_date(int row) const {
+    auto date = dates[slot(row)];
+    if (date == INVALID_DATE) {
+        return QDateTime();
+    }
+    return QDateTime::fromMSecsSinceEpoch(date);
+}
+
+/*****************************************************************************/
+QString EpisodeStore::description(int row) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto s = slot(row);
+    if (mapped_descriptions[s].is_valid()) {
+        decoded++;
+        return mapped_descriptions[s].to_string();
+    }
+    return descriptions[s];
+}
+
+/*****************************************************************************/
+const QString& EpisodeStore::summary(int row) const {
+    auto s = slot(row);
+    if (!summarized[s]) {
+        /* description() counts decoding from the cache file */
+        if (!mapped_descriptions[s].is_valid()) {
+            decoded++;
+        }
+        summaries[s] = pool.intern(description_summary(description(row)));
+        summarized[s] = true;
+    }
+    return summaries[s];
+}
+
+/*****************************************************************************/
+QString EpisodeStore::display_name(int row) const {
+    const auto& t = title(row);
+    const auto& p = publisher(row);
+    if (p.isEmpty()) {
+        return t;
+    }
+    if (t.isEmpty()) {
+        return p;
+    }
+    return p + ": " + t;
+}
+
+/*****************************************************************************/
+bool EpisodeStore::listened(int row) const {
+    if (listened_flags[slot(row)]) {
+        return true;
+    }
+    auto d = duration(row);
+    /* same threshold as PodcastEpisode::set_position() */
+    return d != 0 && (MIN_LISTENED_PERC * position(row)) / d >= 1;
+}
+
+/*****************************************************************************/
+std::shared_ptr<PodcastEpisode> EpisodeStore::facade(int row) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return facades.value(slot(row)).lock();
+}
+
+/*****************************************************************************/
+void EpisodeStore::set_facade(
+    int row, const std::shared_ptr<PodcastEpisode>& episode) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    facades.insert(slot(row), episode);
+}
+
+/*****************************************************************************/
+std::shared_ptr<PodcastEpisode> EpisodeStore::create_episode(int row) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto s = slot(row);
+    auto ep = std::make_shared<PodcastEpisode>(titles[s], url(row));
+    ep->set_publisher(publishers[s]);
+    ep->set_guid(guids[s]);
+    auto date = publication_date(row);
+    if (date.isValid()) {
+        ep->set_publication_date(date);
+    }
+    ep->set_duration(durations[s]);
+    ep->set_position(positions[s]);
+    if (listened_flags[s]) {
+        ep->set_listened();
+    }
+    if (mapped_descriptions[s].is_valid()) {
+        ep->set_mapped_description(mapped_descriptions[s]);
+    } else {
+        ep->set_description(descriptions[s]);
+    }
+    return ep;
+}
+
+/*****************************************************************************/
+int EpisodeStore::allocate(EpisodeRecord&& values) {
+    int s;
+    if (free_slots.empty()) {
+        s = static_cast<int>(guids.size());
+        guids.emplace_back();
+        titles.emplace_back();
+        publishers.emplace_back();
+        url_dirs.emplace_back();
+        url_files.emplace_back();
+        descriptions.emplace_back();
+        mapped_descriptions.emplace_back();
+        summaries.emplace_back();
+        summarized.emplace_back(false);
+        dates.emplace_back();
+        durations.emplace_back();
+        positions.emplace_back();
+        listened_flags.emplace_back(false);
+        rows.emplace_back(-1);
+    } else {
+        s = free_slots.back();
+        free_slots.pop_back();
+    }
+    guids[s] = std::move(values.guid);
+    assign(s, values);
+    assign_description(s, values);
+    slots_by_guid.insert(guids[s], s);
+    return s;
+}
+
+/*****************************************************************************/
+void EpisodeStore::assign(int s, const EpisodeRecord& values) {
+    titles[s] = values.title;
+    assign_pooled(publishers[s], values.publisher);
+    auto url = values.url.toString();
+    auto file_start = url_file_name_start(url);
+    assign_pooled(url_dirs[s], url.left(file_start));
+    url_files[s] = url.mid(file_start);
+    dates[s] = date_key(values.publication_date);
+    durations[s] = values.duration;
+    positions[s] = values.position;
+    /* same threshold as PodcastEpisode::set_position() */
+    if (values.duration != 0 &&
+        (MIN_LISTENED_PERC * values.position) / values.duration >= 1) {
+        listened_flags[s] = true;
+    }
+}
+
+/*****************************************************************************/
+void EpisodeStore::assign_description(int s, const EpisodeRecord& values) {
+    if (values.mapped_description.is_valid()) {
+        assign_pooled(descriptions[s], QString());
+        mapped_descriptions[s] = values.mapped_description;
+    } else {
+        assign_pooled(descriptions[s], values.description);
+        mapped_descriptions[s] = MappedText();
+    }
+    /* parser and cache provide it, other sources decode the description
+     * only when the summary is displayed */
+    assign_pooled(summaries[s], values.summary);
+    summarized[s] = !values.summary.isEmpty();
+}
+
+/*****************************************************************************/
+void EpisodeStore::assign_pooled(QString& column, const QString& value) {
+    auto interned = pool.intern(value);
+    if (!column.isEmpty() && column.constData() != interned.constData()) {
+        pool_stale = true;
+    }
+    column = interned;
+}
+
+/*****************************************************************************/
+void EpisodeStore::prune_pool() {
+    if (pool_stale) {
+        pool.prune();
+        pool_stale = false;
+    }
+}
+
+/*****************************************************************************/
+EpisodeStore::StringUsage EpisodeStore::string_usage() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    StringUsage usage;
+    QSet<const QChar*> buffers;
+    auto account = [&](const QString& str) {
+        auto bytes = static_cast<qint64>(str.capacity()) * sizeof(QChar);
+        usage.unshared += bytes;
+        if (!str.isEmpty() && !buffers.contains(str.constData())) {
+            buffers.insert(str.constData());
+            usage.stored += bytes;
+        }
+    };
+    for (auto s : order) {
+        account(guids[s]);
+        account(titles[s]);
+        account(publishers[s]);
+        account(url_dirs[s]);
+        account(url_files[s]);
+        account(descriptions[s]);
+        account(summaries[s]);
+    }
+    return usage;
+}
+
+/*****************************************************************************/
+void EpisodeStore::release(int s) {
+    slots_by_guid.remove(guids[s]);
+    facades.remove(s);
+    guids[s].clear();
+    titles[s].clear();
+    publishers[s].clear();
+    url_dirs[s].clear();
+    url_files[s].clear();
+    descriptions[s].clear();
+    mapped_descriptions[s] = MappedText();
+    summaries[s].clear();
+    summarized[s] = false;
+    listened_flags[s] = false;
+    rows[static_cast<size_t>(s)] = -1;
+    free_slots.push_back(s);
+    pool_stale = true;
+}
+
+/*****************************************************************************/
+EpisodeRecord DigitalRooster::record_from_episode(
+    const PodcastEpisode& episode) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    EpisodeRecord values;
+    values.title = episode.get_title();
+    values.publisher = episode.get_publisher();
+    values.guid = episode.get_guid();
+    values.url = episode.get_url();
+    values.publication_date = episode.get_publication_date();
+    values.duration = episode.get_duration();
+    values.position = episode.get_position();
+    values.mapped_description = episode.get_mapped_description();
+    if (!values.mapped_description.is_valid()) {
+        values.description = episode.get_description();
+    }
+    return values;
+}
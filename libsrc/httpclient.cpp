@@ -5,35 +5,310 @@
  */
 
 #include <QLoggingCategory>
+#include <algorithm>
 #include <vector>
 
 #include "appconstants.hpp"
 #include "httpclient.hpp"
+#include "network_service.hpp"
 
 using namespace DigitalRooster;
 
 static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.HttpClient");
 
+/*****************************************************************************/
+/**
+ * Failures caused by the host or network that may succeed later
+ * @param error reply error
+ * @param status HTTP status code or 0
+ * @return true for timeouts, connection and server errors (5xx)
+ */
+static bool is_transient(QNetworkReply::NetworkError error, int status) {
+    if (status >= 500) {
+        return true;
+    }
+    switch (error) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyConnectionRefusedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*****************************************************************************/
+/**
+ * First byte of a partial response
+ * @param reply response with status 206
+ * @return offset from "Content-Range: bytes <first>-<last>/<size>"
+ */
+static qint64 content_range_start(QNetworkReply* reply) {
+    auto range = reply->rawHeader("Content-Range");
+    auto first = range.mid(range.indexOf(' ') + 1);
+    return first.left(first.indexOf('-')).toLongLong();
+}
+
 /*****************************************************************************/
 HttpClient::HttpClient() {
-    connect(&manager, &QNetworkAccessManager::finished, this,
-        &HttpClient::downloadFinished);
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    connect(&pace_timer, &QTimer::timeout, this, &HttpClient::read_paced);
+    /* buffered data is read at once when playback stops */
+    connect(NetworkService::get_instance(),
+        &NetworkService::background_throttled, this,
+        [this](bool throttled) {
+            if (!throttled && pace_timer.isActive()) {
+                read_paced();
+            }
+        });
+}
+
+/*****************************************************************************/
+HttpClient::~HttpClient() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    abort();
+}
+
+/*****************************************************************************/
+void HttpClient::set_streaming(bool enable) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << enable;
+    streaming = enable;
 }
 
 /*****************************************************************************/
 void HttpClient::doDownload(const QUrl& url) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO << "(" << url.toString() << ")";
-    QNetworkRequest request(url);
+    doDownload(QNetworkRequest(url));
+}
+
+/*****************************************************************************/
+void HttpClient::set_timeouts(
+    std::chrono::milliseconds connect, std::chrono::milliseconds transfer) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << connect.count() << transfer.count();
+    connect_timeout = connect;
+    transfer_timeout = transfer;
+}
+
+/*****************************************************************************/
+void HttpClient::set_priority(RequestPriority priority) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << static_cast<int>(priority);
+    this->priority = priority;
+}
+
+/*****************************************************************************/
+void HttpClient::set_retries(
+    int max_retries, std::chrono::milliseconds backoff) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << max_retries << backoff.count();
+    this->max_retries = max_retries;
+    retry_backoff = backoff;
+}
+
+/*****************************************************************************/
+void HttpClient::doDownload(QNetworkRequest request) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << "(" << request.url().toString() << ")";
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
         QNetworkRequest::NoLessSafeRedirectPolicy);
-    QNetworkReply* reply = manager.get(request);
+    send(request, 0);
+}
+
+/*****************************************************************************/
+void HttpClient::send(const QNetworkRequest& request, int attempt) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << attempt;
+    auto service = NetworkService::get_instance();
+    if (!service->allow_request(request.url().host())) {
+        qCWarning(CLASS_LC) << "host unavailable, not sending"
+                            << request.url().toEncoded().constData();
+        /* report asynchronously like any other failed download */
+        scheduled++;
+        QTimer::singleShot(0, this, [this, gen = generation]() {
+            if (gen != generation) {
+                return;
+            }
+            scheduled--;
+            fail();
+        });
+        return;
+    }
+
+    scheduled++;
+    service->enqueue(priority, this,
+        [this, request, attempt, gen = generation]() {
+            if (gen != generation) {
+                return;
+            }
+            scheduled--;
+            start(request, attempt);
+        });
+}
+
+/*****************************************************************************/
+void HttpClient::start(const QNetworkRequest& request, int attempt) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << attempt;
+    auto reply = NetworkService::get_instance()->get(request, priority);
+    connect(reply, &QNetworkReply::finished, this,
+        [this, reply]() { downloadFinished(reply); });
+    if (streaming) {
+        /* bound memory: network layer pauses if we don't read */
+        reply->setReadBufferSize(RSS_STREAM_CHUNK_SIZE);
+        connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+            /* unread data makes the network layer stop receiving */
+            if (is_throttled()) {
+                if (!pace_timer.isActive()) {
+                    pace_timer.start(NetworkService::get_instance()
+                                         ->get_background_read_interval());
+                }
+                return;
+            }
+            read_reply(reply, -1);
+        });
+    }
+
+    /* connect timeout until headers arrive, then restarted with the
+     * transfer timeout whenever data is received */
+    auto watchdog = new QTimer(reply);
+    watchdog->setSingleShot(true);
+    watchdog->start(connect_timeout);
+    auto transfer = transfer_timeout;
+    connect(reply, &QNetworkReply::metaDataChanged, watchdog,
+        [watchdog, transfer]() { watchdog->start(transfer); });
+    connect(reply, &QNetworkReply::downloadProgress, watchdog,
+        [watchdog, transfer]() { watchdog->start(transfer); });
+    connect(watchdog, &QTimer::timeout, this,
+        [this, reply]() { timeout(reply); });
 
 #if QT_CONFIG(ssl)
     connect(reply, &QNetworkReply::sslErrors, this, &HttpClient::sslErrors);
 #endif
 
-    pending_downloads.push_back(reply);
+    pending_downloads.push_back(Download{reply, request, attempt, false});
+}
+
+/*****************************************************************************/
+void HttpClient::abort() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    generation++;
+    scheduled = 0;
+    NetworkService::get_instance()->dequeue(this);
+    /* aborted replies are not reported in downloadFinished */
+    auto downloads = std::move(pending_downloads);
+    pending_downloads.clear();
+    for (auto& download : downloads) {
+        disconnect(download.reply, nullptr, this, nullptr);
+        download.reply->abort();
+        download.reply->deleteLater();
+    }
+}
+
+/*****************************************************************************/
+bool HttpClient::is_throttled() const {
+    return streaming && priority == RequestPriority::Background &&
+        NetworkService::get_instance()->is_background_throttled();
+}
+
+/*****************************************************************************/
+void HttpClient::read_reply(QNetworkReply* reply, int max_chunks) {
+    auto pending = find_download(reply);
+    if (pending != pending_downloads.end() &&
+        readChunk(reply, pending->streamed, max_chunks)) {
+        /* receivers may have changed pending_downloads */
+        pending = find_download(reply);
+        if (pending != pending_downloads.end()) {
+            pending->streamed = true;
+        }
+    }
+}
+
+/*****************************************************************************/
+void HttpClient::read_paced() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto max_chunks = is_throttled() ? 1 : -1;
+    /* receivers may abort or start downloads while reading */
+    std::vector<QNetworkReply*> replies;
+    for (const auto& download : pending_downloads) {
+        replies.push_back(download.reply);
+    }
+    for (auto reply : replies) {
+        read_reply(reply, max_chunks);
+    }
+    auto buffered = std::any_of(pending_downloads.begin(),
+        pending_downloads.end(),
+        [](const Download& d) { return d.reply->bytesAvailable() > 0; });
+    if (max_chunks < 0 || !buffered) {
+        /* readyRead starts the timer again */
+        pace_timer.stop();
+    }
+}
+
+/*****************************************************************************/
+std::vector<HttpClient::Download>::iterator HttpClient::find_download(
+    QNetworkReply* reply) {
+    return std::find_if(pending_downloads.begin(), pending_downloads.end(),
+        [reply](const Download& d) { return d.reply == reply; });
+}
+
+/*****************************************************************************/
+void HttpClient::timeout(QNetworkReply* reply) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto pending = find_download(reply);
+    if (pending == pending_downloads.end()) {
+        return;
+    }
+    auto download = *pending;
+    pending_downloads.erase(pending);
+
+    auto host = download.request.url().host();
+    qCWarning(CLASS_LC) << "Download timed out"
+                        << download.request.url().toEncoded().constData();
+    auto service = NetworkService::get_instance();
+    service->count_timeout(host);
+    service->report_result(host, true);
+    disconnect(reply, nullptr, this, nullptr);
+    reply->abort();
+    reply->deleteLater();
+    retry_or_fail(download, true);
+}
+
+/*****************************************************************************/
+void HttpClient::retry_or_fail(const Download& download, bool transient) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << transient;
+    if (transient && !download.streamed && download.attempt < max_retries) {
+        auto delay = retry_backoff * (1 << download.attempt);
+        qCInfo(CLASS_LC) << "retry in" << delay.count() << "ms"
+                         << download.request.url().toEncoded().constData();
+        NetworkService::get_instance()->count_retry(
+            download.request.url().host());
+        scheduled++;
+        QTimer::singleShot(delay, this,
+            [this, request = download.request,
+                attempt = download.attempt + 1, gen = generation]() {
+                if (gen != generation) {
+                    return;
+                }
+                scheduled--;
+                send(request, attempt);
+            });
+        return;
+    }
+    fail();
+}
+
+/*****************************************************************************/
+void HttpClient::fail() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto gen = generation;
+    if (streaming) {
+        emit streamFinished(false);
+    }
+    /* unless a receiver aborted meanwhile */
+    if (gen == generation) {
+        emit downloadFailed();
+    }
 }
 
 /*****************************************************************************/
@@ -51,16 +326,79 @@ void HttpClient::
 /*****************************************************************************/
 void HttpClient::downloadFinished(QNetworkReply* reply) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto pending = find_download(reply);
+    if (pending == pending_downloads.end()) {
+        qCDebug(CLASS_LC) << "download aborted";
+        reply->deleteLater();
+        return;
+    }
+    auto download = *pending;
+    pending_downloads.erase(pending);
+    /* signals below may start new downloads or abort */
+    reply->deleteLater();
+
     QUrl url = reply->url();
-    if (reply->error()) {
+    auto service = NetworkService::get_instance();
+    auto host = download.request.url().host();
+    auto status =
+        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 304) {
+        qCDebug(CLASS_LC) << "Not modified:" << url.toEncoded().constData();
+        service->report_result(host, false);
+        emit notModified();
+    } else if (reply->error()) {
         qCCritical(CLASS_LC) << "Download failed" << url.toEncoded().constData()
                              << qPrintable(reply->errorString());
+        auto transient = is_transient(reply->error(), status);
+        service->report_result(host, transient);
+        retry_or_fail(download, transient);
     } else {
-        emit dataAvailable(reply->readAll());
+        service->report_result(host, false);
+        emit validatorsAvailable(
+            reply->rawHeader("ETag"), reply->rawHeader("Last-Modified"));
+        if (streaming) {
+            auto gen = generation;
+            readChunk(reply, download.streamed);
+            /* unless a receiver aborted while reading */
+            if (gen == generation) {
+                emit streamFinished(true);
+            }
+        } else {
+            emit dataAvailable(reply->readAll());
+        }
     }
+}
 
-    auto end_it =
-        std::remove(pending_downloads.begin(), pending_downloads.end(), reply);
-    pending_downloads.erase(end_it, pending_downloads.end());
-    reply->deleteLater();
+/*****************************************************************************/
+bool HttpClient::readChunk(
+    QNetworkReply* reply, bool started, int max_chunks) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    /* no status for non-HTTP URLs, e.g. file:// */
+    auto partial = status.toInt() == 206;
+    auto content = !status.isValid() || status.toInt() == 200 || partial;
+    auto gen = generation;
+    auto emitted = false;
+    /* always read - an unread error page would stall the download */
+    while (reply->bytesAvailable() > 0 && max_chunks != 0) {
+        max_chunks--;
+        auto chunk = reply->read(RSS_STREAM_CHUNK_SIZE);
+        if (!content) {
+            continue;
+        }
+        if (!started) {
+            started = true;
+            emit streamStarted(partial ? content_range_start(reply) : 0);
+        }
+        emitted = true;
+        /* receivers may abort, the reply must not be read afterwards */
+        if (gen != generation) {
+            break;
+        }
+        emit chunkAvailable(chunk);
+        if (gen != generation) {
+            break;
+        }
+    }
+    return emitted;
 }
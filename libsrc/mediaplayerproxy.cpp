@@ -9,6 +9,7 @@
 #include <QMediaPlayer>
 
 #include "PlayableItem.hpp"
+#include "episode_downloader.hpp"
 #include "mediaplayerproxy.hpp"
 
 using namespace DigitalRooster;
@@ -180,6 +181,13 @@ double MediaPlayerProxy::do_get_volume() const {
     return linear_volume;
 }
 
+/*****************************************************************************/
+void MediaPlayerProxy::set_episode_downloader(
+    std::shared_ptr<EpisodeDownloader> downloader) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    episode_downloader = downloader;
+}
+
 /*****************************************************************************/
 void MediaPlayerProxy::do_set_media(
     std::shared_ptr<DigitalRooster::PlayableItem> media) {
@@ -187,7 +195,16 @@ void MediaPlayerProxy::do_set_media(
     current_item = media;
     auto previous_position = media->get_position();
 
-    backend->setMedia(QMediaContent(media->get_url()));
+    auto url = media->get_url();
+    auto episode = std::dynamic_pointer_cast<PodcastEpisode>(media);
+    if (episode && episode_downloader) {
+        auto local = episode_downloader->get_local_url(episode->get_guid());
+        if (!local.isEmpty()) {
+            qCInfo(CLASS_LC) << "playing downloaded file" << local;
+            url = local;
+        }
+    }
+    backend->setMedia(QMediaContent(url));
     if (previous_position != 0) {
         qCDebug(CLASS_LC) << "restarting from position" << previous_position;
         set_position(previous_position);
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QLoggingCategory>
+#include <QNetworkDiskCache>
+#include <QNetworkReply>
+#include <QTimer>
+
+#include <algorithm>
+#include <memory>
+
+#include "network_service.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.NetworkService");
+
+/**
+ * The instance created in main()
+ */
+static NetworkService* instance = nullptr;
+
+/*****************************************************************************/
+NetworkService* NetworkService::get_instance() {
+    Q_ASSERT(instance != nullptr);
+    return instance;
+}
+
+/*****************************************************************************/
+NetworkService::NetworkService(QObject* parent)
+    : QObject(parent) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    Q_ASSERT(instance == nullptr);
+    instance = this;
+}
+
+/*****************************************************************************/
+NetworkService::~NetworkService() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    instance = nullptr;
+}
+
+/*****************************************************************************/
+QNetworkReply* NetworkService::get(
+    QNetworkRequest request, RequestPriority priority) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << request.url().toString();
+    /* only used if the server negotiates it, falls back to HTTP/1.1 */
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    /* order of requests waiting for a connection to the same host */
+    switch (priority) {
+    case RequestPriority::Normal:
+        request.setPriority(QNetworkRequest::NormalPriority);
+        break;
+    case RequestPriority::Background:
+        request.setPriority(QNetworkRequest::LowPriority);
+        active_background++;
+        break;
+    }
+    auto host = request.url().host();
+    hosts[host].requests++;
+
+    auto reply = manager.get(request);
+    auto received = std::make_shared<qint64>(0);
+    connect(reply, &QNetworkReply::downloadProgress, this,
+        [received](qint64 bytes, qint64 /*total*/) { *received = bytes; });
+    connect(reply, &QNetworkReply::finished, this,
+        [this, reply, received, priority]() {
+            count_reply(reply, *received);
+            if (priority == RequestPriority::Background) {
+                active_background--;
+                /* not from within finished() of the reply */
+                QTimer::singleShot(0, this, &NetworkService::dispatch);
+            }
+        });
+    return reply;
+}
+
+/*****************************************************************************/
+void NetworkService::enqueue(RequestPriority priority, QObject* owner,
+    std::function<void()> start) {
+    queue.push_back(Queued{priority, QPointer<QObject>(owner), start});
+    dispatch();
+}
+
+/*****************************************************************************/
+void NetworkService::dequeue(QObject* owner) {
+    queue.erase(std::remove_if(queue.begin(), queue.end(),
+                    [owner](const Queued& q) { return q.owner == owner; }),
+        queue.end());
+}
+
+/*****************************************************************************/
+bool NetworkService::admit(RequestPriority priority) const {
+    if (priority != RequestPriority::Background || !playing) {
+        return true;
+    }
+    return active_background < background_limit;
+}
+
+/*****************************************************************************/
+void NetworkService::dispatch() {
+    while (!queue.empty()) {
+        /* first of the highest priority, FIFO for same priority */
+        auto next = std::min_element(queue.begin(), queue.end(),
+            [](const Queued& a, const Queued& b) {
+                return a.priority < b.priority;
+            });
+        if (!admit(next->priority)) {
+            return;
+        }
+        auto entry = std::move(*next);
+        queue.erase(next);
+        if (entry.owner) {
+            entry.start();
+        }
+    }
+}
+
+/*****************************************************************************/
+void NetworkService::set_background_limit(int limit) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << limit;
+    background_limit = limit;
+    dispatch();
+}
+
+/*****************************************************************************/
+void NetworkService::set_background_read_interval(
+    std::chrono::milliseconds interval) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << interval.count();
+    background_read_interval = interval;
+}
+
+/*****************************************************************************/
+void NetworkService::playback_state_changed(QMediaPlayer::State state) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << state;
+    auto was_playing = playing;
+    playing = (state == QMediaPlayer::PlayingState);
+    if (playing != was_playing) {
+        /* running downloads are only throttled by their clients */
+        emit background_throttled(playing);
+    }
+    if (!playing) {
+        dispatch();
+    }
+}
+
+/*****************************************************************************/
+void NetworkService::count_reply(QNetworkReply* reply, qint64 bytes) {
+    auto& stats = hosts[reply->request().url().host()];
+    if (reply->error() != QNetworkReply::NoError) {
+        stats.errors++;
+    }
+    if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute)
+            .toBool()) {
+        stats.cache_hits++;
+    } else {
+        stats.bytes_received += bytes;
+    }
+    if (reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool()) {
+        stats.http2++;
+    }
+}
+
+/*****************************************************************************/
+void NetworkService::set_cache_directory(
+    const QString& path, qint64 max_bytes) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << path << max_bytes;
+    /* manager takes ownership and deletes the previous cache */
+    disk_cache = new QNetworkDiskCache();
+    disk_cache->setCacheDirectory(path);
+    disk_cache->setMaximumCacheSize(max_bytes);
+    manager.setCache(disk_cache);
+}
+
+/*****************************************************************************/
+qint64 NetworkService::get_cache_size() const {
+    return disk_cache ? disk_cache->cacheSize() : 0;
+}
+
+/*****************************************************************************/
+HostStatistics NetworkService::get_total_statistics() const {
+    HostStatistics total;
+    for (const auto& stats : hosts) {
+        total.requests += stats.requests;
+        total.cache_hits += stats.cache_hits;
+        total.http2 += stats.http2;
+        total.errors += stats.errors;
+        total.bytes_received += stats.bytes_received;
+        total.timeouts += stats.timeouts;
+        total.retries += stats.retries;
+        total.circuits_opened += stats.circuits_opened;
+        total.rejected += stats.rejected;
+    }
+    return total;
+}
+
+/*****************************************************************************/
+void NetworkService::log_statistics() const {
+    auto log = [](const QString& name, const HostStatistics& stats) {
+        qCInfo(CLASS_LC) << name << "requests:" << stats.requests
+                         << "cache hits:" << stats.cache_hits
+                         << "HTTP/2:" << stats.http2
+                         << "errors:" << stats.errors
+                         << "bytes received:" << stats.bytes_received
+                         << "timeouts:" << stats.timeouts
+                         << "retries:" << stats.retries
+                         << "circuits opened:" << stats.circuits_opened
+                         << "rejected:" << stats.rejected;
+    };
+    log("total", get_total_statistics());
+    for (auto it = hosts.cbegin(); it != hosts.cend(); ++it) {
+        log(it.key(), it.value());
+    }
+}
+
+/*****************************************************************************/
+void NetworkService::set_circuit_breaker(
+    int failures, std::chrono::milliseconds open_time) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << failures << open_time.count();
+    circuit_failures = failures;
+    circuit_open_time = open_time;
+}
+
+/*****************************************************************************/
+bool NetworkService::is_circuit_open(const QString& host) const {
+    auto circuit = circuits.constFind(host);
+    if (circuit == circuits.constEnd()) {
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    return now < circuit->open_until || now < circuit->probe_until;
+}
+
+/*****************************************************************************/
+bool NetworkService::allow_request(const QString& host) {
+    if (is_circuit_open(host)) {
+        hosts[host].rejected++;
+        return false;
+    }
+    auto circuit = circuits.find(host);
+    /* half open, this request is the probe */
+    if (circuit != circuits.end() && circuit->failures >= circuit_failures) {
+        qCInfo(CLASS_LC) << "probing" << host;
+        circuit->probe_until =
+            std::chrono::steady_clock::now() + circuit_open_time;
+    }
+    return true;
+}
+
+/*****************************************************************************/
+void NetworkService::report_result(const QString& host, bool host_failure) {
+    if (!host_failure) {
+        circuits.remove(host);
+        return;
+    }
+    auto& circuit = circuits[host];
+    circuit.failures++;
+    circuit.probe_until = std::chrono::steady_clock::time_point();
+    /* after the open time a single failure opens the circuit again */
+    if (circuit.failures >= circuit_failures) {
+        qCWarning(CLASS_LC) << "circuit breaker open for" << host;
+        circuit.open_until =
+            std::chrono::steady_clock::now() + circuit_open_time;
+        hosts[host].circuits_opened++;
+    }
+}
+
+/*****************************************************************************/
+void NetworkService::count_timeout(const QString& host) {
+    hosts[host].timeouts++;
+}
+
+/*****************************************************************************/
+void NetworkService::count_retry(const QString& host) {
+    hosts[host].retries++;
+}
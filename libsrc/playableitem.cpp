@@ -32,8 +32,8 @@ void PlayableItem::set_position(qint64 newVal) {
 
     if (newVal >= 0) {
         position = newVal;
+        /* not data_changed: position ticks must not rewrite caches */
         emit position_updated(newVal);
-        emit data_changed();
     }
 };
 
@@ -134,12 +134,25 @@ PodcastEpisode::PodcastEpisode(const QString& title, const QUrl& url)
 
 /***********************************************************************/
 const QString& PodcastEpisode::get_description() const {
+    if (mapped_description.is_valid()) {
+        /* decode once, release the reference to the cache file */
+        description = mapped_description.to_string();
+        mapped_description = MappedText();
+    }
     return description;
 }
 
+/***********************************************************************/
+void PodcastEpisode::set_mapped_description(const MappedText& desc) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    description.clear();
+    mapped_description = desc;
+}
+
 /***********************************************************************/
 void PodcastEpisode::set_description(const QString& desc) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    mapped_description = MappedText();
     description = desc;
     emit description_changed(desc);
     emit data_changed();
@@ -193,6 +206,15 @@ void PodcastEpisode::set_position(qint64 newVal) {
     }
 }
 
+/***********************************************************************/
+void PodcastEpisode::set_listened() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (!listened) {
+        listened = true;
+        emit listened_changed(true);
+    }
+}
+
 /***********************************************************************/
 bool PodcastEpisode::already_listened() const {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
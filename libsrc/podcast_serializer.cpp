@@ -4,15 +4,23 @@
  * Licensed under GNU PUBLIC LICENSE Version 3 or later
  */
 
+#include <QBuffer>
 #include <QFile>
+#include <QFileInfo>
 #include <QImage>
+#include <QImageReader>
 #include <QLoggingCategory>
+#include <QtConcurrent>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include "PodcastSource.hpp"
 #include "appconstants.hpp"
+#include "cache_writer.hpp"
 #include "podcast_serializer.hpp"
 #include "timeprovider.hpp"
+#include "util.hpp"
 
 using namespace DigitalRooster;
 static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.PodcastSerializer");
@@ -27,12 +35,18 @@ PodcastSerializer::PodcastSerializer(const QDir& app_cache_dir,
     writeTimer.setInterval(delay);
     writeTimer.setSingleShot(true);
     connect(&writeTimer, &QTimer::timeout, this, &PodcastSerializer::write);
+    connect(&image_watcher, &QFutureWatcher<bool>::finished, this,
+        &PodcastSerializer::image_stored);
 }
 
 /*****************************************************************************/
 PodcastSerializer::~PodcastSerializer() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     writeTimer.stop();
+    if (cache_writer) {
+        cache_writer->cancel(this);
+    }
+    /* running file operations keep file_ops alive */
 }
 
 /*****************************************************************************/
@@ -46,7 +60,7 @@ void PodcastSerializer::restore_info() {
         } catch (std::system_error&) {
             qCWarning(CLASS_LC) << "Cache file not found" << cache_file;
         } catch (PodcastSourceJSonCorrupted& jsexc) {
-            qCWarning(CLASS_LC) << "corrupted JSON in file" << cache_file
+            qCWarning(CLASS_LC) << "corrupted cache file" << cache_file
                                 << ": " << jsexc.what();
         }
     }
@@ -58,6 +72,13 @@ void PodcastSerializer::set_podcast_source(PodcastSource* source) {
     ps = source;
 }
 
+/*****************************************************************************/
+void PodcastSerializer::set_cache_writer(std::shared_ptr<CacheWriter> writer) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    writeTimer.stop();
+    cache_writer = std::move(writer);
+}
+
 /*****************************************************************************/
 void PodcastSerializer::write() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
@@ -70,7 +91,29 @@ void PodcastSerializer::write() {
 void PodcastSerializer::write_cache() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
     auto cache_file = cache_dir.filePath(ps->get_id_string());
-    store_to_file(ps, cache_file);
+    auto cache = podcast_cache_from_podcast_source(ps);
+    if (cache_writer) {
+        cache_writer->submit(cache_file, std::move(cache));
+        return;
+    }
+    run_file_operation(
+        [cache, cache_file]() { write_podcast_cache(cache, cache_file); });
+}
+
+/*****************************************************************************/
+void PodcastSerializer::run_file_operation(std::function<void()> op) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto seq = ++file_ops->submitted;
+    auto ops = file_ops;
+    QtConcurrent::run(&worker_pool(), [ops, seq, op]() {
+        QMutexLocker lock(&ops->mutex);
+        /* operations on the same file must not overtake each other */
+        if (seq < ops->completed) {
+            return;
+        }
+        op();
+        ops->completed = seq;
+    });
 }
 
 /*****************************************************************************/
@@ -84,14 +127,23 @@ void PodcastSerializer::delete_cached_info() {
 /*****************************************************************************/
 void PodcastSerializer::delete_cache() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    QFile cache_file(cache_dir.filePath(ps->get_id_string()));
-    cache_file.remove();
+    auto file_path = cache_dir.filePath(ps->get_id_string());
+    /* a running write would recreate the file */
+    if (cache_writer) {
+        cache_writer->cancel(this);
+        cache_writer->discard(file_path);
+        QFile::remove(file_path);
+        return;
+    }
+    run_file_operation([file_path]() { QFile::remove(file_path); });
 }
 
 /*****************************************************************************/
 void PodcastSerializer::delayed_write() {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    if (!writeTimer.isActive()) {
+    if (cache_writer) {
+        cache_writer->schedule(this);
+    } else if (!writeTimer.isActive()) {
         writeTimer.start(); // start delayed write
     }
 }
@@ -105,42 +157,122 @@ void PodcastSerializer::store_image(QByteArray data) {
 /*****************************************************************************/
 void PodcastSerializer::store_image_impl(QByteArray& data) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    /* Resize image and save file */
-    auto image_data = QImage::fromData(data);
-    auto small_image = image_data.scaled(DEFAULT_ICON_WIDTH, DEFAULT_ICON_WIDTH,
-        Qt::KeepAspectRatio, Qt::SmoothTransformation);
-
     /* Do not rely on file format info or name from URL, save it as PNG */
     auto image_cache_file_name =
         ps->create_image_file_name(ps->get_image_url());
+    pending_image_path = cache_dir.filePath(image_cache_file_name);
+
+    /* artwork is often several megapixels, decode off the GUI thread */
+    auto icon_dir = cache_dir.absolutePath();
+    image_watcher.setFuture(QtConcurrent::run(&worker_pool(),
+        [data, icon_dir, image_file_path = pending_image_path]() {
+            if (!store_icon(data, image_file_path, DEFAULT_ICON_WIDTH)) {
+                return false;
+            }
+            evict_icons(QDir(icon_dir), ICON_CACHE_MAX_BYTES, image_file_path);
+            return true;
+        }));
+}
 
-    auto image_file_path = cache_dir.filePath(image_cache_file_name);
-    if (small_image.save(image_file_path)) {
+/*****************************************************************************/
+void PodcastSerializer::image_stored() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (ps == nullptr) {
+        return;
+    }
+    if (image_watcher.result()) {
         // Store image path if successful
-        ps->set_image_file_path(image_file_path);
+        ps->set_image_file_path(pending_image_path);
     } else {
         ps->set_image_file_path("");
-        qCCritical(CLASS_LC) << "save image failed" << image_file_path;
+        qCCritical(CLASS_LC) << "save image failed" << pending_image_path;
     }
 }
 
 /*****************************************************************************/
-void DigitalRooster::store_to_file(
-    PodcastSource* ps, const QString& file_path) {
+bool DigitalRooster::store_icon(
+    const QByteArray& data, const QString& file_path, int width) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << file_path;
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    /* decoders like JPEG can skip most of the pixels for a smaller size */
+    auto size = reader.size();
+    if (size.isValid()) {
+        reader.setScaledSize(size.scaled(width, width, Qt::KeepAspectRatio));
+    }
+    auto image = reader.read();
+    if (image.isNull()) {
+        qCWarning(CLASS_LC) << "cannot decode icon" << reader.errorString();
+        return false;
+    }
+    /* handler could not report its size before decoding */
+    if (image.width() > width || image.height() > width) {
+        image = image.scaled(
+            width, width, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image.save(file_path, "PNG");
+}
+
+/*****************************************************************************/
+qint64 DigitalRooster::evict_icons(
+    const QDir& dir, qint64 max_bytes, const QString& keep) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* most recently used first */
+    auto icons = dir.entryInfoList(
+        QStringList() << "*.png", QDir::Files, QDir::Time);
+    auto keep_path = QFileInfo(keep).absoluteFilePath();
+    qint64 total = 0;
+    qint64 removed = 0;
+    for (const auto& icon : icons) {
+        total += icon.size();
+        if (total <= max_bytes || icon.absoluteFilePath() == keep_path) {
+            continue;
+        }
+        if (QFile::remove(icon.absoluteFilePath())) {
+            qCInfo(CLASS_LC) << "evicted icon" << icon.fileName();
+            removed += icon.size();
+        }
+    }
+    return removed;
+}
 
+/*****************************************************************************/
+void DigitalRooster::touch_icon(const QString& file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    QFile file(file_path);
+    /* file time can only be set on open files, append does not truncate */
+    if (file.open(QIODevice::Append)) {
+        file.setFileTime(
+            QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+}
+
+/*****************************************************************************/
+QJsonObject DigitalRooster::cache_json_from_podcast_source(
+    const PodcastSource* ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
     QJsonObject ps_obj = json_from_podcast_source(ps);
     QJsonArray episodes;
-    for (const auto& episode : ps->get_episodes()) {
-        episodes.append(episode->to_json_object());
+    /* temporary QObjects, not handed out as episodes of ps */
+    const auto& store = ps->get_episode_store();
+    for (int row = 0; row < store.size(); row++) {
+        episodes.append(store.create_episode(row)->to_json_object());
     }
     ps_obj[KEY_EPISODES] = episodes;
+    return ps_obj;
+}
 
+/*****************************************************************************/
+void DigitalRooster::write_cache_json(
+    const QJsonObject& tl_obj, const QString& file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
     QSaveFile cache_file(file_path);
     try {
         cache_file.open(
             QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
-        QJsonDocument doc(ps_obj);
+        QJsonDocument doc(tl_obj);
         cache_file.write(doc.toJson());
         cache_file.commit();
     } catch (std::exception& exc) {
@@ -149,10 +281,29 @@ void DigitalRooster::store_to_file(
 }
 
 /*****************************************************************************/
-void DigitalRooster::read_from_file(
+void DigitalRooster::store_to_file(
     PodcastSource* ps, const QString& file_path) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    write_podcast_cache(podcast_cache_from_podcast_source(ps), file_path);
+}
 
+/*****************************************************************************/
+PodcastCache DigitalRooster::podcast_cache_from_podcast_source(
+    const PodcastSource* ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    PodcastCache cache;
+    cache.source = json_from_podcast_source(ps);
+    const auto& store = ps->get_episode_store();
+    cache.episodes.reserve(store.size());
+    for (int row = 0; row < store.size(); row++) {
+        cache.episodes.push_back(store.record(row));
+    }
+    return cache;
+}
+
+/*****************************************************************************/
+QJsonObject DigitalRooster::read_cache_json(const QString& file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
     QFile file(file_path);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         qCCritical(CLASS_LC) << file.errorString();
@@ -162,39 +313,69 @@ void DigitalRooster::read_from_file(
     }
     auto json_doc = QJsonDocument::fromJson(file.readAll());
     QJsonObject tl_obj = json_doc.object();
-    if (!tl_obj.isEmpty()) {
-        parse_podcast_source_from_json(tl_obj, ps);
-        read_episodes_cache(tl_obj, ps);
-    } else {
+    if (tl_obj.isEmpty()) {
         throw PodcastSourceJSonCorrupted("Document empty!");
     }
+    return tl_obj;
+}
+
+/*****************************************************************************/
+void DigitalRooster::restore_podcast_source(
+    const QJsonObject& tl_obj, PodcastSource* ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    restore_podcast_source(podcast_cache_from_json(tl_obj), ps);
+}
+
+/*****************************************************************************/
+void DigitalRooster::restore_podcast_source(
+    const PodcastCache& cache, PodcastSource* ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    parse_podcast_source_from_json(cache.source, ps);
+    read_episodes_cache(cache.episodes, ps);
+}
+
+/*****************************************************************************/
+void DigitalRooster::read_from_file(
+    PodcastSource* ps, const QString& file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    restore_podcast_source(read_podcast_cache(file_path), ps);
 }
 
 /*****************************************************************************/
 void DigitalRooster::read_episodes_cache(
     const QJsonObject& tl_obj, PodcastSource* ps) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    auto episodes_json_array = tl_obj[KEY_EPISODES].toArray();
-    if (episodes_json_array.isEmpty()) {
-        qCWarning(CLASS_LC)
-            << "JSON for PodcastSource does not contain episodes";
+    read_episodes_cache(podcast_cache_from_json(tl_obj).episodes, ps);
+}
+
+/*****************************************************************************/
+void DigitalRooster::read_episodes_cache(
+    const std::vector<EpisodeRecord>& episodes, PodcastSource* ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    if (episodes.empty()) {
+        qCWarning(CLASS_LC) << "Cache of PodcastSource contains no episodes";
+        /* a 304 response would leave us without any episodes */
+        ps->set_http_validators(QString(), QString());
         return;
     }
     /*
      * in either case read individual podcast episiode settings to at least set
      * episode positions
      */
-    for (const auto& ep : episodes_json_array) {
-        auto ep_ptr = PodcastEpisode::from_json_object(ep.toObject());
-        auto existing_ep = ps->get_episode_by_id(ep_ptr->get_guid());
-        if (existing_ep) {
+    std::vector<EpisodeRecord> new_episodes;
+    new_episodes.reserve(episodes.size());
+    for (const auto& cached : episodes) {
+        auto guid = cached.guid.isEmpty() ? cached.url.toString() : cached.guid;
+        if (ps->get_episode_store().contains(guid)) {
             // found -> update position
-            existing_ep->set_position(ep_ptr->get_position());
-        } else {
-            // not found -> add
-            ps->add_episode(ep_ptr);
+            ps->get_episode_by_id(guid)->set_position(cached.position);
+            continue;
         }
+        // not found -> add without creating a PodcastEpisode
+        new_episodes.push_back(cached);
     }
+    /* one merge and one notification for the whole cache */
+    ps->add_episode_records(std::move(new_episodes));
 }
 
 /*****************************************************************************/
@@ -227,6 +408,13 @@ void DigitalRooster::parse_podcast_source_from_json(
         /* First set cached image to avoid extra download */
         ps->set_image_file_path(img_cached);
         ps->set_image_url(img_url);
+        /* validators belong to the episodes in the same cache file */
+        ps->set_http_validators(tl_obj[KEY_HTTP_ETAG].toString(),
+            tl_obj[KEY_HTTP_LAST_MODIFIED].toString());
+        /* learned refresh interval survives a restart */
+        ps->set_learned_update_interval(
+            std::chrono::seconds(tl_obj[KEY_LEARNED_UPDATE_INTERVAL].toInt(0)),
+            tl_obj[KEY_UNCHANGED_REFRESHES].toInt(0));
     }
 }
 
@@ -238,6 +426,11 @@ QJsonObject DigitalRooster::json_from_podcast_source(const PodcastSource* ps) {
     ps_obj[KEY_DESCRIPTION] = ps->get_description();
     ps_obj[KEY_ICON_URL] = ps->get_image_url().toString();
     ps_obj[KEY_IMAGE_CACHE] = ps->get_image_file_path();
+    ps_obj[KEY_HTTP_ETAG] = ps->get_http_etag();
+    ps_obj[KEY_HTTP_LAST_MODIFIED] = ps->get_http_last_modified();
+    ps_obj[KEY_LEARNED_UPDATE_INTERVAL] =
+        static_cast<qint64>(ps->get_learned_update_interval().count());
+    ps_obj[KEY_UNCHANGED_REFRESHES] = ps->get_unchanged_refreshes();
     return ps_obj;
 }
 
@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "position_journal.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.PositionJournal");
+
+/*
+ * File layout, all integers little endian:
+ *  header:  "DRPJ", version (quint32)
+ *  records: key, position in ms, serial (3 x qint64), flags (quint32),
+ *           reserved (quint32)
+ * Records are updated in place, a key appears only once unless a write
+ * was interrupted, then the record with the higher index wins.
+ */
+static const char JOURNAL_MAGIC[] = {'D', 'R', 'P', 'J'};
+static const qint64 HEADER_SIZE = sizeof(JOURNAL_MAGIC) + sizeof(quint32);
+static const qint64 RECORD_SIZE = 3 * sizeof(qint64) + 2 * sizeof(quint32);
+static const quint32 FLAG_LISTENED = 0x1;
+
+/*****************************************************************************/
+static QByteArray encode_record(quint64 key, qint64 position, qint64 serial,
+    bool listened) {
+    QByteArray out(RECORD_SIZE, '\0');
+    auto* data = out.data();
+    qToLittleEndian(key, data);
+    qToLittleEndian(position, data + 8);
+    qToLittleEndian(serial, data + 16);
+    qToLittleEndian(listened ? FLAG_LISTENED : quint32(0), data + 24);
+    return out;
+}
+
+/*****************************************************************************/
+PositionJournal::PositionJournal(const QString& file_path,
+    std::chrono::milliseconds interval, QObject* parent)
+    : QObject(parent)
+    , file_path(file_path) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << file_path;
+    flush_timer.setSingleShot(true);
+    flush_timer.setInterval(interval);
+    connect(&flush_timer, &QTimer::timeout, this, &PositionJournal::flush);
+    load();
+}
+
+/*****************************************************************************/
+PositionJournal::~PositionJournal() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    flush();
+}
+
+/*****************************************************************************/
+quint64 PositionJournal::key(const QString& guid) {
+    auto hash =
+        QCryptographicHash::hash(guid.toUtf8(), QCryptographicHash::Md5);
+    return qFromLittleEndian<quint64>(hash.constData());
+}
+
+/*****************************************************************************/
+void PositionJournal::record(
+    const QString& guid, qint64 position, bool listened) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << position;
+    auto& rec = entries[key(guid)];
+    /* an episode stays listened when it is played again from the start */
+    listened = listened || rec.value.listened;
+    if (rec.value.position == position && rec.value.listened == listened) {
+        return;
+    }
+    rec.value.position = position;
+    rec.value.listened = listened;
+    rec.serial = ++last_serial;
+    if (!rec.changed) {
+        rec.changed = true;
+        dirty++;
+    }
+    if (!flush_timer.isActive()) {
+        flush_timer.start();
+    }
+}
+
+/*****************************************************************************/
+PositionJournal::Entry PositionJournal::entry(const QString& guid) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return entries.value(key(guid)).value;
+}
+
+/*****************************************************************************/
+void PositionJournal::flush() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << dirty;
+    flush_timer.stop();
+    if (dirty == 0) {
+        return;
+    }
+    /* new or invalid file and compaction rewrite all records */
+    if (file_records == 0 || entries.size() > POSITION_JOURNAL_MAX_ENTRIES) {
+        compact();
+        return;
+    }
+    QFile file(file_path);
+    /* unbuffered, a failed write is reported by write() */
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+        qCCritical(CLASS_LC) << "cannot write journal" << file.errorString();
+        flush_timer.start();
+        return;
+    }
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        auto& rec = it.value();
+        if (!rec.changed) {
+            continue;
+        }
+        /* new records are appended */
+        auto index = rec.index < 0 ? file_records : rec.index;
+        if (!file.seek(HEADER_SIZE + index * RECORD_SIZE) ||
+            file.write(encode_record(it.key(), rec.value.position,
+                rec.serial, rec.value.listened)) != RECORD_SIZE) {
+            /* records stay dirty, the next flush tries again */
+            qCCritical(CLASS_LC)
+                << "cannot write journal" << file.errorString();
+            break;
+        }
+        if (rec.index < 0) {
+            rec.index = file_records++;
+        }
+        rec.changed = false;
+        dirty--;
+    }
+    /* positions should survive a power cut right after standby */
+    ::fdatasync(file.handle());
+    if (dirty > 0) {
+        flush_timer.start();
+    }
+}
+
+/*****************************************************************************/
+void PositionJournal::load() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    QFile file(file_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCInfo(CLASS_LC) << "no position journal" << file_path;
+        return;
+    }
+    auto content = file.readAll();
+    const auto* data = content.constData();
+    if (content.size() < HEADER_SIZE ||
+        std::memcmp(data, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+        qFromLittleEndian<quint32>(data + sizeof(JOURNAL_MAGIC)) !=
+            POSITION_JOURNAL_VERSION) {
+        qCWarning(CLASS_LC) << "discarding invalid position journal";
+        return;
+    }
+    /* a partial record at the end is overwritten by the next append */
+    file_records =
+        static_cast<int>((content.size() - HEADER_SIZE) / RECORD_SIZE);
+    for (int i = 0; i < file_records; i++) {
+        const auto* rec_data = data + HEADER_SIZE + i * RECORD_SIZE;
+        Record rec;
+        rec.value.position = qFromLittleEndian<qint64>(rec_data + 8);
+        rec.serial = qFromLittleEndian<qint64>(rec_data + 16);
+        rec.value.listened =
+            qFromLittleEndian<quint32>(rec_data + 24) & FLAG_LISTENED;
+        rec.index = i;
+        entries.insert(qFromLittleEndian<quint64>(rec_data), rec);
+        last_serial = std::max(last_serial, rec.serial);
+    }
+    qCDebug(CLASS_LC) << "read" << entries.size() << "positions";
+}
+
+/*****************************************************************************/
+void PositionJournal::compact() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << entries.size();
+    if (entries.size() > POSITION_JOURNAL_MAX_ENTRIES) {
+        std::vector<std::pair<qint64, quint64>> by_serial;
+        by_serial.reserve(entries.size());
+        for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+            by_serial.emplace_back(it.value().serial, it.key());
+        }
+        auto drop = by_serial.size() - POSITION_JOURNAL_MAX_ENTRIES;
+        std::nth_element(
+            by_serial.begin(), by_serial.begin() + drop, by_serial.end());
+        for (size_t i = 0; i < drop; i++) {
+            entries.remove(by_serial[i].second);
+        }
+    }
+
+    QByteArray content(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    char version[sizeof(quint32)];
+    qToLittleEndian(POSITION_JOURNAL_VERSION, version);
+    content.append(version, sizeof(version));
+    content.reserve(HEADER_SIZE + entries.size() * RECORD_SIZE);
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+        const auto& rec = it.value();
+        content.append(encode_record(
+            it.key(), rec.value.position, rec.serial, rec.value.listened));
+    }
+
+    /* the next flush rewrites the file again */
+    file_records = 0;
+    QSaveFile file(file_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        file.write(content) != content.size() || !file.commit()) {
+        qCCritical(CLASS_LC) << "cannot write journal" << file.errorString();
+        /* dropped records no longer count, the others stay dirty */
+        dirty = static_cast<int>(std::count_if(entries.cbegin(),
+            entries.cend(), [](const Record& rec) { return rec.changed; }));
+        flush_timer.start();
+        return;
+    }
+    int index = 0;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        it->index = index++;
+        it->changed = false;
+    }
+    file_records = index;
+    dirty = 0;
+}
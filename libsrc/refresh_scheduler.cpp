@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QLoggingCategory>
+#include <QRandomGenerator>
+#include <QSet>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "PodcastSource.hpp"
+#include "configuration.hpp"
+#include "refresh_scheduler.hpp"
+
+using namespace DigitalRooster;
+using namespace std::chrono;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.RefreshScheduler");
+
+/*****************************************************************************/
+static seconds backoff_delay(int failures) {
+    if (failures <= 0) {
+        return seconds(0);
+    }
+    /* limit the shift, the result is capped anyway */
+    auto delay = FEED_REFRESH_BACKOFF_MIN * (1LL << std::min(failures - 1, 16));
+    return std::min<seconds>(delay, FEED_REFRESH_BACKOFF_MAX);
+}
+
+/*****************************************************************************/
+static QString host_key(const QUrl& url) {
+    /* local feeds have no host, they must not share one slot and backoff */
+    if (url.isLocalFile() || url.host().isEmpty()) {
+        return url.toString();
+    }
+    return url.host();
+}
+
+/*****************************************************************************/
+RefreshScheduler::RefreshScheduler(Configuration& cfg, int max_concurrent,
+    std::chrono::milliseconds jitter, QObject* parent)
+    : QObject(parent)
+    , config(cfg)
+    , max_concurrent(std::max(max_concurrent, 1))
+    , jitter(jitter) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &RefreshScheduler::dispatch);
+    connect(&config, &Configuration::podcast_sources_changed, this,
+        &RefreshScheduler::sync_sources);
+    sync_sources();
+}
+
+/*****************************************************************************/
+int RefreshScheduler::get_queue_depth() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto now = QDateTime::currentDateTime();
+    return static_cast<int>(
+        std::count_if(entries.begin(), entries.end(), [&](const Entry& e) {
+            return !e.deadline.isValid() && e.next_refresh <= now;
+        }));
+}
+
+/*****************************************************************************/
+int RefreshScheduler::get_running() const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return static_cast<int>(std::count_if(entries.begin(), entries.end(),
+        [](const Entry& e) { return e.deadline.isValid(); }));
+}
+
+/*****************************************************************************/
+QDateTime RefreshScheduler::get_next_refresh(const QUuid& id) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto entry = entries.constFind(id);
+    if (entry == entries.constEnd() || entry->deadline.isValid()) {
+        return QDateTime();
+    }
+    return entry->next_refresh;
+}
+
+/*****************************************************************************/
+std::chrono::seconds RefreshScheduler::get_backoff(const QString& host) const {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    return backoff_delay(hosts.value(host).failures);
+}
+
+/*****************************************************************************/
+void RefreshScheduler::sync_sources() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto now = QDateTime::currentDateTime();
+    QSet<QUuid> current;
+    for (const auto& ps : config.get_podcast_sources()) {
+        auto id = ps->get_id();
+        current.insert(id);
+        auto existing = entries.find(id);
+        /* same id with a new url is a new PodcastSource object */
+        if (existing != entries.end() && existing->source.lock() == ps) {
+            continue;
+        }
+        if (existing != entries.end()) {
+            disconnect(existing->finished_cnx);
+        }
+        Entry entry;
+        entry.source = ps;
+        entry.host = host_key(ps->get_url());
+        entry.next_refresh = now.addMSecs(random_jitter_ms());
+        entry.finished_cnx = connect(ps.get(), &PodcastSource::update_finished,
+            this, [this, id](bool success) { refresh_finished(id, success); });
+        entries.insert(id, entry);
+    }
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (current.contains(it.key())) {
+            ++it;
+        } else {
+            disconnect(it->finished_cnx);
+            it = entries.erase(it);
+        }
+    }
+    dispatch();
+}
+
+/*****************************************************************************/
+void RefreshScheduler::refresh_finished(const QUuid& id, bool success) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << id << success;
+    auto entry = entries.find(id);
+    if (entry == entries.end()) {
+        return;
+    }
+    reschedule(*entry, success, QDateTime::currentDateTime());
+    dispatch();
+}
+
+/*****************************************************************************/
+void RefreshScheduler::reschedule(
+    Entry& entry, bool success, const QDateTime& now) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    entry.deadline = QDateTime();
+    if (success) {
+        hosts.remove(entry.host);
+        auto ps = entry.source.lock();
+        auto interval = ps ? ps->get_effective_update_interval()
+                           : DEFAULT_UPDATE_INTERVAL;
+        entry.next_refresh =
+            now.addSecs(interval.count()).addMSecs(random_jitter_ms());
+    } else {
+        auto& host = hosts[entry.host];
+        host.failures++;
+        host.blocked_until = now.addSecs(backoff_delay(host.failures).count());
+        qCWarning(CLASS_LC) << "refresh failed" << entry.host << "retry after"
+                            << host.blocked_until;
+        entry.next_refresh = host.blocked_until.addMSecs(random_jitter_ms());
+    }
+}
+
+/*****************************************************************************/
+void RefreshScheduler::dispatch() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto now = QDateTime::currentDateTime();
+    /* a refresh without result must not block a slot forever */
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->deadline.isValid() && it->deadline <= now) {
+            qCWarning(CLASS_LC) << "refresh timed out" << it.key();
+            /* no late update_finished() for the aborted refresh */
+            auto ps = it->source.lock();
+            if (ps) {
+                ps->abort_refresh();
+            }
+            reschedule(*it, false, now);
+        }
+    }
+
+    /* longest waiting first */
+    std::vector<QUuid> due;
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->deadline.isValid() || it->next_refresh > now) {
+            continue;
+        }
+        auto blocked_until = hosts.value(it->host).blocked_until;
+        if (blocked_until.isValid() && blocked_until > now) {
+            it->next_refresh = blocked_until.addMSecs(random_jitter_ms());
+            continue;
+        }
+        due.push_back(it.key());
+    }
+    std::sort(due.begin(), due.end(), [this](const QUuid& a, const QUuid& b) {
+        return entries[a].next_refresh < entries[b].next_refresh;
+    });
+
+    auto running = get_running();
+    for (const auto& id : due) {
+        if (running >= max_concurrent) {
+            break;
+        }
+        auto& entry = entries[id];
+        auto ps = entry.source.lock();
+        /* cache not yet restored, podcast_sources_changed() follows */
+        if (!ps || !ps->has_update_task()) {
+            continue;
+        }
+        qCDebug(CLASS_LC) << "refreshing" << ps->get_url();
+        entry.deadline = now.addSecs(FEED_REFRESH_TIMEOUT.count());
+        running++;
+        ps->refresh();
+    }
+
+    /* wake up for the next due refresh or timeout */
+    QDateTime next_event;
+    for (const auto& entry : entries) {
+        auto t = entry.deadline.isValid() ? entry.deadline : entry.next_refresh;
+        /* due entries waiting for a slot are started by refresh_finished */
+        if (!entry.deadline.isValid() && t <= now) {
+            continue;
+        }
+        if (!next_event.isValid() || t < next_event) {
+            next_event = t;
+        }
+    }
+    if (next_event.isValid()) {
+        auto wait = std::clamp<qint64>(now.msecsTo(next_event), 0,
+            std::numeric_limits<int>::max());
+        timer.start(static_cast<int>(wait));
+    } else {
+        timer.stop();
+    }
+    emit queue_changed();
+}
+
+/*****************************************************************************/
+qint64 RefreshScheduler::random_jitter_ms() const {
+    if (jitter.count() <= 0) {
+        return 0;
+    }
+    return QRandomGenerator::global()->bounded(
+        static_cast<int>(jitter.count()) + 1);
+}
+
+/*****************************************************************************/
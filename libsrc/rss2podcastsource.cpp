@@ -11,12 +11,15 @@
 #include <QTime>
 #include <QXmlStreamReader>
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <stdexcept> // std::system_error
 #include <vector>
 
 #include "appconstants.hpp"
 #include "rss2podcastsource.hpp"
+#include "util.hpp"
 
 using namespace DigitalRooster;
 static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.RSSParser");
@@ -42,148 +45,270 @@ static QTime tryParse(const QString& timestring) {
 }
 
 /*****************************************************************************/
-void parse_episodes(PodcastSource& podcastsource, QXmlStreamReader& xml) {
+static const QString ITUNES_NS("http://www.itunes.com/dtds/podcast-1.0.dtd");
+
+/*****************************************************************************/
+RssStreamParser::RssStreamParser(const PodcastSource& podcastsource)
+    : max_episodes(podcastsource.get_max_episodes()) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    if (xml.tokenType() != QXmlStreamReader::StartElement ||
-        xml.name() != "item") {
-        qCCritical(CLASS_LC) << "parse_episodes called but wrong XML element!";
-        qCCritical(CLASS_LC) << xml.name() << " Tokentype " << xml.tokenType();
+    xml.setNamespaceProcessing(true);
+    const auto& store = podcastsource.get_episode_store();
+    for (int row = 0; row < store.size(); row++) {
+        known_guids.insert(store.guid(row));
+        kept_dates.push_back(store.publication_date(row));
+    }
+}
+
+/*****************************************************************************/
+void RssStreamParser::add_data(const QByteArray& chunk) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << chunk.size();
+    if (failed || done) {
         return;
     }
+    xml.addData(chunk);
+    parse();
+}
+
+/*****************************************************************************/
+bool RssStreamParser::finish() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    /* PrematureEndOfDocumentError at this point means truncated document */
+    if (failed || (!done && xml.hasError())) {
+        qCWarning(CLASS_LC) << " XML error in line:" << xml.lineNumber()
+                            << xml.errorString();
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+/*****************************************************************************/
+FeedUpdate RssStreamParser::take_update() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    FeedUpdate result = std::move(update);
+    update = FeedUpdate();
+    return result;
+}
 
-    auto ep = std::make_shared<PodcastEpisode>();
-
-    while (!(xml.readNext() == QXmlStreamReader::EndElement &&
-        xml.name() == "item")) {
-
-        if (xml.tokenType() == QXmlStreamReader::StartElement) {
-            if (xml.namespaceUri() == "") {
-                if (xml.name() == "title") {
-                    xml.readNext();
-                    ep->set_title(xml.text().toString());
-                } else if (xml.name() == "description") {
-                    xml.readNext();
-                    ep->set_description(xml.text().toString());
-                } else if (xml.name() == "enclosure") {
-                    // no readnext if we look at attributes
-                    ep->set_url(QUrl(xml.attributes().value("url").toString()));
-                } else if (xml.name() == "pubDate") {
-                    xml.readNext();
-                    ep->set_publication_date(QDateTime::fromString(
-                        xml.text().toString(), Qt::DateFormat::RFC2822Date));
-                } else if (xml.name() == "guid") {
-                    xml.readNext();
-                    ep->set_guid(xml.text().toString());
-                }
-            } else if (xml.namespaceUri() ==
-                "http://www.itunes.com/dtds/podcast-1.0.dtd") {
-                if (xml.name() == "duration") {
-                    xml.readNext();
-                    auto time = tryParse(xml.text().toString());
-                    ep->set_duration(QTime(0, 0).secsTo(time) * 1000);
-                }
-                if (xml.name() == "author") {
-                    xml.readNext();
-                    ep->set_publisher(xml.text().toString());
-                }
+/*****************************************************************************/
+void RssStreamParser::parse() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    while (!done && !xml.atEnd()) {
+        switch (xml.readNext()) {
+        case QXmlStreamReader::StartElement:
+            start_element();
+            break;
+        case QXmlStreamReader::EndElement:
+            end_element();
+            break;
+        case QXmlStreamReader::Characters:
+            if (collect_text) {
+                text.append(xml.text());
             }
+            break;
+        default:
+            break;
         }
+    }
+    /* reader stops at end of data - wait for next chunk */
+    if (xml.hasError() &&
+        xml.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
+        qCWarning(CLASS_LC) << " XML error in line:" << xml.lineNumber()
+                            << xml.errorString();
+        failed = true;
+    }
+}
 
-        if (xml.hasError()) {
-            throw std::invalid_argument(xml.errorString().toStdString());
+/*****************************************************************************/
+void RssStreamParser::start_element() {
+    depth++;
+    text.clear();
+    /* publication date of skipped items is needed to detect sort order */
+    collect_text = !skip_item || xml.name() == "pubDate";
+    /* only interpret standard RSS elements and some itunes extensions */
+    if (channel_depth < 0) {
+        if (xml.name() == "channel") {
+            channel_depth = depth;
+        }
+        return;
+    }
+    if (item_depth < 0 && depth == channel_depth + 1) {
+        if (xml.namespaceUri().isEmpty() && xml.name() == "item") {
+            item_depth = depth;
+            item = FeedItem();
+            skip_item = false;
+        } else if (xml.namespaceUri() == ITUNES_NS && xml.name() == "image") {
+            update.image_url =
+                QUrl(xml.attributes().value("href").toString());
+        }
+    } else if (item_depth > 0 && depth == item_depth + 1 && !skip_item) {
+        if (xml.namespaceUri().isEmpty() && xml.name() == "enclosure") {
+            item.url = QUrl(xml.attributes().value("url").toString());
+        }
+    }
+}
+
+/*****************************************************************************/
+void RssStreamParser::end_element() {
+    if (item_depth > 0 && depth == item_depth) {
+        finish_episode();
+        skip_item = false;
+    } else if (item_depth > 0 && depth == item_depth + 1) {
+        if (xml.namespaceUri().isEmpty() && xml.name() == "pubDate") {
+            item.publication_date =
+                QDateTime::fromString(text, Qt::DateFormat::RFC2822Date);
+            check_retention();
+        } else if (skip_item) {
+            /* known or old item - nothing to collect */
+        } else if (xml.namespaceUri().isEmpty()) {
+            if (xml.name() == "title") {
+                item.title = text;
+            } else if (xml.name() == "description") {
+                item.description = strings.intern(text);
+            } else if (xml.name() == "guid") {
+                item.guid = text;
+                check_known(item.guid);
+            }
+        } else if (xml.namespaceUri() == ITUNES_NS) {
+            if (xml.name() == "duration") {
+                auto time = tryParse(text);
+                item.duration = QTime(0, 0).secsTo(time) * 1000;
+            } else if (xml.name() == "author") {
+                item.publisher = strings.intern(text);
+            }
+        }
+    } else if (channel_depth > 0 && depth == channel_depth + 1) {
+        if (xml.namespaceUri().isEmpty()) {
+            if (xml.name() == "title") {
+                qCDebug(CLASS_LC) << "title: " << text;
+                update.title = text;
+            } else if (xml.name() == "description") {
+                qCDebug(CLASS_LC) << "description: " << text;
+                update.description = text;
+            } else if (xml.name() == "link") {
+                update.link = QUrl(text);
+            }
+        }
+    } else if (depth == channel_depth) {
+        channel_depth = -1;
+    }
+    text.clear();
+    depth--;
+}
+
+/*****************************************************************************/
+void RssStreamParser::check_known(const QString& guid) {
+    if (!guid.isEmpty() && known_guids.contains(guid)) {
+        skip_item = true;
+    }
+}
+
+/*****************************************************************************/
+void RssStreamParser::check_retention() {
+    const auto& date = item.publication_date;
+    if (!date.isValid()) {
+        return;
+    }
+    if (previous_date.isValid() && date > previous_date) {
+        date_sorted = false;
+    }
+    previous_date = date;
+
+    if (kept_dates.empty() || kept_dates.size() < max_episodes ||
+        !(date < kept_dates.back())) {
+        return;
+    }
+    /* add_episode_records() would drop it anyway */
+    skip_item = true;
+    if (date_sorted) {
+        qCDebug(CLASS_LC) << "remaining items older than retention window";
+        done = true;
+    }
+}
+
+/*****************************************************************************/
+void RssStreamParser::finish_episode() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    item_depth = -1;
+    if (skip_item) {
+        skipped_items++;
+        return;
+    }
+    /* no guid - PodcastEpisode uses the media URL as guid */
+    if (item.guid.isEmpty()) {
+        check_known(item.url.toString());
+        if (skip_item) {
+            skipped_items++;
+            return;
         }
     }
     /* We want at least a display name(title with or without publisher) and a
      * media_url */
-    if (ep->get_display_name().isEmpty()) {
+    if (item.title.isEmpty() && item.publisher.isEmpty()) {
         qWarning(CLASS_LC) << "Found channel with empty title: "
                            << xml.lineNumber();
         return;
     }
-    if (ep->get_url().isEmpty()) {
+    if (item.url.isEmpty()) {
         qWarning(CLASS_LC) << "Found channel without media URL :"
                            << xml.lineNumber();
         return;
     }
-    podcastsource.add_episode(ep);
+    /* same retention as EpisodeStore::merge() */
+    auto pos = std::lower_bound(kept_dates.begin(), kept_dates.end(),
+        item.publication_date, std::greater<QDateTime>());
+    kept_dates.insert(pos, item.publication_date);
+    if (kept_dates.size() > max_episodes) {
+        kept_dates.pop_back();
+    }
+    known_guids.insert(item.guid.isEmpty() ? item.url.toString() : item.guid);
+    item.summary = strings.intern(description_summary(item.description));
+    update.items.push_back(std::move(item));
 }
 
 /*****************************************************************************/
-void parse_channel(PodcastSource& podcastsource, QXmlStreamReader& xml) {
-    qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    if (!xml.isStartElement() || xml.name() != "channel") {
-        qWarning(CLASS_LC) << "parse_channel called but wrong XML element!";
-        return;
+void DigitalRooster::apply_feed_update(
+    PodcastSource& podcastsource, FeedUpdate&& update) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << update.items.size();
+    if (update.title) {
+        podcastsource.set_title(*update.title);
     }
-
-    while (!(xml.readNext() == QXmlStreamReader::EndElement &&
-        xml.name() == "channel")) {
-
-        /* only interpret standard RSS elements, not from itunes or atom
-         * namespace */
-        if (xml.tokenType() == QXmlStreamReader::StartElement) {
-            if (xml.namespaceUri() == "") {
-                qCDebug(CLASS_LC)
-                    << "StartElement (" << xml.tokenType() << ")" << xml.name();
-                if (xml.name() == "item") {
-                    parse_episodes(podcastsource, xml);
-                } else if (xml.name() == "title") {
-                    xml.readNext();
-                    qCDebug(CLASS_LC)
-                        << "title: " << xml.name() << " : " << xml.text();
-                    podcastsource.set_title(xml.text().toString());
-                } else if (xml.name() == "description") {
-                    xml.readNext();
-                    qCDebug(CLASS_LC)
-                        << "description: " << xml.name() << " : " << xml.text();
-                    podcastsource.set_description(xml.text().toString());
-                } else if (xml.name() == "link") {
-                    xml.readNext();
-                    podcastsource.set_link(xml.text().toString());
-                }
-            } else if (xml.namespaceUri() ==
-                "http://www.itunes.com/dtds/podcast-1.0.dtd") {
-                if (xml.name() == "image") {
-                    podcastsource.set_image_url(
-                        QUrl(xml.attributes().value("href").toString()));
-                }
-            }
-        }
-        if (xml.hasError()) {
-            throw std::invalid_argument(xml.errorString().toStdString());
-        }
+    if (update.description) {
+        podcastsource.set_description(*update.description);
+    }
+    if (update.link) {
+        podcastsource.set_link(*update.link);
+    }
+    if (update.image_url) {
+        podcastsource.set_image_url(*update.image_url);
+    }
+    std::vector<EpisodeRecord> episodes;
+    episodes.reserve(update.items.size());
+    for (auto& item : update.items) {
+        EpisodeRecord ep;
+        ep.title = std::move(item.title);
+        ep.description = std::move(item.description);
+        ep.url = std::move(item.url);
+        ep.publication_date = item.publication_date;
+        ep.guid = std::move(item.guid);
+        ep.duration = std::max<qint64>(item.duration, 0);
+        ep.publisher = std::move(item.publisher);
+        ep.summary = std::move(item.summary);
+        episodes.push_back(std::move(ep));
     }
+    podcastsource.add_episode_records(std::move(episodes));
 }
 
 /*****************************************************************************/
-void DigitalRooster::update_podcast(
+bool DigitalRooster::update_podcast(
     PodcastSource& podcastsource, const QByteArray& data) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-
-    QXmlStreamReader xml(data);
-    xml.setNamespaceProcessing(true);
-
-    // loop the entire file, a rss is really flat
-    try {
-        while (!xml.atEnd() && !xml.hasError()) {
-            QXmlStreamReader::TokenType token = xml.readNext();
-
-            if (token == QXmlStreamReader::StartDocument) {
-                continue;
-            }
-            if (token == QXmlStreamReader::StartElement) {
-                if (xml.name() == "rss") {
-                    continue;
-                } else if (xml.name() == "channel") {
-                    parse_channel(podcastsource, xml);
-                }
-            }
-        }
+    RssStreamParser parser(podcastsource);
+    parser.add_data(data);
+    auto complete = parser.finish();
+    apply_feed_update(podcastsource, parser.take_update());
+    if (complete) {
         podcastsource.set_last_updated(QDateTime::currentDateTime());
-
-    } catch (std::invalid_argument& exc) {
-        qCWarning(CLASS_LC)
-            << " XML error in line:" << xml.lineNumber() << exc.what();
-        return;
     }
+    return complete;
 }
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QLoggingCategory>
+
+#include "string_pool.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.StringPool");
+
+/*****************************************************************************/
+QString StringPool::intern(const QString& str) {
+    if (str.isEmpty()) {
+        return QString();
+    }
+    auto known = strings.constFind(str);
+    if (known != strings.constEnd()) {
+        return *known;
+    }
+    strings.insert(str);
+    return str;
+}
+
+/*****************************************************************************/
+void StringPool::prune() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << strings.size();
+    auto it = strings.begin();
+    while (it != strings.end()) {
+        /* reference count 1: no episode uses the string anymore */
+        if (it->isDetached()) {
+            it = strings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/*****************************************************************************/
+int DigitalRooster::url_file_name_start(const QString& url) {
+    return url.lastIndexOf('/') + 1;
+}
@@ -8,9 +8,12 @@
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QLoggingCategory>
+#include <QRegularExpression>
 #include <QString>
+#include <QThreadPool>
 #include <QUrl>
 #include <QUuid>
+#include <mutex>
 #include <stdexcept>
 
 #include "appconstants.hpp"
@@ -102,5 +105,27 @@ QUuid valid_uuid_from_String(const QString& uuidstr) {
     return id;
 }
 
+/*****************************************************************************/
+QThreadPool& worker_pool() {
+    /* bounded independently of QThreadPool::globalInstance() */
+    static QThreadPool pool;
+    static std::once_flag configured;
+    std::call_once(configured,
+        []() { pool.setMaxThreadCount(WORKER_POOL_MAX_THREADS); });
+    return pool;
+}
+
+/*****************************************************************************/
+QString description_summary(const QString& html) {
+    /* compiled once, thread safe for matching */
+    static const QRegularExpression tags("<[^>]*>");
+    auto text = QString(html).remove(tags).simplified();
+    if (text.size() > DESCRIPTION_SUMMARY_LENGTH) {
+        text.truncate(DESCRIPTION_SUMMARY_LENGTH);
+        text.append("...");
+    }
+    return text;
+}
+
 /*****************************************************************************/
 } // namespace DigitalRooster
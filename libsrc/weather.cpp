@@ -25,6 +25,9 @@ Weather::Weather(const IWeatherConfigStore& store, QObject* parent)
     , config(store) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
 
+    // weather polls can wait while media is playing
+    weather_downloader.set_priority(RequestPriority::Background);
+    forecast_downloader.set_priority(RequestPriority::Background);
     // timer starts refresh, refresh calls downloader
     connect(&timer, &QTimer::timeout, this, &Weather::refresh);
     // downloader finished -> parse result
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QFile>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QtConcurrent>
+
+#include "PodcastSource.hpp"
+#include "appconstants.hpp"
+#include "iconcache.hpp"
+#include "podcast_serializer.hpp"
+#include "util.hpp"
+
+using namespace DigitalRooster;
+
+static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.IconCache");
+
+/*****************************************************************************/
+static QImage read_icon(const QString& file_path) {
+    if (file_path.isEmpty() || !QFile::exists(file_path)) {
+        return QImage();
+    }
+    /* recently used icons are not evicted */
+    touch_icon(file_path);
+    QImageReader reader(file_path);
+    auto size = reader.size();
+    /* some formats decode directly to the smaller size */
+    if (size.width() > DEFAULT_ICON_WIDTH) {
+        reader.setScaledSize(size.scaled(
+            DEFAULT_ICON_WIDTH, size.height(), Qt::KeepAspectRatio));
+    }
+    auto image = reader.read();
+    if (image.isNull()) {
+        qCWarning(CLASS_LC)
+            << "cannot read icon" << file_path << reader.errorString();
+    }
+    return image;
+}
+
+/*****************************************************************************/
+IconCache::IconCache(QObject* parent)
+    : QObject(parent) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+}
+
+/*****************************************************************************/
+QString IconCache::podcast_key(const PodcastSource& ps) {
+    return QString("podcast/") + ps.get_id_string();
+}
+
+/*****************************************************************************/
+void IconCache::add_podcast_source(const std::shared_ptr<PodcastSource>& ps) {
+    auto key = podcast_key(*ps);
+    if (sources.contains(key)) {
+        return;
+    }
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << key;
+    sources.insert(key);
+    std::weak_ptr<PodcastSource> source = ps;
+    connect(ps.get(), &PodcastSource::icon_changed, this, [this, source]() {
+        auto ps = source.lock();
+        if (ps) {
+            load(ps);
+        }
+    });
+    connect(ps.get(), &QObject::destroyed, this, [this, key]() {
+        sources.remove(key);
+        loads.remove(key);
+        remove(key);
+    });
+    load(ps);
+}
+
+/*****************************************************************************/
+void IconCache::load(const std::shared_ptr<PodcastSource>& ps) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    auto key = podcast_key(*ps);
+    auto file_path = ps->get_image_file_path();
+    auto load_id = ++loads[key];
+    auto watcher = new QFutureWatcher<QImage>(this);
+    std::weak_ptr<PodcastSource> source = ps;
+    connect(watcher, &QFutureWatcher<QImage>::finished, this,
+        [this, watcher, source, key, load_id]() {
+            watcher->deleteLater();
+            /* source was removed or its icon changed while reading */
+            if (!sources.contains(key) || loads.value(key) != load_id) {
+                return;
+            }
+            auto image = watcher->result();
+            if (!image.isNull()) {
+                set_icon(key, image);
+                return;
+            }
+            /* icon_changed will call load() again once the download is
+             * stored */
+            auto ps = source.lock();
+            if (ps) {
+                ps->download_icon();
+            }
+        });
+    /* file access and decoding off the GUI thread */
+    watcher->setFuture(QtConcurrent::run(
+        &worker_pool(), [file_path]() { return read_icon(file_path); }));
+}
+
+/*****************************************************************************/
+void IconCache::set_icon(const QString& key, const QImage& image) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << key;
+    auto scaled = image;
+    if (image.width() > DEFAULT_ICON_WIDTH) {
+        scaled = image.scaledToWidth(
+            DEFAULT_ICON_WIDTH, Qt::SmoothTransformation);
+    }
+    {
+        QMutexLocker lock(&mutex);
+        icons.insert(key, scaled);
+        revisions[key]++;
+    }
+    emit icon_updated(key);
+}
+
+/*****************************************************************************/
+void IconCache::remove(const QString& key) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << key;
+    QMutexLocker lock(&mutex);
+    icons.remove(key);
+    revisions.remove(key);
+}
+
+/*****************************************************************************/
+QImage IconCache::image(const QString& key) const {
+    QMutexLocker lock(&mutex);
+    return icons.value(key);
+}
+
+/*****************************************************************************/
+QUrl IconCache::url(const QString& key) const {
+    QUrl url;
+    url.setScheme("image");
+    url.setHost(ICON_PROVIDER_ID);
+    url.setPath(QString("/") + key);
+    QMutexLocker lock(&mutex);
+    url.setQuery(QString::number(revisions.value(key)));
+    return url;
+}
+
+/*****************************************************************************/
+IconImageProvider::IconImageProvider(const IconCache& cache)
+    : QQuickImageProvider(QQuickImageProvider::Image)
+    , cache(cache) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+}
+
+/*****************************************************************************/
+QImage IconImageProvider::requestImage(
+    const QString& id, QSize* size, const QSize& requested_size) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << id;
+    /* the query only forces QML to request a new icon */
+    auto image = cache.image(id.section('?', 0, 0));
+    if (image.isNull()) {
+        image = QImage(
+            DEFAULT_ICON_WIDTH, DEFAULT_ICON_WIDTH, QImage::Format_ARGB32);
+        image.fill(Qt::transparent);
+    } else if (!requested_size.isEmpty() && requested_size != image.size()) {
+        image = image.scaled(
+            requested_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    } else if (requested_size.width() > 0 &&
+        requested_size.width() != image.width()) {
+        image = image.scaledToWidth(
+            requested_size.width(), Qt::SmoothTransformation);
+    }
+    if (size) {
+        *size = image.size();
+    }
+    return image;
+}
@@ -0,0 +1,153 @@
+/*************************************************************************************
+ * \filename
+ * \brief	In-memory artwork for QML lists
+ *
+ * \details Icons are loaded when a source is first shown or its icon changed
+ *          and served to QML by an image provider (image://icons/...).
+ *          Model roles only build URLs and never access the filesystem.
+ *
+ * \author Thomas Ruschival
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ *
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *************************************************************************************/
+#ifndef QTGUI_ICONCACHE_HPP_
+#define QTGUI_ICONCACHE_HPP_
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QQuickImageProvider>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+#include <memory>
+
+namespace DigitalRooster {
+class PodcastSource;
+
+/**
+ * Pre-scaled icons of podcast sources and radio stations by key,
+ * e.g. "podcast/<id>" or "station/<id>"
+ */
+class IconCache : public QObject {
+    Q_OBJECT
+public:
+    /**
+     * Constructor
+     * @param parent
+     */
+    explicit IconCache(QObject* parent = nullptr);
+
+    /**
+     * Key of a podcast source
+     * @param ps podcast source
+     * @return "podcast/<id>"
+     */
+    static QString podcast_key(const PodcastSource& ps);
+
+    /**
+     * Load icon of a podcast source and follow its changes. Only the first
+     * call for a source loads the icon or triggers its download.
+     * @param ps podcast source
+     */
+    void add_podcast_source(const std::shared_ptr<PodcastSource>& ps);
+
+    /**
+     * Replace the icon of a key, e.g. for station logos
+     * @param key unique key
+     * @param image icon, scaled to DEFAULT_ICON_WIDTH if larger
+     */
+    void set_icon(const QString& key, const QImage& image);
+
+    /**
+     * Forget the icon of a key
+     * @param key unique key
+     */
+    void remove(const QString& key);
+
+    /**
+     * Icon of a key, thread safe for the image provider
+     * @param key unique key
+     * @return icon or null image
+     */
+    QImage image(const QString& key) const;
+
+    /**
+     * URL for QML, changes with every new icon of the key so QML does not
+     * show a cached old icon
+     * @param key unique key
+     * @return image://icons/<key>?<revision>
+     */
+    QUrl url(const QString& key) const;
+
+signals:
+    /**
+     * A new icon is available
+     * @param key unique key
+     */
+    void icon_updated(const QString& key);
+
+private:
+    /**
+     * Protects \ref icons, \ref revisions
+     */
+    mutable QMutex mutex;
+
+    /**
+     * Icons by key
+     */
+    QHash<QString, QImage> icons;
+
+    /**
+     * Number of icon changes by key, part of \ref url()
+     */
+    QHash<QString, int> revisions;
+
+    /**
+     * Keys of podcast sources already followed, only used on GUI thread
+     */
+    QSet<QString> sources;
+
+    /**
+     * Number of loads started by key, only the result of the latest load
+     * is used, only used on GUI thread
+     */
+    QHash<QString, int> loads;
+
+    /**
+     * Read and scale icon of podcast source from its local cache file on
+     * the worker pool, a missing file is downloaded
+     * @param ps podcast source
+     */
+    void load(const std::shared_ptr<PodcastSource>& ps);
+};
+
+/**
+ * Serves icons of an \ref IconCache to QML
+ */
+class IconImageProvider : public QQuickImageProvider {
+public:
+    /**
+     * Constructor
+     * @param cache icons, must outlive the QML engine
+     */
+    explicit IconImageProvider(const IconCache& cache);
+
+    /**
+     * Icon for image://icons/<key>?<revision>
+     * @param id <key>?<revision>
+     * @param size size of returned image
+     * @param requested_size size requested by QML element
+     * @return icon or transparent placeholder while downloading
+     */
+    QImage requestImage(const QString& id, QSize* size,
+        const QSize& requested_size) override;
+
+private:
+    const IconCache& cache;
+};
+
+} // namespace DigitalRooster
+#endif /* QTGUI_ICONCACHE_HPP_ */
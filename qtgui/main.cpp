@@ -35,14 +35,18 @@
 #include "alarmmonitor.hpp"
 #include "appconstants.hpp"
 #include "brightnesscontrol.hpp"
+#include "concurrent_store.hpp"
 #include "configuration.hpp"
+#include "iconcache.hpp"
 #include "iradiolistmodel.hpp"
 #include "logger.hpp"
 #include "mediaplayerproxy.hpp"
+#include "network_service.hpp"
 #include "networkinfo.hpp"
 #include "podcastepisodemodel.hpp"
 #include "podcastsourcemodel.hpp"
 #include "powercontrol.hpp"
+#include "refresh_scheduler.hpp"
 #include "sleeptimer.hpp"
 #include "timeprovider.hpp"
 #include "util.hpp"
@@ -97,6 +101,9 @@ int main(int argc, char* argv[]) {
     QCoreApplication::setApplicationName(APPLICATION_NAME);
     QCoreApplication::setApplicationVersion(PROJECT_VERSION);
     QGuiApplication app(argc, argv);
+    /* all downloads share one network access manager and its disk cache,
+     * destroyed after all clients and before the application */
+    NetworkService network;
 
     /*
      * Setup Commandline Parser
@@ -136,7 +143,11 @@ int main(int argc, char* argv[]) {
      */
     Configuration config(
         cmdline.value(CMD_ARG_CONFIG_FILE), cmdline.value(CMD_ARG_CACHE_DIR));
+    network.set_cache_directory(
+        QDir(config.get_cache_dir_name()).filePath(HTTP_CACHE_DIR_NAME));
     config.update_configuration();
+    /* refresh all podcast feeds from one queue */
+    RefreshScheduler refresh_scheduler(config);
 
     // Initialize Player
     MediaPlayerProxy playerproxy;
@@ -148,8 +159,26 @@ int main(int argc, char* argv[]) {
     AlarmMonitor alarmmonitor(playerproxy, std::chrono::seconds(20));
     QObject::connect(&alarmdispatcher, &AlarmDispatcher::alarm_triggered,
         &alarmmonitor, &AlarmMonitor::alarm_triggered);
-
-    PodcastSourceModel psmodel(config, playerproxy);
+    /* Alarm media is buffered before the alarm, radio stations stand in */
+    QObject::connect(&alarmdispatcher, &AlarmDispatcher::alarm_pending,
+        &alarmmonitor, &AlarmMonitor::alarm_pending);
+    alarmmonitor.set_alternative_sources(config.get_stations());
+    /* Pre-arming expires with the pre-warm time of the dispatcher */
+    alarmmonitor.set_prewarm_time(alarmdispatcher.get_prewarm_time());
+    QObject::connect(&alarmdispatcher, &AlarmDispatcher::prewarm_time_changed,
+        &alarmmonitor, &AlarmMonitor::set_prewarm_time);
+    QObject::connect(&config, &Configuration::stations_changed, &alarmmonitor,
+        [&]() { alarmmonitor.set_alternative_sources(config.get_stations()); });
+
+    IconCache icon_cache;
+    PodcastSourceModel psmodel(config, playerproxy, icon_cache);
+    /* queued, remove() emits it while removing its row */
+    QObject::connect(&config, &Configuration::podcast_sources_changed,
+        &psmodel, &PodcastSourceModel::sources_changed,
+        Qt::QueuedConnection);
+    /* podcast episodes play from downloaded files when available */
+    playerproxy.set_episode_downloader(config.get_episode_downloader());
+    psmodel.set_episode_downloader(config.get_episode_downloader());
     AlarmListModel alarmlistmodel(config);
     IRadioListModel iradiolistmodel(config, playerproxy);
     WifiListModel wifilistmodel;
@@ -171,6 +200,25 @@ int main(int argc, char* argv[]) {
     /* Powercontrol standby stops player */
     QObject::connect(&power, &PowerControl::going_in_standby, &playerproxy,
         &MediaPlayer::stop);
+    /* Pending cache files are written before standby and power off */
+    auto* cache_writer = config.get_cache_writer().get();
+    QObject::connect(&power, &PowerControl::going_in_standby, cache_writer,
+        &CacheWriter::flush);
+    QObject::connect(&power, &PowerControl::reboot_request, cache_writer,
+        &CacheWriter::flush);
+    QObject::connect(&power, &PowerControl::shutdown_request, cache_writer,
+        &CacheWriter::flush);
+    /* Playback positions are written before standby and power off */
+    auto* position_journal = config.get_position_journal().get();
+    QObject::connect(&power, &PowerControl::going_in_standby,
+        position_journal, &PositionJournal::flush);
+    QObject::connect(&power, &PowerControl::reboot_request, position_journal,
+        &PositionJournal::flush);
+    QObject::connect(&power, &PowerControl::shutdown_request,
+        position_journal, &PositionJournal::flush);
+    /* Download statistics are logged before standby */
+    QObject::connect(&power, &PowerControl::going_in_standby, &network,
+        &NetworkService::log_statistics);
     /* Powercontrol stop any running alarm monitor timers */
     QObject::connect(&power, &PowerControl::going_in_standby, &alarmmonitor,
         &AlarmMonitor::stop);
@@ -187,9 +235,24 @@ int main(int argc, char* argv[]) {
     /* Sleeptimer sends system to standby */
     QObject::connect(&sleeptimer, &SleepTimer::sleep_timer_elapsed, &power,
         &PowerControl::standby);
-    /* Sleeptimer resets when player changes state to play */
+    /* Sleeptimer resets when player changes state to play, not for alarm
+     * media buffered silently before the alarm */
+    QObject::connect(&playerproxy, &MediaPlayer::playback_state_changed,
+        &sleeptimer, [&](QMediaPlayer::State state) {
+            if (alarmmonitor.get_state() != AlarmMonitor::PreArmed) {
+                sleeptimer.playback_state_changed(state);
+            }
+        });
+    /* Playback positions are written when playback pauses or stops */
+    QObject::connect(&playerproxy, &MediaPlayer::playback_state_changed,
+        position_journal, [position_journal](QMediaPlayer::State state) {
+            if (state != QMediaPlayer::PlayingState) {
+                position_journal->flush();
+            }
+        });
+    /* Background downloads are throttled while a stream is playing */
     QObject::connect(&playerproxy, &MediaPlayer::playback_state_changed,
-        &sleeptimer, &SleepTimer::playback_state_changed);
+        &network, &NetworkService::playback_state_changed);
     /* Sleeptimer also monitors alarms */
     QObject::connect(&alarmdispatcher, &AlarmDispatcher::alarm_triggered,
         &sleeptimer, &SleepTimer::alarm_triggered);
@@ -221,7 +284,8 @@ int main(int argc, char* argv[]) {
         &WifiListModel::update_scan_results);
 
 #ifdef REST_API
-    RestApi rest(config, config, config, config, config);
+    ConcurrentStore concurrent_store(config);
+    RestApi rest(concurrent_store);
 #endif
     /*
      * QML Setup dynamically createable types
@@ -259,12 +323,15 @@ int main(int argc, char* argv[]) {
     ctxt->setContextProperty("volumeButton", &volbtn);
     ctxt->setContextProperty("sleeptimer", &sleeptimer);
     ctxt->setContextProperty("netinfo", &netinfo);
+    ctxt->setContextProperty("refreshScheduler", &refresh_scheduler);
     ctxt->setContextProperty("wifictrl", wifictrl);
     ctxt->setContextProperty("wifilistmodel", &wifilistmodel);
     ctxt->setContextProperty(
         "DEFAULT_ICON_WIDTH", QVariant::fromValue(DEFAULT_ICON_WIDTH));
     ctxt->setContextProperty("FONT_SCALING", QVariant::fromValue(dpi));
 
+    /* engine takes ownership of the provider */
+    view.addImageProvider(ICON_PROVIDER_ID, new IconImageProvider(icon_cache));
     view.load(QUrl("qrc:/main.qml"));
 
     /* Start in standby mode - defined in qtgui/CMakeLists.txt */
@@ -273,5 +340,9 @@ int main(int argc, char* argv[]) {
     power.standby();
 #endif
 
-    return app.exec();
+    auto ret = app.exec();
+    /* pool tasks write cache files, finish them while app is alive */
+    worker_pool().waitForDone();
+    network.log_statistics();
+    return ret;
 }
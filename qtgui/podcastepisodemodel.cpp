@@ -9,9 +9,10 @@
 #include <QHash>
 #include <QLoggingCategory>
 #include <QQmlEngine>
-#include <QRegExp>
 
 #include "PlayableItem.hpp"
+#include "PodcastSource.hpp"
+#include "episode_downloader.hpp"
 #include "mediaplayerproxy.hpp"
 #include "podcastepisodemodel.hpp"
 
@@ -20,12 +21,17 @@ using namespace DigitalRooster;
 static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.PodcastEpisodeModel");
 /*****************************************************************************/
 PodcastEpisodeModel::PodcastEpisodeModel(
-    const std::vector<std::shared_ptr<PodcastEpisode>>* ep, MediaPlayer& mp,
-    QObject* parent)
+    std::shared_ptr<PodcastSource> source, MediaPlayer& mp, QObject* parent)
     : QAbstractListModel(parent)
-    , episodes(ep)
+    , ps(std::move(source))
     , mpp(mp) {
 	qCInfo(CLASS_LC) << Q_FUNC_INFO;
+    /* emitted after every merge or purge, rows have shifted */
+    connect(ps.get(), &PodcastSource::episodes_count_changed, this, [this]() {
+        beginResetModel();
+        release_dropped_episodes();
+        endResetModel();
+    });
 }
 
 /*****************************************************************************/
@@ -33,6 +39,19 @@ PodcastEpisodeModel::~PodcastEpisodeModel(){
 	qCInfo(CLASS_LC) << Q_FUNC_INFO;
 }
 
+/*****************************************************************************/
+void PodcastEpisodeModel::release_dropped_episodes() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    const auto& store = ps->get_episode_store();
+    for (auto it = episodes_in_qml.begin(); it != episodes_in_qml.end();) {
+        if (store.contains(it.key())) {
+            ++it;
+        } else {
+            it = episodes_in_qml.erase(it);
+        }
+    }
+}
+
 /*****************************************************************************/
 QHash<int, QByteArray> PodcastEpisodeModel::roleNames() const {
     QHash<int, QByteArray> roles;
@@ -44,77 +63,105 @@ QHash<int, QByteArray> PodcastEpisodeModel::roleNames() const {
     roles[DescriptionRole] = "description";
     roles[DateRole] = "pub_date";
     roles[ListenedRole] = "listened";
+    roles[DownloadedRole] = "downloaded";
     return roles;
 }
 
-/*****************************************************************************/
-void PodcastEpisodeModel::set_episodes(
-    const std::vector<std::shared_ptr<PodcastEpisode>>* ep) {
-    episodes = ep;
-}
-
 /*****************************************************************************/
 int PodcastEpisodeModel::rowCount(const QModelIndex& /*parent */) const {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    if (!episodes) {
+    if (!ps) {
     	qCWarning(CLASS_LC) << " no episodes ";
         return 0;
     }
-    return episodes->size();
+    return ps->get_episode_count();
 }
 
 /*****************************************************************************/
 PodcastEpisode* PodcastEpisodeModel::get_episode(int index) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO << index;
-    auto ep = episodes->at(index).get();
-    QQmlEngine::setObjectOwnership(ep, QQmlEngine::CppOwnership);
-    return ep;
+    auto ep = ps->get_episode(index);
+    if (!ep) {
+        qCCritical(CLASS_LC) << Q_FUNC_INFO << "index out of range " << index;
+        return nullptr;
+    }
+    episodes_in_qml.insert(ep->get_guid(), ep);
+    QQmlEngine::setObjectOwnership(ep.get(), QQmlEngine::CppOwnership);
+    return ep.get();
 }
 
 /*****************************************************************************/
 void PodcastEpisodeModel::send_to_player(int index) {
 	qCDebug(CLASS_LC) << Q_FUNC_INFO << index;
-	auto ep = episodes->at(index);
+	auto ep = ps->get_episode(index);
+    if (!ep) {
+        qCCritical(CLASS_LC) << Q_FUNC_INFO << "index out of range " << index;
+        return;
+    }
     mpp.set_media(ep);
     mpp.play();
 }
 
+/*****************************************************************************/
+void PodcastEpisodeModel::download(int index) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << index;
+    auto ep = ps->get_episode(index);
+    if (!ep || !episode_downloader) {
+        qCCritical(CLASS_LC) << Q_FUNC_INFO << "cannot download " << index;
+        return;
+    }
+    episode_downloader->download(ep);
+}
+
+/*****************************************************************************/
+void PodcastEpisodeModel::set_episode_downloader(
+    std::shared_ptr<EpisodeDownloader> downloader) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    episode_downloader = downloader;
+    connect(episode_downloader.get(), &EpisodeDownloader::episode_downloaded,
+        this, [this]() {
+            emit dataChanged(createIndex(0, 0),
+                createIndex(rowCount() - 1, 0), {DownloadedRole});
+        });
+}
+
 /*****************************************************************************/
 QVariant PodcastEpisodeModel::data(const QModelIndex& index, int role) const {
     qCDebug(CLASS_LC) << Q_FUNC_INFO << index;
-    if (!episodes)
+    if (!ps)
         return QVariant();
 
-    /* static cast only if index.row() is >= 0 and thus can be converted */
-    if (index.row() < 0 ||
-        static_cast<size_t>(index.row()) >= episodes->size()) {
+    /* read values from the store, no PodcastEpisode needed for a row */
+    const auto& store = ps->get_episode_store();
+    auto row = index.row();
+    if (row < 0 || row >= store.size()) {
         qCCritical(CLASS_LC) << Q_FUNC_INFO << "index out of range " << index;
         return QVariant();
     }
 
-    QString desc;
-    auto ep = episodes->at(index.row());
-    auto duration = QTime::fromMSecsSinceStartOfDay(ep->get_duration());
+    auto duration = QTime::fromMSecsSinceStartOfDay(store.duration(row));
 
     switch (role) {
     case DisplayNameRole:
-        return QVariant(ep->get_display_name());
+        return QVariant(store.display_name(row));
     case TitleRole:
-        return QVariant(ep->get_title());
+        return QVariant(store.title(row));
     case PublisherRole:
-        return QVariant(ep->get_publisher());
+        return QVariant(store.publisher(row));
     case DurationRole:
         return QVariant(duration.toString("hh:mm:ss"));
     case CurrentPositionRole:
-        return QVariant(ep->get_position());
+        return QVariant(store.position(row));
     case DescriptionRole:
-        desc = ep->get_description();
-        desc.remove(QRegExp("<[^>]*>")); // Strip HTML tags
-        return QVariant(desc);
+        /* HTML stripped once when the episode was added */
+        return QVariant(store.summary(row));
     case ListenedRole:
-        return QVariant(ep->already_listened());
+        return QVariant(store.listened(row));
+    case DownloadedRole:
+        return QVariant(episode_downloader &&
+            episode_downloader->is_downloaded(store.guid(row)));
     case DateRole:
-        auto date = ep->get_publication_date();
+        auto date = store.publication_date(row);
         if (date.isValid()) {
             return QVariant(date.toString("dd.MMM.yyyy"));
         }
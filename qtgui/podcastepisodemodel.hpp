@@ -13,6 +13,7 @@
 #define QTGUI_PODCASTEPISODEMODEL_HPP_
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QObject>
 
 #include <memory>
@@ -21,7 +22,9 @@
 namespace DigitalRooster {
 
 class Configuration;
+class EpisodeDownloader;
 class PodcastEpisode;
+class PodcastSource;
 class MediaPlayer;
 
 /**
@@ -32,9 +35,15 @@ class PodcastEpisodeModel : public QAbstractListModel {
     Q_PROPERTY(int currentIndex READ get_current_index WRITE set_current_index
             NOTIFY current_index_changed)
 public:
-    PodcastEpisodeModel(
-        const std::vector<std::shared_ptr<PodcastEpisode>>* episodes,
-        MediaPlayer& mp, QObject* parent = nullptr);
+    /**
+     * Model reads the episode values of the source, PodcastEpisode objects
+     * are only created for episodes handed to QML or the player
+     * @param ps podcast source
+     * @param mp player for \ref send_to_player
+     * @param parent QObject parent
+     */
+    PodcastEpisodeModel(std::shared_ptr<PodcastSource> ps, MediaPlayer& mp,
+        QObject* parent = nullptr);
 
     enum PodcastEpisodeRoles {
         DisplayNameRole = Qt::UserRole + 1,
@@ -44,16 +53,14 @@ public:
         CurrentPositionRole,
         DescriptionRole,
         DateRole,
-        ListenedRole
+        ListenedRole,
+        DownloadedRole
     };
 
     int rowCount(const QModelIndex& parent = QModelIndex()) const;
 
     QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
 
-    void set_episodes(
-        const std::vector<std::shared_ptr<PodcastEpisode>>* episodes);
-
     const QString& getName() {
         return name;
     }
@@ -74,6 +81,19 @@ public:
     Q_INVOKABLE DigitalRooster::PodcastEpisode* get_episode(int index);
     Q_INVOKABLE void send_to_player(int index);
 
+    /**
+     * Keep episode for offline playback
+     * @param index row of episode
+     */
+    Q_INVOKABLE void download(int index);
+
+    /**
+     * Enables \ref download and DownloadedRole
+     * @param downloader offline episodes
+     */
+    void set_episode_downloader(
+        std::shared_ptr<EpisodeDownloader> downloader);
+
     virtual ~PodcastEpisodeModel();
 
 signals:
@@ -83,8 +103,20 @@ protected:
     QHash<int, QByteArray> roleNames() const;
 
 private:
-    const std::vector<std::shared_ptr<PodcastEpisode>>* episodes;
+    std::shared_ptr<PodcastSource> ps;
+    /**
+     * Episodes handed out as raw pointer to QML, kept alive as long as
+     * they are episodes of \ref ps
+     */
+    QHash<QString, std::shared_ptr<PodcastEpisode>> episodes_in_qml;
+
+    /**
+     * Release episodes in \ref episodes_in_qml that were dropped or
+     * purged from \ref ps
+     */
+    void release_dropped_episodes();
     MediaPlayer& mpp;
+    std::shared_ptr<EpisodeDownloader> episode_downloader;
     int currentIndex = -1;
     QString name;
 };
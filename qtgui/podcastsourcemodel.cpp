@@ -11,6 +11,7 @@
 
 
 #include "PodcastSource.hpp"
+#include "iconcache.hpp"
 #include "mediaplayerproxy.hpp"
 #include "podcastepisodemodel.hpp"
 #include "podcastsourcemodel.hpp"
@@ -20,16 +21,26 @@ using namespace DigitalRooster;
 static Q_LOGGING_CATEGORY(CLASS_LC, "DigitalRooster.PodcastSourceModel");
 
 /*****************************************************************************/
-PodcastSourceModel::PodcastSourceModel(
-    IPodcastStore& store, MediaPlayer& mp, QObject* parent)
+PodcastSourceModel::PodcastSourceModel(IPodcastStore& store, MediaPlayer& mp,
+    IconCache& icons, QObject* parent)
     : QAbstractListModel(parent)
     , config(store)
-    , mpp(mp) {
+    , mpp(mp)
+    , icons(icons) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
-    auto v = config.get_podcast_sources();
-    for (const auto& ps : v) {
+    register_sources();
+    connect(&icons, &IconCache::icon_updated, this,
+        &PodcastSourceModel::icon_updated);
+}
+
+/*****************************************************************************/
+void PodcastSourceModel::register_sources() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    for (const auto& ps : config.get_podcast_sources()) {
         connect(ps.get(), &PodcastSource::titleChanged, this,
-            &PodcastSourceModel::newDataAvailable);
+            &PodcastSourceModel::newDataAvailable, Qt::UniqueConnection);
+        /* only the first call for a source loads its icon */
+        icons.add_podcast_source(ps);
     }
 }
 
@@ -57,6 +68,34 @@ void PodcastSourceModel::newDataAvailable() {
     emit dataChanged(createIndex(0, 0), createIndex(rowCount() - 1, 0));
 }
 
+/*****************************************************************************/
+void PodcastSourceModel::sources_changed() {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    beginResetModel();
+    register_sources();
+    endResetModel();
+}
+
+/*****************************************************************************/
+void PodcastSourceModel::icon_updated(const QString& key) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO << key;
+    auto v = config.get_podcast_sources();
+    for (size_t row = 0; row < v.size(); row++) {
+        if (IconCache::podcast_key(*v[row]) == key) {
+            auto idx = createIndex(static_cast<int>(row), 0);
+            emit dataChanged(idx, idx, {ImageRole});
+            return;
+        }
+    }
+}
+
+/*****************************************************************************/
+void PodcastSourceModel::set_episode_downloader(
+    std::shared_ptr<EpisodeDownloader> downloader) {
+    qCDebug(CLASS_LC) << Q_FUNC_INFO;
+    episode_downloader = downloader;
+}
+
 /*****************************************************************************/
 PodcastEpisodeModel* PodcastSourceModel::get_episodes(int index) {
     qCDebug(CLASS_LC) << Q_FUNC_INFO;
@@ -71,7 +110,11 @@ PodcastEpisodeModel* PodcastSourceModel::get_episodes(int index) {
     /* Lifetime will be managed in QML!
      * TODO: check logs for dtor call*/
     qCInfo(CLASS_LC) << "Creating new PodcastEpisodeModel";
-    return new PodcastEpisodeModel(&(v[index]->get_episodes()), mpp, this);
+    auto model = new PodcastEpisodeModel(v[index], mpp, this);
+    if (episode_downloader) {
+        model->set_episode_downloader(episode_downloader);
+    }
+    return model;
 }
 
 /*****************************************************************************/
@@ -84,7 +127,6 @@ QVariant PodcastSourceModel::data(const QModelIndex& index, int role) const {
         qCCritical(CLASS_LC) << Q_FUNC_INFO << "index out of range " << index;
         return QVariant();
     }
-    QString desc;
     auto ps = v[index.row()];
 
     switch (role) {
@@ -93,13 +135,12 @@ QVariant PodcastSourceModel::data(const QModelIndex& index, int role) const {
     case DisplayUrlRole:
         return ps->get_url();
     case DisplayCountRole:
-        return QVariant(static_cast<int>(ps->get_episodes().size()));
+        return QVariant(ps->get_episode_count());
     case DescriptionRole:
-        desc = ps->get_description();
-        desc.remove(QRegExp("<[^>]*>")); // Strip HTML tags
-        return QVariant(desc);
+        return QVariant(ps->get_description_summary());
     case ImageRole:
-        return ps->get_icon();
+        /* loaded when the source was registered, served from memory */
+        return icons.url(IconCache::podcast_key(*ps));
     }
     return QVariant();
 }
@@ -19,6 +19,8 @@
 #include "IPodcastStore.hpp"
 
 namespace DigitalRooster {
+class EpisodeDownloader;
+class IconCache;
 class MediaPlayer;
 class PodcastEpisodeModel;
 
@@ -32,10 +34,11 @@ public:
 	 * Create a PodcastSource model
 	 * @param store info on PodcastSources
 	 * @param mp Mediaplayer will be passed on to EpisodesModel
+	 * @param icons in-memory icons served by image provider
 	 * @param parent
 	 */
-    PodcastSourceModel(
-        IPodcastStore& store, MediaPlayer& mp, QObject* parent = nullptr);
+    PodcastSourceModel(IPodcastStore& store, MediaPlayer& mp,
+        IconCache& icons, QObject* parent = nullptr);
 
     enum PodcastSourceRoles {
         DisplayNameRole = Qt::UserRole + 1,
@@ -51,6 +54,13 @@ public:
 
     Q_INVOKABLE DigitalRooster::PodcastEpisodeModel* get_episodes(int index);
 
+    /**
+     * Passed on to all episode models created afterwards
+     * @param downloader offline episodes
+     */
+    void set_episode_downloader(
+        std::shared_ptr<EpisodeDownloader> downloader);
+
     Q_INVOKABLE void refresh(int index);
     Q_INVOKABLE void purge(int index);
     Q_INVOKABLE void remove(int index);
@@ -58,12 +68,32 @@ public:
 public slots:
     void newDataAvailable();
 
+    /**
+     * Sources were added or removed, reset rows and load icons of new
+     * sources
+     */
+    void sources_changed();
+
+    /**
+     * Icon of a podcast source changed, update its row
+     * @param key \ref IconCache::podcast_key of source
+     */
+    void icon_updated(const QString& key);
+
 protected:
     QHash<int, QByteArray> roleNames() const;
 
 private:
     IPodcastStore& config;
     MediaPlayer& mpp;
+    IconCache& icons;
+    std::shared_ptr<EpisodeDownloader> episode_downloader;
+
+    /**
+     * Follow title and icon of all sources, sources already known are
+     * skipped
+     */
+    void register_sources();
 };
 
 } // namespace DigitalRooster
@@ -0,0 +1,49 @@
+/******************************************************************************
+ * \filename
+ * \brief	common benchmark functions
+ *
+ * \details Benchmarks are built into digitalrooster_benchmark, they are not
+ *          part of the unit test run
+ *
+ * \copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * \license {This file is licensed under GNU PUBLIC LICENSE Version 3 or later
+ * 			 SPDX-License-Identifier: GPL-3.0-or-later}
+ *
+ *****************************************************************************/
+#ifndef TEST_BENCHMARK_HPP_
+#define TEST_BENCHMARK_HPP_
+
+#include <QElapsedTimer>
+
+#include <gtest/gtest.h>
+#include <iostream>
+#include <string>
+
+/**
+ * Average duration of fn
+ * @param iterations number of calls of fn
+ * @param fn function to measure
+ * @return nanoseconds per call
+ */
+template <typename F> qint64 measure_ns(int iterations, F fn) {
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    return timer.nsecsElapsed() / iterations;
+}
+
+/**
+ * Print a result and record it in the gtest XML output
+ * @param name of result, e.g. "json_us"
+ * @param value measured value
+ * @param unit of value, printed only
+ */
+inline void report(
+    const std::string& name, qint64 value, const std::string& unit) {
+    std::cout << name << ": " << value << " " << unit << std::endl;
+    ::testing::Test::RecordProperty(name, std::to_string(value));
+}
+
+#endif /* TEST_BENCHMARK_HPP_ */
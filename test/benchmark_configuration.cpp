@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QCborMap>
+#include <QCborValue>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QUuid>
+
+#include <gtest/gtest.h>
+
+#include "appconstants.hpp"
+#include "benchmark.hpp"
+#include "configuration.hpp"
+
+using namespace DigitalRooster;
+
+/*****************************************************************************/
+static QByteArray read_file(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+/*****************************************************************************/
+TEST(ConfigurationBenchmark, snapshotVsJsonStartup) {
+    QJsonObject appconfig;
+    QJsonArray stations;
+    QJsonArray alarms;
+    for (int i = 0; i < 500; i++) {
+        QJsonObject station;
+        station[KEY_NAME] = QString("Station %1").arg(i);
+        station[KEY_ID] = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        station[KEY_URI] = QString("http://stream%1.example.com/live").arg(i);
+        stations.append(station);
+
+        QJsonObject alarm;
+        alarm[JSON_KEY_TIME] = "06:30";
+        alarm[KEY_URI] = QString("http://stream%1.example.com/live").arg(i);
+        alarm[KEY_ALARM_PERIOD] = KEY_ALARM_WORKDAYS;
+        alarm[KEY_ENABLED] = (i % 2 == 0);
+        alarm[KEY_VOLUME] = 30;
+        alarm[KEY_ID] = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        alarms.append(alarm);
+    }
+    appconfig[KEY_GROUP_IRADIO_SOURCES] = stations;
+    appconfig[KEY_GROUP_ALARMS] = alarms;
+
+    QString path(TEST_FILE_PATH + "/benchmark_config.json");
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(QJsonDocument(appconfig).toJson());
+    file.close();
+    /* the first start writes the snapshot */
+    {
+        Configuration config(path, DEFAULT_CACHE_DIR_PATH);
+        config.update_configuration();
+        ASSERT_EQ(config.get_stations().size(), 500U);
+    }
+    auto snapshot_path = path + CONFIG_SNAPSHOT_SUFFIX;
+    ASSERT_TRUE(QFile::exists(snapshot_path));
+
+    /* what Configuration::refresh_configuration() does before the items
+     * are created, which is the same for both formats */
+    const int iterations = 50;
+    auto json_ns = measure_ns(iterations, [&]() {
+        auto obj = QJsonDocument::fromJson(read_file(path)).object();
+        ASSERT_EQ(obj.size(), appconfig.size());
+    });
+    auto snapshot_ns = measure_ns(iterations, [&]() {
+        auto json = read_file(path);
+        auto snapshot = QCborValue::fromCbor(read_file(snapshot_path)).toMap();
+        ASSERT_EQ(snapshot.value(KEY_SNAPSHOT_SOURCE).toByteArray(),
+            QCryptographicHash::hash(json, QCryptographicHash::Sha1));
+        auto obj = snapshot.value(KEY_SNAPSHOT_CONFIG).toMap().toJsonObject();
+        ASSERT_EQ(obj.size(), appconfig.size());
+    });
+
+    report("json_bytes", QFile(path).size(), "bytes");
+    report("snapshot_bytes", QFile(snapshot_path).size(), "bytes");
+    report("json_us", json_ns / 1000, "us/start");
+    report("snapshot_us", snapshot_ns / 1000, "us/start");
+
+    QFile::remove(path);
+    QFile::remove(snapshot_path);
+    QFile::remove(path + CONFIG_JOURNAL_SUFFIX);
+}
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QDateTime>
+#include <QRegExp>
+#include <QString>
+#include <QUrl>
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "episode_store.hpp"
+
+using namespace DigitalRooster;
+
+/******************************************************************************/
+TEST(EpisodeStoreBenchmark, scrollEpisodeList) {
+    const int count = 2000;
+    const int passes = 20;
+    EpisodeStore store;
+    std::vector<EpisodeRecord> records;
+    for (int i = 0; i < count; i++) {
+        EpisodeRecord record;
+        record.title = QString("Episode %1").arg(i);
+        record.publisher = QString("Publisher");
+        record.guid = QString("guid-%1").arg(i);
+        record.url = QUrl(QString("http://some.url/%1.mp3").arg(i));
+        record.publication_date =
+            QDateTime::fromSecsSinceEpoch(1000000000LL + i * 3600LL);
+        record.description =
+            QString("<p>Episode <b>%1</b> with <a href=\"http://some.url\">"
+                    "show notes</a></p><ul><li>topic</li><li>topic</li></ul>")
+                .arg(i)
+                .repeated(4);
+        records.push_back(record);
+    }
+    store.merge(std::move(records), count);
+
+    /* roles requested by a delegate scrolled into view, the summary is
+     * computed with the first pass */
+    qint64 chars = 0;
+    auto summary_ns = measure_ns(passes, [&]() {
+        for (int row = 0; row < store.size(); row++) {
+            chars += store.display_name(row).size();
+            chars += store.summary(row).size();
+            chars += store.publication_date(row).toString("dd.MMM.yyyy").size();
+        }
+    });
+    /* stripping tags each time a row is shown */
+    auto regex_ns = measure_ns(passes, [&]() {
+        for (int row = 0; row < store.size(); row++) {
+            chars += store.display_name(row).size();
+            auto desc = store.description(row);
+            desc.remove(QRegExp("<[^>]*>"));
+            chars += desc.size();
+            chars += store.publication_date(row).toString("dd.MMM.yyyy").size();
+        }
+    });
+    ASSERT_GT(chars, 0);
+    EXPECT_EQ(store.decoded_descriptions(), static_cast<quint64>(count));
+    report("summary_ns", summary_ns / count, "ns/row");
+    report("regex_ns", regex_ns / count, "ns/row");
+}
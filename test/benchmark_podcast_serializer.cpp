@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "PodcastSource.hpp"
+#include "appconstants.hpp"
+#include "benchmark.hpp"
+#include "podcast_serializer.hpp"
+#include "rss2podcastsource.hpp"
+
+using namespace DigitalRooster;
+
+/******************************************************************************/
+TEST(SerializerBenchmark, binaryVsJsonCacheLoad) {
+    QFile rss(TEST_FILE_PATH + "/alternativlos.rss");
+    ASSERT_TRUE(rss.open(QIODevice::ReadOnly));
+    PodcastSource feed(QUrl("http://some.url/feed.rss"));
+    update_podcast(feed, rss.readAll());
+    ASSERT_GT(feed.get_episode_count(), 0);
+
+    /* scale up the fixture to a long running podcast */
+    const int copies = 40;
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    ps.set_max_episodes(copies * feed.get_episode_count());
+    std::vector<std::shared_ptr<PodcastEpisode>> episodes;
+    for (int i = 0; i < copies; i++) {
+        for (const auto& ep : feed.get_episodes()) {
+            auto copy = std::make_shared<PodcastEpisode>(
+                ep->get_title(), ep->get_url());
+            copy->set_guid(ep->get_guid() + QString::number(i));
+            copy->set_description(ep->get_description());
+            copy->set_publisher(ep->get_publisher());
+            copy->set_duration(ep->get_duration());
+            copy->set_publication_date(
+                ep->get_publication_date().addYears(-i));
+            episodes.push_back(copy);
+        }
+    }
+    ps.add_episodes(episodes);
+    QString json_file("benchmark_cache.json");
+    QString binary_file("benchmark_cache.bin");
+    write_cache_json(cache_json_from_podcast_source(&ps), json_file);
+    store_to_file(&ps, binary_file);
+
+    const int iterations = 10;
+    auto json_ns = measure_ns(iterations, [&]() {
+        PodcastSource restored(QUrl("http://some.url/feed.rss"));
+        restored.set_max_episodes(ps.get_max_episodes());
+        restore_podcast_source(read_cache_json(json_file), &restored);
+        ASSERT_EQ(restored.get_episode_count(), ps.get_episode_count());
+    });
+    auto binary_ns = measure_ns(iterations, [&]() {
+        PodcastSource restored(QUrl("http://some.url/feed.rss"));
+        restored.set_max_episodes(ps.get_max_episodes());
+        read_from_file(&restored, binary_file);
+        ASSERT_EQ(restored.get_episode_count(), ps.get_episode_count());
+    });
+
+    report("episodes", ps.get_episode_count(), "episodes");
+    report("json_bytes", QFileInfo(json_file).size(), "bytes");
+    report("binary_bytes", QFileInfo(binary_file).size(), "bytes");
+    report("json_us", json_ns / 1000, "us/load");
+    report("binary_us", binary_ns / 1000, "us/load");
+    QFile::remove(json_file);
+    QFile::remove(binary_file);
+}
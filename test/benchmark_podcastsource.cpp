@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QDateTime>
+#include <QSignalSpy>
+#include <QString>
+#include <QUrl>
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "PlayableItem.hpp"
+#include "PodcastSource.hpp"
+#include "benchmark.hpp"
+
+using namespace DigitalRooster;
+
+/******************************************************************************/
+TEST(PodcastSourceBenchmark, episodeIngestionScaling) {
+    const int first_count = 1000;
+    qint64 first_refresh_ns = 0;
+    qint64 last_refresh_ns = 0;
+    for (int count : {first_count, 2000, 4000, 8000}) {
+        std::vector<std::shared_ptr<PodcastEpisode>> episodes;
+        for (int i = 0; i < count; i++) {
+            auto ep = std::make_shared<PodcastEpisode>(
+                QString("Episode %1").arg(i),
+                QUrl(QString("http://some.url/%1.mp3").arg(i)));
+            ep->set_guid(QString("guid-%1").arg(i));
+            ep->set_publication_date(
+                QDateTime::fromSecsSinceEpoch(1000000000LL - i * 3600LL));
+            episodes.push_back(ep);
+        }
+        PodcastSource ps(QUrl("http://some.url/feed.rss"));
+        ps.set_max_episodes(count);
+        auto add_ns = measure_ns(1, [&]() {
+            for (const auto& ep : episodes) {
+                ps.add_episode(ep);
+            }
+        });
+        /* Refresh: every item is looked up again */
+        auto refresh_ns = measure_ns(1, [&]() {
+            for (const auto& ep : episodes) {
+                ps.add_episode(ep);
+            }
+        });
+        ASSERT_EQ(ps.get_episode_count(), count);
+
+        PodcastSource batch_ps(QUrl("http://some.url/feed.rss"));
+        batch_ps.set_max_episodes(count);
+        QSignalSpy spy(&batch_ps, SIGNAL(episodes_count_changed(int)));
+        auto batch_ns =
+            measure_ns(1, [&]() { batch_ps.add_episodes(episodes); });
+        ASSERT_EQ(batch_ps.get_episode_count(), count);
+        ASSERT_EQ(spy.count(), 1);
+
+        auto prefix = std::to_string(count) + "_episodes_";
+        report(prefix + "add_ns", add_ns / count, "ns/episode");
+        report(prefix + "refresh_ns", refresh_ns / count, "ns/episode");
+        report(prefix + "batch_ns", batch_ns / count, "ns/episode");
+        if (count == first_count) {
+            first_refresh_ns = refresh_ns / count;
+        }
+        last_refresh_ns = refresh_ns / count;
+    }
+    /* constant time lookup, a linear search would take 8 times as long */
+    EXPECT_LT(last_refresh_ns, 4 * first_refresh_ns);
+}
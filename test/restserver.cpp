@@ -12,7 +12,9 @@
 
 #include "RestApi.hpp"
 #include "appconstants.hpp"
+#include "concurrent_store.hpp"
 #include "configuration.hpp"
+#include "network_service.hpp"
 #include "testcommon.hpp"
 #include "util.hpp"
 
@@ -30,6 +32,7 @@ void term_handler(int sig) {
  */
 int main(int argc, char** argv) {
     QCoreApplication app(argc, argv);
+    NetworkService network;
     const auto& cmdline = get_commandline_options(app);
     setup_log_facility(cmdline);
 
@@ -38,7 +41,8 @@ int main(int argc, char** argv) {
 
     Configuration config(
         cmdline.value(CMD_ARG_CONFIG_FILE), cmdline.value(CMD_ARG_CACHE_DIR));
-    RestApi restserver(config, config, config, config, config);
+    ConcurrentStore store(config);
+    RestApi restserver(store);
     config.update_configuration();
 
     /*
@@ -15,7 +15,9 @@
 
 #include "appconstants.hpp"
 #include "logger.hpp"
+#include "network_service.hpp"
 #include "testcommon.hpp"
+#include "util.hpp"
 
 /**
  * see :
@@ -24,6 +26,7 @@
 
 int main(int argc, char** argv) {
     QCoreApplication app(argc, argv);
+    DigitalRooster::NetworkService network;
     setup_tests();
     qDebug() << argv[0];
     DigitalRooster::setup_logger_file(DigitalRooster::DEFAULT_LOG_FILE);
@@ -36,6 +39,7 @@ int main(int argc, char** argv) {
         &exitTimer, &QTimer::timeout, &app, QCoreApplication::quit);
     exitTimer.start();
     app.exec();
+    DigitalRooster::worker_pool().waitForDone();
     return ret;
 }
 /*****************************************************************************/
@@ -208,3 +208,42 @@ TEST_F(AlarmDispatcherFixture, AlarmTriggersReschedule) {
     ASSERT_GT(next_delta.count(), 23 * 3600 * 1000);
     ASSERT_LT(next_delta.count(), 24 * 3600 * 1000);
 }
+
+/*****************************************************************************/
+TEST_F(AlarmDispatcherFixture, AlarmPendingBeforeAlarm) {
+    /* 10 seconds to dispatch */
+    EXPECT_CALL(*(mc.get()), get_time())
+        .Times(AnyNumber())
+        .WillRepeatedly(
+            Return(QDateTime::fromString("2020-11-22T08:29:50", Qt::ISODate)));
+
+    QSignalSpy spy_pending(
+        dut.get(), SIGNAL(alarm_pending(DigitalRooster::Alarm*)));
+    QSignalSpy spy_triggered(
+        dut.get(), SIGNAL(alarm_triggered(DigitalRooster::Alarm*)));
+    ASSERT_TRUE(spy_pending.isValid());
+
+    /* pending 500ms from now */
+    dut->set_prewarm_time(std::chrono::milliseconds(9500));
+    ASSERT_TRUE(spy_pending.wait(1500));
+    EXPECT_EQ(spy_pending.takeFirst().at(0).value<DigitalRooster::Alarm*>(),
+        alm1.get());
+    EXPECT_EQ(spy_triggered.count(), 0);
+}
+
+/*****************************************************************************/
+TEST_F(AlarmDispatcherFixture, NoAlarmPendingIfTooLate) {
+    /* 1 seconds to dispatch */
+    EXPECT_CALL(*(mc.get()), get_time())
+        .Times(AnyNumber())
+        .WillRepeatedly(
+            Return(QDateTime::fromString("2020-11-22T08:29:59", Qt::ISODate)));
+
+    QSignalSpy spy_pending(
+        dut.get(), SIGNAL(alarm_pending(DigitalRooster::Alarm*)));
+    QSignalSpy spy_triggered(
+        dut.get(), SIGNAL(alarm_triggered(DigitalRooster::Alarm*)));
+    dut->check_alarms();
+    ASSERT_TRUE(spy_triggered.wait(1500));
+    EXPECT_EQ(spy_pending.count(), 0);
+}
@@ -17,6 +17,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "PlayableItem.hpp"
 #include "alarm.hpp"
 #include "alarmmonitor.hpp"
 #include "player_mock.hpp"
@@ -111,3 +112,103 @@ TEST(AlarmMonitor, noFallBackIfStoppedNormally) {
     mon.stop();
     ASSERT_EQ(mon.get_state(), AlarmMonitor::Idle);
 }
+
+/*****************************************************************************/
+TEST(AlarmMonitor, prearmedAlarmResumesBufferedMedia) {
+    NiceMock<PlayerMock> player;
+    AlarmMonitor mon(player);
+    auto alm = std::make_shared<DigitalRooster::Alarm>(
+        QUrl("https://raw.githubusercontent.com/truschival/"
+             "DigitalRoosterGui/develop/test/testaudio.mp3"),
+        QTime::currentTime().addSecs(1), Alarm::Daily);
+
+    EXPECT_CALL(player, do_set_muted(true)).Times(1);
+    EXPECT_CALL(player, do_set_media(_)).Times(1);
+    EXPECT_CALL(player, do_pause()).Times(1);
+    EXPECT_CALL(player, do_play()).Times(2);
+    EXPECT_CALL(player, do_set_muted(false)).Times(1);
+    EXPECT_CALL(player, do_set_volume(DEFAULT_ALARM_VOLUME)).Times(1);
+
+    mon.alarm_pending(alm.get());
+    ASSERT_EQ(mon.get_state(), AlarmMonitor::PreArmed);
+    /* buffered media is paused until the alarm is due */
+    player.playback_state_changed(QMediaPlayer::PlayingState);
+    ASSERT_EQ(mon.get_start_latency().count(), -1);
+
+    mon.alarm_triggered(alm.get());
+    ASSERT_EQ(mon.get_state(), AlarmMonitor::Armed);
+    player.playback_state_changed(QMediaPlayer::PlayingState);
+    EXPECT_GE(mon.get_start_latency().count(), 0);
+    mon.stop();
+    ASSERT_EQ(mon.get_state(), AlarmMonitor::Idle);
+}
+
+/*****************************************************************************/
+TEST(AlarmMonitor, prearmTriesAlternativesThenFallback) {
+    NiceMock<PlayerMock> player;
+    AlarmMonitor mon(player);
+    auto alm = std::make_shared<DigitalRooster::Alarm>(
+        QUrl("https://raw.githubusercontent.com/truschival/"
+             "DigitalRoosterGui/develop/test/testaudio.mp3"),
+        QTime::currentTime().addSecs(1), Alarm::Daily);
+    auto station = std::make_shared<PlayableItem>(
+        "Station", QUrl("http://st01.dlf.de/dlf/01/104/ogg/stream.ogg"));
+    mon.set_alternative_sources({station});
+
+    /* alarm media first, then the alternative */
+    EXPECT_CALL(player, do_set_media(_)).Times(1);
+    EXPECT_CALL(player, do_set_media(station)).Times(1);
+    EXPECT_CALL(player, do_set_playlist(_)).Times(1);
+    EXPECT_CALL(player, do_set_volume(DEFAULT_FALLBACK_VOLUME)).Times(1);
+
+    mon.alarm_pending(alm.get());
+    player.emitError(QMediaPlayer::NetworkError);
+    player.emitError(QMediaPlayer::NetworkError);
+    ASSERT_EQ(mon.get_state(), AlarmMonitor::PreArmed);
+
+    /* nothing could be buffered, fallback plays right away */
+    mon.alarm_triggered(alm.get());
+    ASSERT_EQ(mon.get_state(), AlarmMonitor::FallBackMode);
+}
+
+/*****************************************************************************/
+TEST(AlarmMonitor, userResumingBufferedMediaUnmutes) {
+    NiceMock<PlayerMock> player;
+    AlarmMonitor mon(player);
+    auto alm = std::make_shared<DigitalRooster::Alarm>(
+        QUrl("https://raw.githubusercontent.com/truschival/"
+             "DigitalRoosterGui/develop/test/testaudio.mp3"),
+        QTime::currentTime().addSecs(1), Alarm::Daily);
+
+    EXPECT_CALL(player, do_set_muted(true)).Times(1);
+    EXPECT_CALL(player, do_pause()).Times(1);
+    EXPECT_CALL(player, do_set_muted(false)).Times(1);
+    EXPECT_CALL(player, do_stop()).Times(0);
+
+    mon.alarm_pending(alm.get());
+    player.playback_state_changed(QMediaPlayer::PlayingState);
+    /* paused by the monitor, playing again means the user resumed it */
+    player.playback_state_changed(QMediaPlayer::PlayingState);
+    ASSERT_EQ(mon.get_state(), AlarmMonitor::Idle);
+}
+
+/*****************************************************************************/
+TEST(AlarmMonitor, userMediaChangeUnmutes) {
+    NiceMock<PlayerMock> player;
+    AlarmMonitor mon(player);
+    auto alm = std::make_shared<DigitalRooster::Alarm>(
+        QUrl("https://raw.githubusercontent.com/truschival/"
+             "DigitalRoosterGui/develop/test/testaudio.mp3"),
+        QTime::currentTime().addSecs(1), Alarm::Daily);
+
+    EXPECT_CALL(player, do_set_muted(true)).Times(1);
+    EXPECT_CALL(player, do_set_muted(false)).Times(1);
+    /* media of the user is not paused */
+    EXPECT_CALL(player, do_pause()).Times(0);
+
+    mon.alarm_pending(alm.get());
+    ASSERT_EQ(mon.get_state(), AlarmMonitor::PreArmed);
+    player.media_changed(QMediaContent(QUrl("http://some.url/stream.mp3")));
+    ASSERT_EQ(mon.get_state(), AlarmMonitor::Idle);
+    player.playback_state_changed(QMediaPlayer::PlayingState);
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+/*
+ * Replaces the global operator new of digitalrooster_alloc_test, this file
+ * must not be linked into other test binaries
+ */
+
+#include <QDateTime>
+#include <QString>
+#include <QUrl>
+
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "PlayableItem.hpp"
+#include "episode_store.hpp"
+
+using namespace DigitalRooster;
+
+/**
+ * Calls of operator new on this thread while \ref count_allocations is set.
+ * Counts heap objects, not bytes: QString and QHash buffers are allocated
+ * with malloc and not counted.
+ */
+static thread_local bool count_allocations = false;
+static thread_local long allocations = 0;
+
+/******************************************************************************/
+void* operator new(std::size_t size) {
+    if (count_allocations) {
+        allocations++;
+    }
+    if (auto ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+/******************************************************************************/
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+/******************************************************************************/
+template <typename F> static long count_allocations_of(F f) {
+    allocations = 0;
+    count_allocations = true;
+    f();
+    count_allocations = false;
+    return allocations;
+}
+
+/******************************************************************************/
+TEST(EpisodeStore, recordsNeedNoAllocationPerEpisode) {
+    const int count = 20000;
+    EpisodeStore store;
+    std::vector<EpisodeRecord> records;
+    records.reserve(count);
+    for (int i = 0; i < count; i++) {
+        EpisodeRecord record;
+        record.title = QString("Episode %1").arg(i);
+        record.publisher = QString("Publisher");
+        record.guid = QString("guid-%1").arg(i);
+        record.url = QUrl(QString("http://some.url/%1.mp3").arg(i));
+        record.publication_date =
+            QDateTime::fromSecsSinceEpoch(1000000000LL + i * 3600LL);
+        record.duration = 3600000;
+        record.description =
+            QString("<p>Description of episode %1</p>").arg(i);
+        /* provided by parser and cache */
+        record.summary = QString("Description of episode %1").arg(i);
+        records.push_back(record);
+    }
+    /* columns grow geometrically, no heap object per episode */
+    auto store_allocations = count_allocations_of(
+        [&]() { store.merge(std::move(records), count); });
+    ASSERT_EQ(store.size(), count);
+    EXPECT_LT(store_allocations, count / 10);
+
+    /* at least one object and control block per episode */
+    std::vector<std::shared_ptr<PodcastEpisode>> episodes;
+    episodes.reserve(count);
+    auto object_allocations = count_allocations_of([&]() {
+        for (int i = 0; i < count; i++) {
+            episodes.push_back(store.create_episode(i));
+        }
+    });
+    EXPECT_GE(object_allocations, count);
+    EXPECT_GT(object_allocations, 10 * store_allocations);
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "PodcastSource.hpp"
+#include "appconstants.hpp"
+#include "cache_writer.hpp"
+#include "podcast_serializer.hpp"
+
+using namespace DigitalRooster;
+
+/******************************************************************************/
+class CacheWriterFixture : public virtual ::testing::Test {
+public:
+    CacheWriterFixture()
+        : cache_dir(DEFAULT_CACHE_DIR_PATH)
+        , writer(std::make_shared<CacheWriter>(std::chrono::milliseconds(50)))
+        , ps1(QUrl("http://some.url/feed1.rss"))
+        , ps2(QUrl("http://some.url/feed2.rss")) {
+    }
+
+    void SetUp() {
+        cache_dir.mkpath(".");
+        ser1 = add_serializer(ps1);
+        ser2 = add_serializer(ps2);
+    }
+
+    void TearDown() {
+        writer->wait();
+        QFile::remove(cache_file(ps1));
+        QFile::remove(cache_file(ps2));
+    }
+
+protected:
+    QDir cache_dir;
+    std::shared_ptr<CacheWriter> writer;
+    PodcastSource ps1;
+    PodcastSource ps2;
+    PodcastSerializer* ser1 = nullptr;
+    PodcastSerializer* ser2 = nullptr;
+
+    QString cache_file(const PodcastSource& ps) const {
+        return cache_dir.filePath(ps.get_id_string());
+    }
+
+    PodcastSerializer* add_serializer(PodcastSource& ps) {
+        auto serializer = std::make_unique<PodcastSerializer>(cache_dir, &ps);
+        serializer->set_cache_writer(writer);
+        auto raw = serializer.get();
+        ps.set_serializer(std::move(serializer));
+        return raw;
+    }
+};
+
+/******************************************************************************/
+TEST_F(CacheWriterFixture, dirtySourcesWrittenInOneBatch) {
+    ser1->delayed_write();
+    ser2->delayed_write();
+    ser1->delayed_write();
+    EXPECT_EQ(writer->dirty_sources(), 2);
+    EXPECT_EQ(writer->pending_writes(), 0);
+
+    QTimer wait_timer;
+    wait_timer.setSingleShot(true);
+    QSignalSpy spy(&wait_timer, SIGNAL(timeout()));
+    wait_timer.start(200);
+    ASSERT_TRUE(spy.wait(1000));
+    writer->wait();
+
+    EXPECT_EQ(writer->dirty_sources(), 0);
+    EXPECT_EQ(writer->pending_writes(), 0);
+    EXPECT_EQ(writer->files_written(), 2);
+    EXPECT_EQ(writer->bytes_written(),
+        QFileInfo(cache_file(ps1)).size() + QFileInfo(cache_file(ps2)).size());
+}
+
+/******************************************************************************/
+TEST_F(CacheWriterFixture, flushWritesImmediately) {
+    ser1->delayed_write();
+    writer->flush();
+    EXPECT_EQ(writer->dirty_sources(), 0);
+    EXPECT_EQ(writer->pending_writes(), 0);
+    EXPECT_EQ(writer->files_written(), 1);
+    EXPECT_TRUE(QFile::exists(cache_file(ps1)));
+    EXPECT_FALSE(QFile::exists(cache_file(ps2)));
+}
+
+/******************************************************************************/
+TEST_F(CacheWriterFixture, deleteCancelsScheduledWrite) {
+    ser1->write();
+    writer->wait();
+    ASSERT_TRUE(QFile::exists(cache_file(ps1)));
+
+    ser1->delayed_write();
+    ser1->delete_cached_info();
+    EXPECT_EQ(writer->dirty_sources(), 0);
+    writer->flush();
+    EXPECT_FALSE(QFile::exists(cache_file(ps1)));
+    EXPECT_EQ(writer->files_written(), 1);
+}
+
+/******************************************************************************/
+TEST_F(CacheWriterFixture, metadataChangeSchedulesWrite) {
+    ps1.set_title("New Title");
+    EXPECT_EQ(writer->dirty_sources(), 1);
+    writer->flush();
+    PodcastSource restored(QUrl("http://some.url/feed1.rss"));
+    read_from_file(&restored, cache_file(ps1));
+    EXPECT_EQ(restored.get_title(), QString("New Title"));
+}
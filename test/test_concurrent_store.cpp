@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "PodcastSource.hpp"
+#include "appconstants.hpp"
+#include "concurrent_store.hpp"
+#include "configuration.hpp"
+
+using namespace DigitalRooster;
+using namespace std::chrono_literals;
+
+class ConcurrentStoreFixture : public virtual ::testing::Test {
+public:
+    ConcurrentStoreFixture()
+        : filename(TEST_FILE_PATH + "/concurrent_store.json") {
+    }
+
+    void SetUp() {
+        QFile::remove(filename);
+        /* Configuration creates default config in file */
+        config = std::make_unique<Configuration>(filename, TEST_FILE_PATH);
+        store = std::make_unique<ConcurrentStore>(*config);
+    }
+
+    void TearDown() {
+        store.reset();
+        config.reset();
+        QFile::remove(filename);
+        QFile::remove(filename + CONFIG_SNAPSHOT_SUFFIX);
+        QFile::remove(filename + CONFIG_JOURNAL_SUFFIX);
+    }
+
+protected:
+    QString filename;
+    std::unique_ptr<Configuration> config;
+    std::unique_ptr<ConcurrentStore> store;
+
+    /**
+     * Process Qt events until future is ready
+     */
+    template <typename T> void wait_for(std::future<T>& fut) {
+        while (fut.wait_for(0ms) != std::future_status::ready) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+    }
+};
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, snapshotHasAllItems) {
+    auto snapshot = store->get_snapshot();
+    ASSERT_EQ(snapshot->alarms.size(), config->get_alarms().size());
+    ASSERT_EQ(snapshot->stations.size(), config->get_stations().size());
+    ASSERT_EQ(snapshot->podcasts.size(), config->get_podcast_sources().size());
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, findJsonById) {
+    auto snapshot = store->get_snapshot();
+    auto id = config->get_alarms()[0]->get_id();
+    auto json = find_json_by_id(snapshot->alarms, id);
+    ASSERT_EQ(json[KEY_ID].toString(), id.toString(QUuid::WithoutBraces));
+    ASSERT_THROW(find_json_by_id(snapshot->alarms, QUuid::createUuid()),
+        std::out_of_range);
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, addStationFromOtherThread) {
+    auto old_snapshot = store->get_snapshot();
+    QJsonObject json;
+    json[KEY_NAME] = "SWR2";
+    json[KEY_URI] = "http://swr2.de";
+
+    StoreChange<QUuid> change;
+    std::thread worker([&]() { change = store->add_radio_station(json); });
+    worker.join();
+    wait_for(change.result);
+    auto id = change.result.get();
+
+    auto snapshot = store->get_snapshot();
+    ASSERT_GT(snapshot->generation, old_snapshot->generation);
+    ASSERT_EQ(snapshot->stations.size(), old_snapshot->stations.size() + 1);
+    ASSERT_NO_THROW(find_json_by_id(snapshot->stations, id));
+    /* Readers holding the old snapshot are not affected */
+    ASSERT_THROW(
+        find_json_by_id(old_snapshot->stations, id), std::out_of_range);
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, deleteAlarmFromOtherThread) {
+    auto id = config->get_alarms()[0]->get_id();
+    auto count = config->get_alarms().size();
+
+    StoreChange<void> change;
+    std::thread worker([&]() { change = store->delete_alarm(id); });
+    worker.join();
+    wait_for(change.result);
+    ASSERT_NO_THROW(change.result.get());
+    ASSERT_EQ(config->get_alarms().size(), count - 1);
+    ASSERT_EQ(store->get_snapshot()->alarms.size(), count - 1);
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, cancelledChangeIsNotApplied) {
+    auto count = config->get_stations().size();
+    QJsonObject json;
+    json[KEY_NAME] = "SWR2";
+    json[KEY_URI] = "http://swr2.de";
+
+    /* the store thread is blocked in join() and processes no events */
+    StoreChange<QUuid> change;
+    bool cancelled = false;
+    std::thread worker([&]() {
+        change = store->add_radio_station(json);
+        if (change.result.wait_for(50ms) != std::future_status::ready) {
+            cancelled = change.cancel();
+        }
+    });
+    worker.join();
+    ASSERT_TRUE(cancelled);
+
+    QCoreApplication::processEvents();
+    ASSERT_EQ(config->get_stations().size(), count);
+    ASSERT_EQ(store->get_snapshot()->stations.size(), count);
+    ASSERT_THROW(change.result.get(), std::future_error);
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, startedChangeCannotBeCancelled) {
+    auto count = config->get_alarms().size();
+    /* executed immediately on the store thread */
+    auto change = store->delete_alarm(config->get_alarms()[0]->get_id());
+    ASSERT_FALSE(change.cancel());
+    ASSERT_NO_THROW(change.result.get());
+    ASSERT_EQ(config->get_alarms().size(), count - 1);
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, deleteUnknownForwardsException) {
+    auto change = store->delete_podcast_source(QUuid::createUuid());
+    ASSERT_THROW(change.result.get(), std::out_of_range);
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, addInvalidAlarmForwardsException) {
+    QJsonObject json;
+    json[JSON_KEY_TIME] = "25:61";
+    json[KEY_URI] = "http://swr2.de";
+    auto change = store->add_alarm(json);
+    ASSERT_THROW(change.result.get(), std::invalid_argument);
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, snapshotFollowsConfigurationChanges) {
+    auto generation = store->get_snapshot()->generation;
+    config->delete_radio_station(config->get_stations()[0]->get_id());
+    auto snapshot = store->get_snapshot();
+    ASSERT_GT(snapshot->generation, generation);
+    ASSERT_EQ(snapshot->stations.size(), config->get_stations().size());
+}
+
+/*****************************************************************************/
+TEST_F(ConcurrentStoreFixture, snapshotFollowsPodcastChanges) {
+    auto ps = config->get_podcast_sources()[0];
+    auto generation = store->get_snapshot()->generation;
+    ps->set_title("Renamed");
+    for (int i = 0; i < 100 && store->get_snapshot()->generation == generation;
+         i++) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        std::this_thread::sleep_for(10ms);
+    }
+    auto json = find_json_by_id(store->get_snapshot()->podcasts, ps->get_id());
+    ASSERT_EQ(json[JSON_KEY_TITLE].toString(), QString("Renamed"));
+}
@@ -4,6 +4,9 @@
  * Licensed under GNU PUBLIC LICENSE Version 3 or later
  */
 
+#include <QCborMap>
+#include <QCborValue>
+#include <QCryptographicHash>
 #include <QJsonDocument>
 #include <QSettings>
 #include <QSignalSpy>
@@ -234,6 +237,18 @@ TEST_F(ConfigurationFixture, add_podcast_source) {
     ASSERT_EQ(config->get_podcast_sources().size(), size_before + 1);
 }
 
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, addedPodcastSourceIsCached) {
+    auto ps = std::make_shared<PodcastSource>(
+        QUrl("https://alternativlos.org/alternativlos.rss"));
+    config->add_podcast_source(ps);
+    ASSERT_TRUE(ps->has_update_task());
+    ps->set_title("Added by client");
+    /* flushes pending cache writes */
+    config.reset();
+    ASSERT_TRUE(QFile::exists(QDir(cache_dir).filePath(ps->get_id_string())));
+}
+
 /*****************************************************************************/
 TEST_F(ConfigurationFixture, get_podcast_source_throws) {
     EXPECT_THROW(
@@ -478,6 +493,75 @@ TEST_F(ConfigurationFixture, emitConfigChanged) {
     ASSERT_EQ(config->get_alarms().size(), number_of_alarms);
 }
 
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, reloadKeepsObjects) {
+    auto ps = config->get_podcast_sources()[0];
+    auto alarm = config->get_alarms()[0];
+    QSignalSpy spy_alarms(config.get(), SIGNAL(alarms_changed()));
+    QSignalSpy spy_podcasts(config.get(), SIGNAL(podcast_sources_changed()));
+    QSignalSpy spy_stations(config.get(), SIGNAL(stations_changed()));
+    config->update_configuration();
+    ASSERT_EQ(config->get_podcast_sources()[0], ps);
+    ASSERT_EQ(config->get_alarms()[0], alarm);
+    ASSERT_EQ(spy_alarms.count(), 0);
+    ASSERT_EQ(spy_podcasts.count(), 0);
+    ASSERT_EQ(spy_stations.count(), 0);
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, reloadUpdatesChangedAlarm) {
+    auto alarm = config->get_alarms()[0];
+    auto json_alarms = appconfig[KEY_GROUP_ALARMS].toArray();
+    auto al1 = json_alarms[0].toObject();
+    al1[JSON_KEY_TIME] = "11:11";
+    json_alarms[0] = al1;
+    appconfig[KEY_GROUP_ALARMS] = json_alarms;
+    QFile tf(filename);
+    tf.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+    tf.write(QJsonDocument(appconfig).toJson());
+    tf.close();
+
+    QSignalSpy spy_alarms(config.get(), SIGNAL(alarms_changed()));
+    QSignalSpy spy_podcasts(config.get(), SIGNAL(podcast_sources_changed()));
+    config->update_configuration();
+    ASSERT_EQ(config->get_alarms()[0], alarm);
+    ASSERT_EQ(alarm->get_time(), QTime::fromString("11:11", "hh:mm"));
+    ASSERT_EQ(spy_alarms.count(), 1);
+    ASSERT_EQ(spy_podcasts.count(), 0);
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, reloadRemovesPodcast) {
+    auto ps = config->get_podcast_source(
+        QUuid("a754affb-fd4b-4825-9eba-32b64fd7d50c"));
+    auto json_podcasts = appconfig[KEY_GROUP_PODCAST_SOURCES].toArray();
+    json_podcasts.removeAt(0);
+    appconfig[KEY_GROUP_PODCAST_SOURCES] = json_podcasts;
+    QFile tf(filename);
+    tf.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+    tf.write(QJsonDocument(appconfig).toJson());
+    tf.close();
+
+    QSignalSpy spy(config.get(), SIGNAL(podcast_sources_changed()));
+    config->update_configuration();
+    ASSERT_EQ(spy.count(), 1);
+    ASSERT_EQ(config->get_podcast_sources().size(), 1);
+    ASSERT_EQ(config->get_podcast_sources()[0].get(), ps);
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, fileChangedIsDebounced) {
+    QSignalSpy spy(config.get(), SIGNAL(configuration_changed()));
+    ASSERT_TRUE(spy.isValid());
+    config->fileChanged(filename);
+    config->fileChanged(filename);
+    config->fileChanged(filename);
+    ASSERT_EQ(spy.count(), 0);
+    ASSERT_TRUE(spy.wait(CONFIG_RELOAD_DELAY.count() * 4));
+    spy.wait(CONFIG_RELOAD_DELAY.count() * 2);
+    ASSERT_EQ(spy.count(), 1);
+}
+
 /*****************************************************************************/
 TEST(Configuration, DefaultForNotWritableCache) {
     QDir default_cache_dir(DEFAULT_CACHE_DIR_PATH);
@@ -537,3 +621,135 @@ TEST_F(ConfigurationFixture, changeSleepTimeoutMinutes) {
 }
 
 /*****************************************************************************/
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, snapshotWrittenOnStore) {
+    QFile snapshot(filename + CONFIG_SNAPSHOT_SUFFIX);
+    snapshot.remove();
+    config->store_current_config();
+    ASSERT_TRUE(snapshot.exists());
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, snapshotPreferredIfSourceMatches) {
+    QFile tf(filename);
+    tf.open(QIODevice::ReadOnly | QIODevice::Text);
+    auto json = tf.readAll();
+    tf.close();
+    /* snapshot of the same JSON file but different content */
+    auto modified = appconfig;
+    modified[KEY_SLEEP_TIMEOUT] = 42;
+    QCborMap snapshot;
+    snapshot.insert(KEY_VERSION, CONFIG_SNAPSHOT_VERSION);
+    snapshot.insert(KEY_SNAPSHOT_SOURCE,
+        QCryptographicHash::hash(json, QCryptographicHash::Sha1));
+    snapshot.insert(KEY_SNAPSHOT_CONFIG, QCborMap::fromJsonObject(modified));
+    QFile sf(filename + CONFIG_SNAPSHOT_SUFFIX);
+    sf.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    sf.write(QCborValue(snapshot).toCbor());
+    sf.close();
+
+    config->update_configuration();
+    ASSERT_EQ(config->get_sleep_timeout(), std::chrono::minutes(42));
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, staleSnapshotIgnored) {
+    appconfig[KEY_SLEEP_TIMEOUT] = 17;
+    QFile tf(filename);
+    tf.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+    tf.write(QJsonDocument(appconfig).toJson());
+    tf.close();
+
+    config->update_configuration();
+    ASSERT_EQ(config->get_sleep_timeout(), std::chrono::minutes(17));
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, volumeChangeIsJournaled) {
+    QFile tf(filename);
+    tf.open(QIODevice::ReadOnly);
+    auto json_before = tf.readAll();
+    tf.close();
+
+    config->set_volume(42);
+    config->set_standby_brightness(7);
+    /* Destructor flushes pending settings */
+    config.reset();
+
+    tf.open(QIODevice::ReadOnly);
+    ASSERT_EQ(tf.readAll(), json_before);
+    tf.close();
+    ASSERT_TRUE(QFile::exists(filename + CONFIG_JOURNAL_SUFFIX));
+
+    Configuration control(filename, cache_dir);
+    control.update_configuration();
+    ASSERT_DOUBLE_EQ(control.get_volume(), 42);
+    ASSERT_EQ(control.get_standby_brightness(), 7);
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, journalReplaySkipsCorruptRecords) {
+    QFile journal(filename + CONFIG_JOURNAL_SUFFIX);
+    journal.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    journal.write("{\"volume\":12}\n");
+    journal.write("{\"sleepTimeout\":3}\n");
+    journal.write("{\"volume\":");
+    journal.close();
+
+    config->update_configuration();
+    ASSERT_DOUBLE_EQ(config->get_volume(), 12);
+    ASSERT_EQ(config->get_sleep_timeout(), std::chrono::minutes(3));
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, storeConfigCompactsJournal) {
+    QFile journal(filename + CONFIG_JOURNAL_SUFFIX);
+    journal.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    journal.write("{\"volume\":12}\n");
+    journal.close();
+    config->update_configuration();
+
+    config->store_current_config();
+    ASSERT_FALSE(journal.exists());
+
+    Configuration control(filename, cache_dir);
+    control.update_configuration();
+    ASSERT_DOUBLE_EQ(control.get_volume(), 12);
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, journalDiscardedIfConfigEdited) {
+    auto volume = config->get_volume();
+    QFile journal(filename + CONFIG_JOURNAL_SUFFIX);
+    journal.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    journal.write("{\"volume\":12}\n");
+    journal.close();
+
+    /* hand edit after the last journal record */
+    QFile tf(filename);
+    tf.open(QIODevice::ReadWrite);
+    tf.setFileTime(QDateTime::currentDateTime().addSecs(10),
+        QFileDevice::FileModificationTime);
+    tf.close();
+
+    config->update_configuration();
+    ASSERT_DOUBLE_EQ(config->get_volume(), volume);
+    ASSERT_FALSE(journal.exists());
+}
+
+/*****************************************************************************/
+TEST_F(ConfigurationFixture, journalAppendStartsOnNewLine) {
+    QFile journal(filename + CONFIG_JOURNAL_SUFFIX);
+    journal.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    journal.write("{\"sleepTimeout\":");
+    journal.close();
+
+    config->set_volume(42);
+    /* Destructor flushes pending settings */
+    config.reset();
+
+    Configuration control(filename, cache_dir);
+    control.update_configuration();
+    ASSERT_DOUBLE_EQ(control.get_volume(), 42);
+}
@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QSignalSpy>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "PlayableItem.hpp"
+#include "PodcastSource.hpp"
+#include "appconstants.hpp"
+#include "episode_downloader.hpp"
+
+using namespace DigitalRooster;
+
+/******************************************************************************/
+/**
+ * Serves one file over HTTP, answers Range requests with 206
+ */
+class RangeServer : public QTcpServer {
+public:
+    explicit RangeServer(const QByteArray& content)
+        : content(content) {
+        listen(QHostAddress::LocalHost);
+        connect(this, &QTcpServer::newConnection, this, [this]() {
+            auto socket = nextPendingConnection();
+            connect(socket, &QTcpSocket::readyRead, socket,
+                [this, socket]() { respond(socket); });
+        });
+    }
+
+    QUrl url() const {
+        return QUrl(
+            QString("http://127.0.0.1:%1/episode.mp3").arg(serverPort()));
+    }
+
+    /**
+     * Range header of last request
+     */
+    QByteArray last_range;
+
+private:
+    QByteArray content;
+    QByteArray request;
+
+    void respond(QTcpSocket* socket) {
+        request += socket->readAll();
+        if (!request.contains("\r\n\r\n")) {
+            return;
+        }
+        last_range.clear();
+        for (const auto& line : request.split('\n')) {
+            if (line.toLower().startsWith("range:")) {
+                last_range = line.mid(6).trimmed();
+            }
+        }
+        request.clear();
+        qint64 offset = 0;
+        if (last_range.startsWith("bytes=")) {
+            auto first = last_range.mid(6);
+            offset = first.left(first.indexOf('-')).toLongLong();
+        }
+        auto body = content.mid(offset);
+        QByteArray head = offset > 0 ? "HTTP/1.1 206 Partial Content\r\n"
+                                     : "HTTP/1.1 200 OK\r\n";
+        if (offset > 0) {
+            head += "Content-Range: bytes " + QByteArray::number(offset) +
+                "-" + QByteArray::number(content.size() - 1) + "/" +
+                QByteArray::number(content.size()) + "\r\n";
+        }
+        head += "Content-Length: " + QByteArray::number(body.size()) +
+            "\r\nConnection: close\r\n\r\n";
+        socket->write(head + body);
+        socket->disconnectFromHost();
+    }
+};
+
+/******************************************************************************/
+class EpisodeDownloaderFixture : public virtual ::testing::Test {
+public:
+    EpisodeDownloaderFixture()
+        : download_dir(QDir(DEFAULT_CACHE_DIR_PATH).filePath("test_episodes"))
+        , source(TEST_FILE_PATH + "/alternativlos.rss") {
+    }
+
+    void SetUp() {
+        download_dir.removeRecursively();
+    }
+
+    void TearDown() {
+        download_dir.removeRecursively();
+    }
+
+protected:
+    QDir download_dir;
+    QString source;
+
+    std::shared_ptr<PodcastEpisode> make_episode(
+        const QString& guid, const QUrl& url) {
+        auto episode = std::make_shared<PodcastEpisode>("Episode", url);
+        episode->set_guid(guid);
+        return episode;
+    }
+};
+
+/******************************************************************************/
+TEST_F(EpisodeDownloaderFixture, downloadsToLocalFile) {
+    EpisodeDownloader dut(download_dir.path());
+    QSignalSpy spy(&dut, SIGNAL(episode_downloaded(QString)));
+    dut.download(make_episode("guid-1", QUrl::fromLocalFile(source)));
+    ASSERT_TRUE(spy.wait(2000));
+    EXPECT_EQ(spy.takeFirst().at(0).toString(), QString("guid-1"));
+
+    EXPECT_TRUE(dut.is_downloaded("guid-1"));
+    auto local = dut.get_local_url("guid-1");
+    ASSERT_TRUE(local.isLocalFile());
+    EXPECT_EQ(QFileInfo(local.toLocalFile()).size(), QFileInfo(source).size());
+    EXPECT_EQ(dut.get_used_bytes(), QFileInfo(source).size());
+    EXPECT_TRUE(dut.get_local_url("guid-2").isEmpty());
+
+    /* completed downloads are found again after restart */
+    EpisodeDownloader restarted(download_dir.path());
+    EXPECT_TRUE(restarted.is_downloaded("guid-1"));
+}
+
+/******************************************************************************/
+TEST_F(EpisodeDownloaderFixture, latestEpisodesWithoutEpisodeObjects) {
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    ps.set_offline_episodes(2);
+    std::vector<EpisodeRecord> records;
+    for (int i = 0; i < 3; i++) {
+        EpisodeRecord record;
+        record.guid = QString("guid-%1").arg(i);
+        record.url = QUrl::fromLocalFile(source);
+        record.publication_date =
+            QDateTime::fromSecsSinceEpoch(1600000000).addDays(-i);
+        records.push_back(record);
+    }
+    ps.add_episode_records(records);
+
+    EpisodeDownloader dut(download_dir.path());
+    QSignalSpy spy(&dut, SIGNAL(episode_downloaded(QString)));
+    dut.download_latest(ps);
+    EXPECT_EQ(dut.get_queue_length(), 2);
+    for (int row = 0; row < ps.get_episode_count(); row++) {
+        EXPECT_FALSE(ps.get_episode_store().facade(row));
+    }
+    ASSERT_TRUE(spy.wait(2000));
+    ASSERT_TRUE(spy.count() > 1 || spy.wait(2000));
+    EXPECT_TRUE(dut.is_downloaded("guid-0"));
+    EXPECT_TRUE(dut.is_downloaded("guid-1"));
+    EXPECT_FALSE(dut.is_downloaded("guid-2"));
+}
+
+/******************************************************************************/
+TEST_F(EpisodeDownloaderFixture, quotaRemovesOldest) {
+    auto size = QFileInfo(source).size();
+    EpisodeDownloader dut(download_dir.path(), size + size / 2);
+    QSignalSpy spy(&dut, SIGNAL(episode_downloaded(QString)));
+    dut.download(make_episode("guid-1", QUrl::fromLocalFile(source)));
+    dut.download(make_episode("guid-2", QUrl::fromLocalFile(source)));
+    EXPECT_EQ(dut.get_queue_length(), 2);
+    ASSERT_TRUE(spy.wait(2000));
+    ASSERT_TRUE(spy.count() > 1 || spy.wait(2000));
+
+    EXPECT_FALSE(dut.is_downloaded("guid-1"));
+    EXPECT_TRUE(dut.is_downloaded("guid-2"));
+    EXPECT_EQ(dut.get_used_bytes(), size);
+}
+
+/******************************************************************************/
+TEST_F(EpisodeDownloaderFixture, resumesPartialDownloadWithRange) {
+    QFile file(source);
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    auto content = file.readAll();
+    RangeServer server(content);
+
+    /* first half from an interrupted download */
+    download_dir.mkpath(".");
+    QFile part(download_dir.filePath(
+        EpisodeDownloader::file_key("guid-1") + ".part"));
+    ASSERT_TRUE(part.open(QIODevice::WriteOnly));
+    part.write(content.left(content.size() / 2));
+    part.close();
+
+    EpisodeDownloader dut(download_dir.path());
+    QSignalSpy spy(&dut, SIGNAL(episode_downloaded(QString)));
+    dut.download(make_episode("guid-1", server.url()));
+    ASSERT_TRUE(spy.wait(2000));
+
+    EXPECT_EQ(server.last_range,
+        "bytes=" + QByteArray::number(content.size() / 2) + "-");
+    QFile downloaded(dut.get_local_url("guid-1").toLocalFile());
+    ASSERT_TRUE(downloaded.open(QIODevice::ReadOnly));
+    EXPECT_EQ(downloaded.readAll(), content);
+    EXPECT_FALSE(part.exists());
+}
+
+/******************************************************************************/
+TEST_F(EpisodeDownloaderFixture, latestEpisodesLargerThanQuota) {
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    ps.set_offline_episodes(3);
+    std::vector<EpisodeRecord> records;
+    for (int i = 0; i < 3; i++) {
+        EpisodeRecord record;
+        record.guid = QString("guid-%1").arg(i);
+        record.url = QUrl::fromLocalFile(source);
+        record.publication_date =
+            QDateTime::fromSecsSinceEpoch(1600000000).addDays(-i);
+        records.push_back(record);
+    }
+    ps.add_episode_records(records);
+
+    /* room for only one of the latest episodes */
+    auto size = QFileInfo(source).size();
+    EpisodeDownloader dut(download_dir.path(), size + size / 2);
+    QSignalSpy downloaded(&dut, SIGNAL(episode_downloaded(QString)));
+    QSignalSpy failed(&dut, SIGNAL(download_failed(QString)));
+    dut.download_latest(ps);
+    ASSERT_TRUE(downloaded.wait(2000));
+    ASSERT_TRUE(failed.count() > 1 || failed.wait(2000));
+    ASSERT_TRUE(failed.count() > 1 || failed.wait(2000));
+    EXPECT_EQ(dut.get_queue_length(), 0);
+
+    /* the downloaded latest episode is not removed for the others */
+    EXPECT_TRUE(dut.is_downloaded("guid-0"));
+    EXPECT_FALSE(dut.is_downloaded("guid-1"));
+    EXPECT_FALSE(dut.is_downloaded("guid-2"));
+    EXPECT_EQ(dut.get_used_bytes(), size);
+
+    /* the next feed refresh does not download them again */
+    dut.download_latest(ps);
+    EXPECT_EQ(dut.get_queue_length(), 0);
+    EXPECT_TRUE(dut.is_downloaded("guid-0"));
+}
@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QFile>
+#include <QSet>
+#include <QSignalSpy>
+#include <QString>
+#include <QUrl>
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "PlayableItem.hpp"
+#include "PodcastSource.hpp"
+#include "episode_store.hpp"
+#include "rss2podcastsource.hpp"
+#include "string_pool.hpp"
+#include "util.hpp"
+
+using namespace DigitalRooster;
+
+/******************************************************************************/
+static EpisodeRecord make_record(int i) {
+    EpisodeRecord record;
+    record.title = QString("Episode %1").arg(i);
+    record.publisher = QString("Publisher");
+    record.guid = QString("guid-%1").arg(i);
+    record.url = QUrl(QString("http://some.url/%1.mp3").arg(i));
+    record.publication_date =
+        QDateTime::fromSecsSinceEpoch(1000000000LL + i * 3600LL);
+    record.duration = 3600000;
+    record.description = QString("<p>Description of episode %1</p>").arg(i);
+    return record;
+}
+
+/******************************************************************************/
+TEST(EpisodeStore, mergeSortsAndSkipsKnown) {
+    EpisodeStore store;
+    auto result = store.merge({make_record(1), make_record(3)}, 10);
+    ASSERT_EQ(result.inserted.size(), 2U);
+    EXPECT_EQ(result.removed, 0);
+
+    /* unsorted, one known and one duplicate in the batch */
+    result = store.merge(
+        {make_record(2), make_record(3), make_record(4), make_record(2)}, 10);
+    ASSERT_EQ(result.inserted.size(), 2U);
+    EXPECT_EQ(result.inserted[0], QString("guid-4"));
+    EXPECT_EQ(result.inserted[1], QString("guid-2"));
+    ASSERT_EQ(store.size(), 4);
+    EXPECT_EQ(store.guid(0), QString("guid-4"));
+    EXPECT_EQ(store.guid(1), QString("guid-3"));
+    EXPECT_EQ(store.guid(2), QString("guid-2"));
+    EXPECT_EQ(store.guid(3), QString("guid-1"));
+    EXPECT_EQ(store.row_of("guid-2"), 2);
+    EXPECT_EQ(store.row_of("unknown"), -1);
+    EXPECT_EQ(store.display_name(0), QString("Publisher: Episode 4"));
+}
+
+/******************************************************************************/
+TEST(EpisodeStore, mergeDropsOldestAndReusesSlots) {
+    EpisodeStore store;
+    store.merge({make_record(1), make_record(2), make_record(3)}, 3);
+    auto result = store.merge({make_record(0), make_record(5)}, 3);
+    /* episode 0 is older than all kept episodes */
+    ASSERT_EQ(result.inserted.size(), 1U);
+    EXPECT_EQ(result.removed, 1);
+    ASSERT_EQ(store.size(), 3);
+    EXPECT_FALSE(store.contains("guid-1"));
+    EXPECT_FALSE(store.contains("guid-0"));
+    EXPECT_EQ(store.guid(0), QString("guid-5"));
+    EXPECT_EQ(store.title(2), QString("Episode 2"));
+    /* row index follows inserts, drops and reused slots */
+    for (int row = 0; row < store.size(); row++) {
+        EXPECT_EQ(store.row_of(store.guid(row)), row);
+    }
+    EXPECT_EQ(store.row_of("guid-1"), -1);
+
+    store.clear();
+    EXPECT_EQ(store.size(), 0);
+    EXPECT_FALSE(store.contains("guid-5"));
+}
+
+/******************************************************************************/
+TEST(EpisodeStore, missingGuidUsesUrl) {
+    EpisodeStore store;
+    auto record = make_record(1);
+    record.guid.clear();
+    store.merge({record}, 10);
+    EXPECT_TRUE(store.contains("http://some.url/1.mp3"));
+}
+
+/******************************************************************************/
+TEST(EpisodeStore, facadeWritesBack) {
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    QSignalSpy spy(&ps, SIGNAL(dataChanged()));
+    ps.add_episode_records({make_record(1), make_record(2)});
+    const auto& store = ps.get_episode_store();
+    ASSERT_EQ(store.size(), 2);
+    /* no QObject until somebody asks for one */
+    EXPECT_FALSE(store.facade(0));
+
+    auto ep = ps.get_episode(1);
+    ASSERT_TRUE(ep);
+    EXPECT_EQ(ep->get_guid(), QString("guid-1"));
+    EXPECT_EQ(ep->get_description(), store.description(1));
+    EXPECT_EQ(ps.get_episode_by_id("guid-1"), ep);
+    EXPECT_FALSE(store.listened(1));
+
+    ep->set_position(1800000);
+    EXPECT_EQ(store.position(1), 1800000);
+    EXPECT_TRUE(store.listened(1));
+    /* position alone is no reason to write the cache */
+    EXPECT_EQ(spy.count(), 0);
+    ep->set_title("New Title");
+    EXPECT_EQ(store.title(1), QString("New Title"));
+    EXPECT_EQ(spy.count(), 1);
+
+    /* values survive the QObject */
+    ep.reset();
+    EXPECT_FALSE(store.facade(1));
+    EXPECT_EQ(ps.get_episode(1)->get_position(), 1800000);
+    EXPECT_FALSE(ps.get_episode(2));
+}
+
+/******************************************************************************/
+TEST(StringPool, internSharesBuffer) {
+    StringPool pool;
+    auto first = pool.intern(QString("Publisher"));
+    auto second = pool.intern(QString("Pub") + QString("lisher"));
+    EXPECT_EQ(first.constData(), second.constData());
+    EXPECT_EQ(pool.size(), 1);
+    EXPECT_TRUE(pool.intern(QString()).isNull());
+    EXPECT_EQ(pool.size(), 1);
+
+    /* only referenced by the pool after the values are gone */
+    pool.intern(QString("other"));
+    first.clear();
+    pool.prune();
+    EXPECT_EQ(pool.size(), 2);
+    second.clear();
+    pool.prune();
+    EXPECT_EQ(pool.size(), 0);
+}
+
+/******************************************************************************/
+TEST(EpisodeStore, memoryAccountingFeed) {
+    QFile file(TEST_FILE_PATH + "/alternativlos.rss");
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    PodcastSource ps(QUrl("http://alternativlos.org/alternativlos.rss"));
+    update_podcast(ps, file.readAll());
+    const auto& store = ps.get_episode_store();
+    ASSERT_GT(store.size(), 1);
+
+    /* all episodes share publisher and media URL directory */
+    QSet<const QChar*> publisher_buffers;
+    for (int row = 0; row < store.size(); row++) {
+        publisher_buffers.insert(store.publisher(row).constData());
+    }
+    EXPECT_EQ(publisher_buffers.size(), 1);
+    EXPECT_EQ(store.url(0).toString(),
+        QString("http://alternativlos.cdn.as250.net/alternativlos-41.mp3"));
+
+    auto usage = store.string_usage();
+    EXPECT_LT(usage.stored, usage.unshared);
+
+    /* pool holds each distinct interned value once, nothing else */
+    auto interned_values = [&store]() {
+        QSet<QString> values;
+        for (int row = 0; row < store.size(); row++) {
+            auto url = store.url(row).toString();
+            values << store.publisher(row)
+                   << url.left(url_file_name_start(url))
+                   << store.description(row) << store.summary(row);
+        }
+        values.remove(QString());
+        return values.size();
+    };
+    EXPECT_EQ(store.pooled_strings(), interned_values());
+    EXPECT_LT(store.pooled_strings(), 4 * store.size());
+
+    /* replaced values are released from the pool right away */
+    ps.get_episode(0)->set_description("<p>new description</p>");
+    EXPECT_EQ(store.pooled_strings(), interned_values());
+
+    /* as are values of dropped episodes */
+    ps.set_max_episodes(store.size());
+    ps.add_episode_records({make_record(1000000)});
+    EXPECT_EQ(store.row_of("guid-1000000"), 0);
+    EXPECT_EQ(store.pooled_strings(), interned_values());
+}
+
+/******************************************************************************/
+TEST(EpisodeStore, summaryOfDescription) {
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    auto record = make_record(1);
+    record.description = "<p>Hello <b>World</b></p>\n  more <br/>text";
+    auto long_record = make_record(2);
+    long_record.description = QString("<p>%1</p>").arg(QString(500, 'x'));
+    ps.add_episode_records({record, long_record});
+    const auto& store = ps.get_episode_store();
+    EXPECT_EQ(store.summary(1), QString("Hello World more text"));
+    EXPECT_EQ(store.summary(0).size(), DESCRIPTION_SUMMARY_LENGTH + 3);
+
+    /* position updates keep the summary, a new description replaces it */
+    auto ep = ps.get_episode(1);
+    ep->set_position(1000);
+    EXPECT_EQ(store.summary(1), QString("Hello World more text"));
+    ep->set_description("<i>changed</i>");
+    EXPECT_EQ(store.summary(1), QString("changed"));
+    EXPECT_EQ(store.description(1), QString("<i>changed</i>"));
+}
+
+/******************************************************************************/
+TEST(EpisodeStore, scrollingDecodesNoDescriptions) {
+    const int count = 200;
+    std::vector<EpisodeRecord> records;
+    for (int i = 0; i < count; i++) {
+        auto record = make_record(i);
+        /* provided by parser and cache */
+        record.summary = QString("Description of episode %1").arg(i);
+        records.push_back(record);
+    }
+    EpisodeStore store;
+    store.merge(std::move(records), count);
+
+    /* roles requested by a delegate scrolled into view */
+    auto scroll = [&store]() {
+        for (int row = 0; row < store.size(); row++) {
+            EXPECT_FALSE(store.display_name(row).isEmpty());
+            EXPECT_FALSE(store.summary(row).isEmpty());
+            EXPECT_TRUE(store.publication_date(row).isValid());
+        }
+    };
+    scroll();
+    EXPECT_EQ(store.decoded_descriptions(), 0U);
+
+    /* episodes added as objects have no summary, each description is
+     * summarized once when it is displayed first */
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    auto ep = std::make_shared<PodcastEpisode>(
+        "Episode", QUrl("http://some.url/1.mp3"));
+    ep->set_guid("guid-1");
+    ep->set_description("<p>Hello <b>World</b></p>");
+    ps.add_episode(ep);
+    const auto& ps_store = ps.get_episode_store();
+    EXPECT_EQ(ps_store.decoded_descriptions(), 0U);
+    EXPECT_EQ(ps_store.summary(0), QString("Hello World"));
+    EXPECT_EQ(ps_store.summary(0), QString("Hello World"));
+    EXPECT_EQ(ps_store.decoded_descriptions(), 1U);
+}
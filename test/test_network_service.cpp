@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QSignalSpy>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "appconstants.hpp"
+#include "httpclient.hpp"
+#include "network_service.hpp"
+
+using namespace DigitalRooster;
+
+/******************************************************************************/
+/**
+ * Restores the state of the process wide service after each test
+ */
+class NetworkServiceFixture : public virtual ::testing::Test {
+public:
+    void TearDown() {
+        service->playback_state_changed(QMediaPlayer::StoppedState);
+        service->set_background_limit(HTTP_BACKGROUND_LIMIT_PLAYING);
+        service->set_background_read_interval(HTTP_BACKGROUND_READ_INTERVAL);
+        service->set_circuit_breaker(
+            HTTP_CIRCUIT_FAILURES, HTTP_CIRCUIT_OPEN_TIME);
+        for (const auto& host : hosts) {
+            service->report_result(host, false);
+        }
+    }
+
+protected:
+    NetworkService* service = NetworkService::get_instance();
+    /**
+     * Circuits of these hosts are closed after the test
+     */
+    QStringList hosts;
+};
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, clientsShareOneService) {
+    auto url = QUrl::fromLocalFile(TEST_FILE_PATH + "/alternativlos.rss");
+    auto before = service->get_host_statistics().value(url.host());
+
+    HttpClient first;
+    HttpClient second;
+    QSignalSpy spy_first(&first, SIGNAL(dataAvailable(QByteArray)));
+    QSignalSpy spy_second(&second, SIGNAL(dataAvailable(QByteArray)));
+    first.doDownload(url);
+    second.doDownload(url);
+    ASSERT_TRUE(spy_first.count() > 0 || spy_first.wait(1000));
+    ASSERT_TRUE(spy_second.count() > 0 || spy_second.wait(1000));
+
+    auto size = QFileInfo(url.toLocalFile()).size();
+    EXPECT_EQ(spy_first.takeFirst().at(0).toByteArray().size(), size);
+    auto after = service->get_host_statistics().value(url.host());
+    EXPECT_EQ(after.requests, before.requests + 2);
+    EXPECT_EQ(after.errors, before.errors);
+    EXPECT_GT(after.bytes_received, before.bytes_received);
+    EXPECT_GE(service->get_total_statistics().requests, after.requests);
+}
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, abortedClientIgnoresReply) {
+    auto url = QUrl::fromLocalFile(TEST_FILE_PATH + "/alternativlos.rss");
+    HttpClient client;
+    QSignalSpy spy(&client, SIGNAL(dataAvailable(QByteArray)));
+    client.doDownload(url);
+    EXPECT_TRUE(client.is_busy());
+    client.abort();
+    EXPECT_FALSE(client.is_busy());
+    EXPECT_FALSE(spy.wait(200));
+}
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, stalledServerTimesOutAndRetries) {
+    /* accepts connections but never answers */
+    QTcpServer server;
+    ASSERT_TRUE(server.listen(QHostAddress::LocalHost));
+    QUrl url(QString("http://127.0.0.1:%1/feed.rss").arg(server.serverPort()));
+    hosts << url.host();
+    auto before = service->get_host_statistics().value(url.host());
+
+    HttpClient client;
+    client.set_streaming(true);
+    client.set_timeouts(
+        std::chrono::milliseconds(100), std::chrono::milliseconds(100));
+    client.set_retries(1, std::chrono::milliseconds(50));
+    QSignalSpy spy(&client, SIGNAL(streamFinished(bool)));
+    client.doDownload(url);
+    ASSERT_TRUE(spy.wait(2000));
+    EXPECT_FALSE(spy.takeFirst().at(0).toBool());
+    EXPECT_FALSE(client.is_busy());
+
+    auto after = service->get_host_statistics().value(url.host());
+    EXPECT_EQ(after.requests, before.requests + 2);
+    EXPECT_EQ(after.timeouts, before.timeouts + 2);
+    EXPECT_EQ(after.retries, before.retries + 1);
+}
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, circuitBreakerOpensAfterFailures) {
+    QString host("dead.host.invalid");
+    hosts << host;
+    service->set_circuit_breaker(2, std::chrono::milliseconds(100));
+
+    service->report_result(host, true);
+    EXPECT_TRUE(service->allow_request(host));
+    service->report_result(host, true);
+    EXPECT_TRUE(service->is_circuit_open(host));
+    EXPECT_FALSE(service->allow_request(host));
+    EXPECT_EQ(service->get_host_statistics().value(host).circuits_opened, 1);
+    EXPECT_EQ(service->get_host_statistics().value(host).rejected, 1);
+
+    /* a success closes the circuit again */
+    service->report_result(host, false);
+    EXPECT_FALSE(service->is_circuit_open(host));
+}
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, openCircuitFailsWithoutRequest) {
+    QUrl url("http://unreachable.host.invalid/feed.rss");
+    hosts << url.host();
+    service->set_circuit_breaker(1, std::chrono::milliseconds(10000));
+    service->report_result(url.host(), true);
+    auto before = service->get_host_statistics().value(url.host());
+
+    HttpClient client;
+    client.set_streaming(true);
+    QSignalSpy spy(&client, SIGNAL(streamFinished(bool)));
+    QSignalSpy spy_failed(&client, SIGNAL(downloadFailed()));
+    client.doDownload(url);
+    EXPECT_TRUE(client.is_busy());
+    ASSERT_TRUE(spy.wait(500));
+    EXPECT_FALSE(spy.takeFirst().at(0).toBool());
+    EXPECT_EQ(spy_failed.count(), 1);
+
+    /* clients without streaming are notified too */
+    HttpClient plain;
+    QSignalSpy spy_plain(&plain, SIGNAL(downloadFailed()));
+    QSignalSpy spy_data(&plain, SIGNAL(dataAvailable(QByteArray)));
+    plain.doDownload(url);
+    ASSERT_TRUE(spy_plain.wait(500));
+    EXPECT_EQ(spy_data.count(), 0);
+    EXPECT_FALSE(plain.is_busy());
+
+    auto after = service->get_host_statistics().value(url.host());
+    EXPECT_EQ(after.requests, before.requests);
+    EXPECT_EQ(after.rejected, before.rejected + 2);
+}
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, halfOpenCircuitAllowsSingleProbe) {
+    QString host("flaky.host.invalid");
+    hosts << host;
+    const std::chrono::milliseconds open_time(50);
+    service->set_circuit_breaker(1, open_time);
+    service->report_result(host, true);
+    EXPECT_FALSE(service->allow_request(host));
+
+    /* one probe after the open time, others wait for its result */
+    std::this_thread::sleep_for(2 * open_time);
+    EXPECT_TRUE(service->allow_request(host));
+    EXPECT_TRUE(service->is_circuit_open(host));
+    EXPECT_FALSE(service->allow_request(host));
+
+    /* a failed probe opens the circuit again */
+    service->report_result(host, true);
+    EXPECT_FALSE(service->allow_request(host));
+    EXPECT_EQ(service->get_host_statistics().value(host).circuits_opened, 2);
+
+    /* a successful probe closes it */
+    std::this_thread::sleep_for(2 * open_time);
+    EXPECT_TRUE(service->allow_request(host));
+    service->report_result(host, false);
+    EXPECT_TRUE(service->allow_request(host));
+    EXPECT_TRUE(service->allow_request(host));
+}
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, backgroundWaitsDuringPlayback) {
+    auto url = QUrl::fromLocalFile(TEST_FILE_PATH + "/alternativlos.rss");
+    service->set_background_limit(0);
+    service->playback_state_changed(QMediaPlayer::PlayingState);
+
+    HttpClient background;
+    background.set_priority(RequestPriority::Background);
+    HttpClient normal;
+    QSignalSpy spy_background(&background, SIGNAL(dataAvailable(QByteArray)));
+    QSignalSpy spy_normal(&normal, SIGNAL(dataAvailable(QByteArray)));
+    background.doDownload(url);
+    normal.doDownload(url);
+    EXPECT_EQ(service->get_queue_length(), 1);
+    ASSERT_TRUE(spy_normal.wait(1000));
+    EXPECT_EQ(spy_background.count(), 0);
+    EXPECT_TRUE(background.is_busy());
+
+    /* queued download starts when playback stops */
+    service->playback_state_changed(QMediaPlayer::StoppedState);
+    EXPECT_EQ(service->get_queue_length(), 0);
+    ASSERT_TRUE(spy_background.count() > 0 || spy_background.wait(1000));
+}
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, abortRemovesQueuedRequest) {
+    auto url = QUrl::fromLocalFile(TEST_FILE_PATH + "/alternativlos.rss");
+    service->set_background_limit(0);
+    service->playback_state_changed(QMediaPlayer::PlayingState);
+
+    HttpClient background;
+    background.set_priority(RequestPriority::Background);
+    background.doDownload(url);
+    EXPECT_EQ(service->get_queue_length(), 1);
+    background.abort();
+    EXPECT_EQ(service->get_queue_length(), 0);
+    EXPECT_FALSE(background.is_busy());
+}
+
+/******************************************************************************/
+TEST_F(NetworkServiceFixture, runningBackgroundStreamIsPacedDuringPlayback) {
+    /* answers every request with 4 chunks of content */
+    const int content_size = static_cast<int>(4 * RSS_STREAM_CHUNK_SIZE);
+    QTcpServer server;
+    ASSERT_TRUE(server.listen(QHostAddress::LocalHost));
+    QObject::connect(&server, &QTcpServer::newConnection, [&server]() {
+        auto socket = server.nextPendingConnection();
+        QObject::connect(socket, &QTcpSocket::readyRead, [socket]() {
+            socket->readAll();
+            socket->write("HTTP/1.0 200 OK\r\nContent-Length: " +
+                QByteArray::number(content_size) + "\r\n\r\n");
+            socket->write(QByteArray(content_size, 'x'));
+            socket->disconnectFromHost();
+        });
+    });
+    QUrl url(
+        QString("http://127.0.0.1:%1/episode.mp3").arg(server.serverPort()));
+    hosts << url.host();
+    const std::chrono::milliseconds interval(100);
+    service->set_background_read_interval(interval);
+    service->playback_state_changed(QMediaPlayer::PlayingState);
+
+    HttpClient client;
+    client.set_streaming(true);
+    client.set_priority(RequestPriority::Background);
+    QSignalSpy spy_chunks(&client, SIGNAL(chunkAvailable(QByteArray)));
+    QSignalSpy spy_finished(&client, SIGNAL(streamFinished(bool)));
+    QElapsedTimer elapsed;
+    elapsed.start();
+    client.doDownload(url);
+    ASSERT_TRUE(spy_finished.wait(5000));
+    EXPECT_TRUE(spy_finished.takeFirst().at(0).toBool());
+    qint64 received = 0;
+    for (const auto& args : spy_chunks) {
+        received += args.at(0).toByteArray().size();
+    }
+    EXPECT_EQ(received, content_size);
+    /* at most one chunk per interval, the last is read when finished */
+    EXPECT_GE(elapsed.elapsed(), 3 * interval.count());
+}
@@ -5,10 +5,12 @@
  */
 
 #include <QDir>
+#include <QtConcurrent>
 #include <gtest/gtest.h>
 
 #include "appconstants.hpp"
 #include "rss2podcastsource.hpp"
+#include "util.hpp"
 
 using namespace DigitalRooster;
 
@@ -140,6 +142,146 @@ TEST_F(PodcastReaderFixture, parseInfo_bad_malformatted) {
     EXPECT_NO_THROW(update_podcast(ps, file.readAll()));
 }
 
+/******************************************************************************/
+TEST_F(PodcastReaderFixture, truncatedDocumentFails) {
+    auto data = file.readAll();
+    ASSERT_TRUE(update_podcast(ps, data));
+    ASSERT_FALSE(update_podcast(ps, data.left(data.size() / 2)));
+}
+
+/******************************************************************************/
+TEST_F(PodcastReaderFixture, streamInSmallChunks) {
+    auto data = file.readAll();
+    PodcastSource reference(
+        QUrl("https://alternativlos.org/alternativlos.rss"));
+    update_podcast(reference, data);
+
+    RssStreamParser parser(ps);
+    const int chunk_size = 97; // split elements and multibyte characters
+    int half_way_count = 0;
+    for (int pos = 0; pos < data.size(); pos += chunk_size) {
+        parser.add_data(data.mid(pos, chunk_size));
+        apply_feed_update(ps, parser.take_update());
+        if (half_way_count == 0 && pos > data.size() / 2) {
+            half_way_count = ps.get_episode_count();
+        }
+    }
+    /* episodes were available while document was incomplete */
+    ASSERT_GT(half_way_count, 0);
+    ASSERT_TRUE(parser.finish());
+    apply_feed_update(ps, parser.take_update());
+    ASSERT_EQ(ps.get_title(), reference.get_title());
+    ASSERT_EQ(ps.get_description(), reference.get_description());
+    ASSERT_EQ(ps.get_episode_count(), reference.get_episode_count());
+    for (int i = 0; i < ps.get_episode_count(); i++) {
+        EXPECT_EQ(ps.get_episodes()[i]->get_guid(),
+            reference.get_episodes()[i]->get_guid());
+        EXPECT_EQ(ps.get_episodes()[i]->get_duration(),
+            reference.get_episodes()[i]->get_duration());
+    }
+}
+
+/******************************************************************************/
+TEST_F(PodcastReaderFixture, streamIncompleteDocument) {
+    auto data = file.readAll();
+    RssStreamParser parser(ps);
+    parser.add_data(data.left(data.size() / 2));
+    ASSERT_FALSE(parser.has_error());
+    apply_feed_update(ps, parser.take_update());
+    ASSERT_GT(ps.get_episode_count(), 0);
+    ASSERT_FALSE(parser.finish());
+}
+
+/******************************************************************************/
+TEST_F(PodcastReaderFixture, parseOnWorkerPool) {
+    auto data = file.readAll();
+    RssStreamParser parser(ps);
+    QtConcurrent::run(&worker_pool(), [&]() { parser.add_data(data); })
+        .waitForFinished();
+    /* podcast source is only changed when the update is applied */
+    ASSERT_EQ(ps.get_episode_count(), 0);
+    ASSERT_TRUE(ps.get_title().isEmpty());
+    ASSERT_TRUE(parser.finish());
+    auto update = parser.take_update();
+    auto items = static_cast<int>(update.items.size());
+    ASSERT_GT(items, 0);
+    apply_feed_update(ps, std::move(update));
+    ASSERT_EQ(ps.get_episode_count(), items);
+    ASSERT_EQ(ps.get_title(), "Alternativlos");
+    /* update was taken, nothing left to apply */
+    ASSERT_TRUE(parser.take_update().items.empty());
+}
+
+/******************************************************************************/
+TEST_F(PodcastReaderFixture, refreshSkipsKnownItems) {
+    auto data = file.readAll();
+    RssStreamParser first(ps);
+    first.add_data(data);
+    ASSERT_TRUE(first.finish());
+    ASSERT_EQ(first.get_skipped_items(), 0);
+    apply_feed_update(ps, first.take_update());
+    auto count = ps.get_episode_count();
+
+    RssStreamParser refresh(ps);
+    refresh.add_data(data);
+    ASSERT_TRUE(refresh.finish());
+    ASSERT_EQ(refresh.get_skipped_items(), count);
+    apply_feed_update(ps, refresh.take_update());
+    ASSERT_EQ(ps.get_episode_count(), count);
+}
+
+/******************************************************************************/
+TEST_F(PodcastReaderFixture, stopAfterRetentionWindow) {
+    ps.set_max_episodes(5);
+    auto data = file.readAll();
+    RssStreamParser parser(ps);
+    parser.add_data(data);
+    ASSERT_TRUE(parser.stopped_early());
+    /* only the first item outside the window was looked at */
+    ASSERT_EQ(parser.get_skipped_items(), 0);
+    ASSERT_TRUE(parser.finish());
+    apply_feed_update(ps, parser.take_update());
+    ASSERT_EQ(ps.get_episode_count(), 5);
+    EXPECT_EQ(ps.get_episodes()[1]->get_url().toString(),
+        QString("http://alternativlos.cdn.as250.net/alternativlos-40.mp3"));
+}
+
+/******************************************************************************/
+TEST(PodcastReader, unchangedLargeFeedStopsEarly) {
+    /* 1000 items newest first */
+    QByteArray feed(R"(<?xml version="1.0" encoding="UTF-8"?>)"
+                    "<rss version=\"2.0\"><channel><title>Large</title>");
+    auto newest = QDateTime::fromString("2020-01-01T00:00:00", Qt::ISODate);
+    for (int i = 0; i < 1000; i++) {
+        auto pub = newest.addDays(-i).toString(Qt::RFC2822Date);
+        feed.append(QString("<item><title>Episode %1</title>"
+                            "<description>Some text</description>"
+                            "<enclosure url=\"http://some.url/%1.mp3\"/>"
+                            "<guid>guid-%1</guid><pubDate>%2</pubDate></item>")
+                        .arg(i)
+                        .arg(pub)
+                        .toUtf8());
+    }
+    feed.append("</channel></rss>");
+
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    ps.set_max_episodes(100);
+    RssStreamParser first(ps);
+    first.add_data(feed);
+    ASSERT_TRUE(first.finish());
+    apply_feed_update(ps, first.take_update());
+    ASSERT_EQ(ps.get_episode_count(), 100);
+
+    RssStreamParser refresh(ps);
+    refresh.add_data(feed);
+    ASSERT_TRUE(refresh.stopped_early());
+    ASSERT_TRUE(refresh.finish());
+    /* all kept episodes were known, nothing allocated */
+    ASSERT_EQ(refresh.get_skipped_items(), 100);
+    apply_feed_update(ps, refresh.take_update());
+    ASSERT_EQ(ps.get_episode_count(), 100);
+}
+
 /******************************************************************************/
 TEST_F(PodcastReaderFixture, parseInfo_bad_missing_title) {
     QFile file_bad(TEST_FILE_PATH + "/alternativlos_bad.rss");
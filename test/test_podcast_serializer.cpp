@@ -4,7 +4,10 @@
  * Licensed under GNU PUBLIC LICENSE Version 3 or later
  */
 
+#include <QBuffer>
 #include <QDateTime>
+#include <QFileInfo>
+#include <QImage>
 #include <QSignalSpy>
 #include <QUrl>
 #include <QUuid>
@@ -19,7 +22,9 @@
 #include "appconstants.hpp"
 #include "mock_clock.hpp"
 #include "podcast_serializer.hpp"
+#include "rss2podcastsource.hpp"
 #include "serializer_mock.hpp"
+#include "util.hpp"
 
 using namespace DigitalRooster;
 using namespace ::testing;
@@ -43,14 +48,6 @@ public:
     };
 };
 
-/******************************************************************************/
-class PodcastSourceMock_episodes : public PodcastSourceMock {
-public:
-    explicit PodcastSourceMock_episodes(){};
-    MOCK_CONST_METHOD0(get_episodes_impl,
-        const std::vector<std::shared_ptr<PodcastEpisode>>&());
-};
-
 /******************************************************************************/
 class SerializerFixture : public ::testing::Test {
 public:
@@ -194,6 +191,52 @@ TEST_F(SerializerFixture, PodcastSourceFromJson_PsRecentlyUpdated) {
     ASSERT_EQ(psmock.get_episode_count(), 0); // nothing added
 }
 
+/******************************************************************************/
+TEST_F(SerializerFixture, httpValidatorsRoundTrip) {
+    EXPECT_CALL(*(mc.get()), get_time())
+        .Times(1)
+        .WillOnce(Return(expected_timestamp));
+    ps.set_http_validators(
+        "\"abc123\"", "Wed, 21 Oct 2015 07:28:00 GMT");
+    auto json_obj = json_from_podcast_source(&ps);
+    ASSERT_EQ(json_obj[KEY_HTTP_ETAG].toString(), QString("\"abc123\""));
+    ASSERT_EQ(json_obj[KEY_HTTP_LAST_MODIFIED].toString(),
+        QString("Wed, 21 Oct 2015 07:28:00 GMT"));
+
+    PodcastSource restored(QUrl("http://some.url"));
+    parse_podcast_source_from_json(json_obj, &restored);
+    ASSERT_EQ(restored.get_http_etag(), ps.get_http_etag());
+    ASSERT_EQ(
+        restored.get_http_last_modified(), ps.get_http_last_modified());
+}
+
+/******************************************************************************/
+TEST_F(SerializerFixture, learnedIntervalRoundTrip) {
+    EXPECT_CALL(*(mc.get()), get_time())
+        .Times(1)
+        .WillOnce(Return(expected_timestamp));
+    ps.set_learned_update_interval(std::chrono::seconds(7200), 3);
+    auto json_obj = json_from_podcast_source(&ps);
+
+    PodcastSource restored(QUrl("http://some.url"));
+    parse_podcast_source_from_json(json_obj, &restored);
+    ASSERT_EQ(restored.get_learned_update_interval(),
+        std::chrono::seconds(7200));
+    ASSERT_EQ(restored.get_unchanged_refreshes(), 3);
+}
+
+/******************************************************************************/
+TEST_F(SerializerFixture, httpValidatorsDroppedWithoutEpisodes) {
+    QJsonObject json_ps;
+    json_ps[KEY_TIMESTAMP] = expected_timestamp.toString(Qt::ISODate);
+    json_ps[KEY_HTTP_ETAG] = QString("\"abc123\"");
+    parse_podcast_source_from_json(json_ps, &ps);
+    ASSERT_FALSE(ps.get_http_etag().isEmpty());
+    /* Cache without episodes - next update must download the feed */
+    read_episodes_cache(json_ps, &ps);
+    ASSERT_TRUE(ps.get_http_etag().isEmpty());
+}
+
 /******************************************************************************/
 TEST_F(SerializerFixture, PodcastSourceFromJson_Add2Episodes) {
     QDateTime invalid_date;
@@ -329,7 +372,7 @@ TEST_F(SerializerFixture, readFromFile) {
 
 /******************************************************************************/
 TEST_F(SerializerFixture, fullRoundTrip) {
-    PodcastSourceMock_episodes psmock_episodes;
+    PodcastSourceMock psmock_episodes;
     QString test_file_name("FullRoundTrip_test_file.json");
     std::vector<std::shared_ptr<PodcastEpisode>> ep_vec;
     for (int i = 0; i < 3; i++) {
@@ -353,9 +396,8 @@ TEST_F(SerializerFixture, fullRoundTrip) {
     EXPECT_CALL(psmock_episodes, get_image_url())
         .Times(1)
         .WillOnce(ReturnRef(expected_image_url));
-    EXPECT_CALL(psmock_episodes, get_episodes_impl())
-        .Times(1)
-        .WillOnce(ReturnRef(ep_vec));
+    /* cache is written from the episode store, no QObjects needed */
+    psmock_episodes.add_episodes(ep_vec);
 
     /* Emulated passing of time */
     EXPECT_CALL(*(mc.get()), get_time())
@@ -373,6 +415,163 @@ TEST_F(SerializerFixture, fullRoundTrip) {
         QString("Title_1"));
 }
 
+/******************************************************************************/
+TEST_F(SerializerFixture, writeOnWorkerPool) {
+    EXPECT_CALL(*(mc.get()), get_time())
+        .WillRepeatedly(Return(expected_timestamp));
+    PodcastSource source(QUrl("http://some.url/feed.rss"));
+    source.set_title(expected_title);
+    auto cache_file = cache_dir.filePath(source.get_id_string());
+    QFile::remove(cache_file);
+
+    auto serializer = std::make_unique<PodcastSerializer>(cache_dir, &source);
+    serializer->write();
+    serializer->write(); // must not be overtaken by the first write
+    /* destructor does not wait, writes finish on the pool */
+    serializer.reset();
+    worker_pool().waitForDone();
+
+    PodcastSource restored(QUrl("http://some.url/feed.rss"));
+    restore_podcast_source(read_podcast_cache(cache_file), &restored);
+    ASSERT_EQ(restored.get_title(), expected_title);
+    ASSERT_TRUE(QFile::remove(cache_file));
+}
+
+/******************************************************************************/
+TEST_F(SerializerFixture, binaryCacheDecodesDescriptionOnDemand) {
+    EXPECT_CALL(*(mc.get()), get_time())
+        .WillRepeatedly(Return(expected_timestamp));
+    QString first_file("binary_cache_1");
+    QString second_file("binary_cache_2");
+    PodcastSource source(QUrl("http://some.url/feed.rss"));
+    source.set_title(expected_title);
+    for (int i = 0; i < 3; i++) {
+        auto e = std::make_shared<PodcastEpisode>(
+            QString("Title_%1").arg(i), QUrl(QString("http://ep/%1").arg(i)));
+        e->set_description(QString("<p>Description_%1 äöü</p>").arg(i));
+        e->set_publication_date(expected_timestamp.addDays(-i));
+        e->set_duration(1000 * (i + 1));
+        e->set_position(i);
+        source.add_episode(e);
+    }
+    store_to_file(&source, first_file);
+
+    PodcastSource restored(QUrl("http://some.url/feed.rss"));
+    read_from_file(&restored, first_file);
+    ASSERT_EQ(restored.get_title(), expected_title);
+    ASSERT_EQ(restored.get_episode_count(), 3);
+    auto ep = restored.get_episode_by_id("http://ep/1");
+    ASSERT_TRUE(ep);
+    ASSERT_EQ(ep->get_publication_date(), expected_timestamp.addDays(-1));
+    ASSERT_EQ(ep->get_duration(), 2000);
+    ASSERT_EQ(ep->get_position(), 1);
+    /* not decoded until needed */
+    ASSERT_TRUE(ep->get_mapped_description().is_valid());
+    ASSERT_EQ(ep->get_description(), QString("<p>Description_1 äöü</p>"));
+    ASSERT_FALSE(ep->get_mapped_description().is_valid());
+
+    /* descriptions not decoded are copied to the new file */
+    store_to_file(&restored, second_file);
+    ASSERT_TRUE(QFile::remove(first_file));
+    auto cache = read_podcast_cache(second_file);
+    ASSERT_EQ(cache.episodes.size(), 3U);
+    ASSERT_EQ(cache.episodes[2].mapped_description.to_string(),
+        QString("<p>Description_2 äöü</p>"));
+    ASSERT_TRUE(QFile::remove(second_file));
+}
+
+/******************************************************************************/
+TEST_F(SerializerFixture, jsonCacheIsMigrated) {
+    EXPECT_CALL(*(mc.get()), get_time())
+        .WillRepeatedly(Return(expected_timestamp));
+    PodcastSource source(QUrl("http://some.url/feed.rss"));
+    source.set_title(expected_title);
+    auto e = std::make_shared<PodcastEpisode>(episode1_title, episode1_url);
+    e->set_description(expected_desc);
+    source.add_episode(e);
+    auto cache_file = cache_dir.filePath(source.get_id_string());
+    write_cache_json(cache_json_from_podcast_source(&source), cache_file);
+
+    auto serializer = std::make_unique<PodcastSerializer>(cache_dir, &source);
+    PodcastSource restored(QUrl("http://some.url/feed.rss"), source.get_id());
+    serializer->set_podcast_source(&restored);
+    serializer->restore_info();
+    ASSERT_EQ(restored.get_title(), expected_title);
+    ASSERT_EQ(restored.get_episode_count(), 1);
+    /* next write converts the cache file */
+    serializer->write();
+    serializer.reset();
+    ASSERT_THROW(read_cache_json(cache_file), PodcastSourceJSonCorrupted);
+    auto cache = read_podcast_cache(cache_file);
+    ASSERT_EQ(cache.episodes.size(), 1U);
+    ASSERT_EQ(cache.episodes[0].title, episode1_title);
+    ASSERT_EQ(cache.episodes[0].mapped_description.to_string(), expected_desc);
+    ASSERT_TRUE(QFile::remove(cache_file));
+}
+
+/******************************************************************************/
+TEST_F(SerializerFixture, truncatedBinaryCacheThrows) {
+    EXPECT_CALL(*(mc.get()), get_time())
+        .WillRepeatedly(Return(expected_timestamp));
+    QString test_file_name("truncated_cache");
+    PodcastSource source(QUrl("http://some.url/feed.rss"));
+    source.add_episode(
+        std::make_shared<PodcastEpisode>(episode1_title, episode1_url));
+    store_to_file(&source, test_file_name);
+    QFile file(test_file_name);
+    ASSERT_TRUE(file.resize(file.size() - 4));
+    ASSERT_THROW(
+        read_podcast_cache(test_file_name), PodcastSourceJSonCorrupted);
+    ASSERT_TRUE(file.remove());
+}
+
+/******************************************************************************/
+TEST(Serializer, binaryCacheSmallerThanJson) {
+    QFile rss(TEST_FILE_PATH + "/alternativlos.rss");
+    ASSERT_TRUE(rss.open(QIODevice::ReadOnly));
+    PodcastSource feed(QUrl("http://some.url/feed.rss"));
+    update_podcast(feed, rss.readAll());
+    ASSERT_GT(feed.get_episode_count(), 0);
+
+    /* scale up the fixture to a long running podcast */
+    const int copies = 40;
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    ps.set_max_episodes(copies * feed.get_episode_count());
+    std::vector<std::shared_ptr<PodcastEpisode>> episodes;
+    for (int i = 0; i < copies; i++) {
+        for (const auto& ep : feed.get_episodes()) {
+            auto copy = std::make_shared<PodcastEpisode>(
+                ep->get_title(), ep->get_url());
+            copy->set_guid(ep->get_guid() + QString::number(i));
+            copy->set_description(ep->get_description());
+            copy->set_publisher(ep->get_publisher());
+            copy->set_duration(ep->get_duration());
+            copy->set_publication_date(
+                ep->get_publication_date().addYears(-i));
+            episodes.push_back(copy);
+        }
+    }
+    ps.add_episodes(episodes);
+    QString json_file("size_cache.json");
+    QString binary_file("size_cache.bin");
+    write_cache_json(cache_json_from_podcast_source(&ps), json_file);
+    store_to_file(&ps, binary_file);
+
+    /* both formats restore all episodes */
+    PodcastSource from_json(QUrl("http://some.url/feed.rss"));
+    from_json.set_max_episodes(ps.get_max_episodes());
+    restore_podcast_source(read_cache_json(json_file), &from_json);
+    ASSERT_EQ(from_json.get_episode_count(), ps.get_episode_count());
+    PodcastSource from_binary(QUrl("http://some.url/feed.rss"));
+    from_binary.set_max_episodes(ps.get_max_episodes());
+    read_from_file(&from_binary, binary_file);
+    ASSERT_EQ(from_binary.get_episode_count(), ps.get_episode_count());
+
+    EXPECT_LT(QFileInfo(binary_file).size(), QFileInfo(json_file).size());
+    QFile::remove(json_file);
+    QFile::remove(binary_file);
+}
+
 /******************************************************************************/
 TEST_F(SerializerFixture, purgeDeletesCacheFile) {
     auto uid =
@@ -406,6 +605,7 @@ TEST_F(SerializerFixture, purgeDeletesCacheFile) {
     ASSERT_EQ(source.get_title(), QString("MyTitle1"));
     ASSERT_TRUE(test_file.exists());
     source.purge();
+    worker_pool().waitForDone();
     ASSERT_FALSE(test_file.exists());
 }
 
@@ -439,3 +639,54 @@ TEST(Serializer, parseBadTimestamp) {
         PodcastSourceJSonCorrupted);
 }
 /******************************************************************************/
+
+/******************************************************************************/
+TEST(Serializer, storeIconDecodesScaled) {
+    QImage artwork(3000, 2000, QImage::Format_RGB32);
+    artwork.fill(Qt::darkRed);
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    ASSERT_TRUE(artwork.save(&buffer, "JPG"));
+
+    QDir cache_dir(DEFAULT_CACHE_DIR_PATH);
+    cache_dir.mkpath(".");
+    auto icon_path = cache_dir.filePath("test_icon.png");
+    ASSERT_TRUE(store_icon(buffer.data(), icon_path, DEFAULT_ICON_WIDTH));
+    QImage icon(icon_path);
+    EXPECT_EQ(icon.width(), DEFAULT_ICON_WIDTH);
+    EXPECT_EQ(icon.height(), DEFAULT_ICON_WIDTH * 2 / 3);
+    QFile::remove(icon_path);
+
+    EXPECT_FALSE(store_icon(QByteArray("no image"), icon_path, 88));
+    EXPECT_FALSE(QFile::exists(icon_path));
+}
+
+/******************************************************************************/
+TEST(Serializer, evictIconsLeastRecentlyUsed) {
+    QDir icon_dir(QDir(DEFAULT_CACHE_DIR_PATH).filePath("icon_test"));
+    icon_dir.mkpath(".");
+    auto now = QDateTime::currentDateTime();
+    std::vector<QString> icons;
+    for (int i = 0; i < 4; i++) {
+        auto path = icon_dir.filePath(QString("icon-%1.png").arg(i));
+        QFile file(path);
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(1000, 'x'));
+        /* icon-0 used longest ago */
+        file.setFileTime(
+            now.addSecs((i - 4) * 60), QFileDevice::FileModificationTime);
+        file.close();
+        icons.push_back(path);
+    }
+    /* icon-1 was just stored with an old modification time */
+    EXPECT_EQ(evict_icons(icon_dir, 2500, icons[1]), 1000);
+    EXPECT_FALSE(QFile::exists(icons[0]));
+    EXPECT_TRUE(QFile::exists(icons[1]));
+
+    touch_icon(icons[1]);
+    EXPECT_EQ(evict_icons(icon_dir, 2500, QString()), 1000);
+    EXPECT_TRUE(QFile::exists(icons[1]));
+    EXPECT_FALSE(QFile::exists(icons[2]));
+    EXPECT_TRUE(QFile::exists(icons[3]));
+    icon_dir.removeRecursively();
+}
@@ -17,6 +17,7 @@
 #include "PlayableItem.hpp"
 #include "PodcastSource.hpp"
 #include "appconstants.hpp"
+#include "position_journal.hpp"
 
 #include "serializer_mock.hpp"
 
@@ -145,6 +146,59 @@ TEST_F(PodcastSourceFixture, add_episodeEmitsCountChanged) {
     ASSERT_EQ(arguments.at(0).toInt(), 1);
 }
 
+/******************************************************************************/
+TEST_F(PodcastSourceFixture, addEpisodesEmitsOnce) {
+    QSignalSpy spy_count(&ps, SIGNAL(episodes_count_changed(int)));
+    QSignalSpy spy_changed(&ps, SIGNAL(episodes_changed(int, int)));
+    QSignalSpy spy_data(&ps, SIGNAL(dataChanged()));
+    ps.add_episode(ep2);
+    spy_count.clear();
+    spy_changed.clear();
+
+    /* unsorted, one known and one duplicate in the batch */
+    ps.add_episodes({ep1, ep3, ep2, ep3});
+    ASSERT_EQ(ps.get_episode_count(), 3);
+    EXPECT_EQ(ps.get_episodes()[0], ep3);
+    EXPECT_EQ(ps.get_episodes()[1], ep2);
+    EXPECT_EQ(ps.get_episodes()[2], ep1);
+    ASSERT_EQ(spy_count.count(), 1);
+    EXPECT_EQ(spy_count.takeFirst().at(0).toInt(), 3);
+    ASSERT_EQ(spy_changed.count(), 1);
+    auto args = spy_changed.takeFirst();
+    EXPECT_EQ(args.at(0).toInt(), 2);
+    EXPECT_EQ(args.at(1).toInt(), 0);
+    EXPECT_EQ(spy_data.count(), 0);
+
+    /* nothing new, nothing to notify */
+    ps.add_episodes({ep1, ep2});
+    EXPECT_EQ(spy_count.count(), 0);
+    EXPECT_EQ(spy_changed.count(), 0);
+}
+
+/******************************************************************************/
+TEST_F(PodcastSourceFixture, addEpisodesKeepsMostRecent) {
+    ps.set_max_episodes(2);
+    ps.add_episodes({ep2, ep1});
+    QSignalSpy spy_changed(&ps, SIGNAL(episodes_changed(int, int)));
+    auto ep4 = std::make_shared<PodcastEpisode>("Name4", QUrl("http://4"));
+    ep4->set_publication_date(QDateTime::fromSecsSinceEpoch(400000000));
+    auto ep0 = std::make_shared<PodcastEpisode>("Name0", QUrl("http://0"));
+    ep0->set_publication_date(QDateTime::fromSecsSinceEpoch(1000));
+
+    ps.add_episodes({ep0, ep3, ep4});
+    ASSERT_EQ(ps.get_episode_count(), 2);
+    EXPECT_EQ(ps.get_episodes()[0], ep4);
+    EXPECT_EQ(ps.get_episodes()[1], ep3);
+    /* evicted episodes are no longer found */
+    EXPECT_FALSE(ps.get_episode_by_id(ep1->get_guid()));
+    EXPECT_FALSE(ps.get_episode_by_id(ep2->get_guid()));
+    EXPECT_FALSE(ps.get_episode_by_id(ep0->get_guid()));
+    ASSERT_EQ(spy_changed.count(), 1);
+    auto args = spy_changed.takeFirst();
+    EXPECT_EQ(args.at(0).toInt(), 2);
+    EXPECT_EQ(args.at(1).toInt(), 2);
+}
+
 /******************************************************************************/
 TEST_F(PodcastSourceFixture, get_episode_names) {
     auto pi =
@@ -176,12 +230,41 @@ TEST_F(PodcastSourceFixture, getEpisodeById) {
     EXPECT_FALSE(non_existent);
 }
 
+/******************************************************************************/
+TEST_F(PodcastSourceFixture, evictedEpisodeNotFound) {
+    ps.set_max_episodes(2);
+    ps.add_episode(ep1);
+    ps.add_episode(ep2);
+    ps.add_episode(ep3);
+    // ep1 is oldest and was removed
+    EXPECT_FALSE(ps.get_episode_by_id(ep1->get_guid()));
+    EXPECT_EQ(ps.get_episode_by_id(ep2->get_guid()), ep2);
+    EXPECT_EQ(ps.get_episode_by_id(ep3->get_guid()), ep3);
+    // adding the old ep1 again does not change the list or the index
+    ps.add_episode(ep1);
+    EXPECT_EQ(ps.get_episodes().size(), 2);
+    EXPECT_FALSE(ps.get_episode_by_id(ep1->get_guid()));
+}
+
+/******************************************************************************/
+TEST_F(PodcastSourceFixture, purgeClearsEpisodeIndex) {
+    ps.add_episode(ep1);
+    ps.add_episode(ep2);
+    ps.purge_episodes();
+    EXPECT_FALSE(ps.get_episode_by_id(ep1->get_guid()));
+    ps.add_episode(ep1);
+    EXPECT_EQ(ps.get_episode_by_id(ep1->get_guid()), ep1);
+    EXPECT_EQ(ps.get_episodes().size(), 1);
+}
+
 /******************************************************************************/
 TEST_F(PodcastSourceFixture, set_updater) {
     ps.set_update_task(std::make_unique<UpdateTask>());
     ps.set_update_interval(std::chrono::seconds(1));
 
     QSignalSpy spy(&ps, SIGNAL(dataChanged()));
+    /* periodic refresh is done by RefreshScheduler */
+    ps.refresh();
     spy.wait(7000);
     ASSERT_GE(spy.count(), 1);
 }
@@ -312,21 +395,98 @@ TEST_F(PodcastSourceFixture, purgeWithSerializer) {
 }
 
 /******************************************************************************/
-TEST_F(PodcastSourceFixture, episodePositionChangedTriggersDelayedWrite) {
+TEST_F(PodcastSourceFixture, episodePositionChangedOnlyJournaled) {
     auto serializer = std::make_unique<SerializerMock>(
         cache_dir, &ps, std::chrono::milliseconds(50));
+    /* only for the title */
     EXPECT_CALL(*(serializer.get()), write_cache()).Times(1);
     QSignalSpy spy(&ps, SIGNAL(dataChanged()));
     ps.set_serializer(std::move(serializer));
+    auto journal = std::make_shared<PositionJournal>(
+        cache_dir.filePath(POSITION_JOURNAL_FILE_NAME));
+    ps.set_position_journal(journal);
     auto episode = std::make_shared<PodcastEpisode>(
         "TestEpisode", QUrl("http://some.url"));
     episode->set_duration(100000);
     ps.add_episode(episode);
     episode->set_position(4000);
+    EXPECT_FALSE(spy.wait(200));
+    EXPECT_EQ(journal->entry(episode->get_guid()).position, 4000);
+    EXPECT_EQ(journal->pending(), 1);
+    EXPECT_EQ(ps.get_episode_store().position(0), 4000);
+
+    episode->set_title("New Title");
     spy.wait(1000);
     EXPECT_EQ(spy.count(), 1);
 }
 
+/******************************************************************************/
+TEST(PodcastSource, adaptiveIntervalWeeklyFeed) {
+    using namespace std::chrono_literals;
+    auto newest = QDateTime::fromSecsSinceEpoch(1600000000);
+    std::vector<QDateTime> dates;
+    for (int i = 0; i < 6; i++) {
+        dates.push_back(newest.addDays(-7 * i));
+    }
+    const std::chrono::seconds week = 7 * 24h;
+    const std::chrono::seconds min = 1h;
+    const std::chrono::seconds max = 2 * week;
+    /* next episode expected in 4 days */
+    EXPECT_EQ(adaptive_update_interval(dates, 0, newest.addDays(3), min, max),
+        4 * 24h + FEED_RELEASE_GRACE);
+    /* release is overdue - look more often */
+    EXPECT_EQ(adaptive_update_interval(dates, 1, newest.addDays(8), min, max),
+        week / 8);
+    /* feed stalled - back off with each unchanged refresh */
+    EXPECT_EQ(adaptive_update_interval(dates, 2, newest.addDays(20), min, max),
+        week / 2);
+    EXPECT_EQ(
+        adaptive_update_interval(dates, 10, newest.addDays(20), min, max), max);
+    /* bounds of the configuration */
+    EXPECT_EQ(
+        adaptive_update_interval(dates, 0, newest.addDays(3), min, 24h), 24h);
+    EXPECT_EQ(
+        adaptive_update_interval(dates, 0, newest.addDays(3), week, max), week);
+}
+
+/******************************************************************************/
+TEST(PodcastSource, adaptiveIntervalTooFewEpisodes) {
+    using namespace std::chrono_literals;
+    auto newest = QDateTime::fromSecsSinceEpoch(1600000000);
+    std::vector<QDateTime> dates{newest, newest.addDays(-7)};
+    EXPECT_EQ(adaptive_update_interval(dates, 0, newest, 2h, 24h), 2h);
+    EXPECT_EQ(adaptive_update_interval({}, 0, newest, 2h, 24h), 2h);
+}
+
+/******************************************************************************/
+TEST_F(PodcastSourceFixture, recordRefreshLearnsInterval) {
+    using namespace std::chrono_literals;
+    ps.add_episode(ep1);
+    ps.add_episode(ep2);
+    ps.add_episode(ep3);
+    ASSERT_EQ(ps.get_effective_update_interval(), ps.get_update_interval());
+
+    QSignalSpy spy(&ps, SIGNAL(dataChanged()));
+    /* last episode years ago - poll at the upper bound */
+    ps.record_refresh(false);
+    EXPECT_EQ(ps.get_unchanged_refreshes(), 1);
+    EXPECT_EQ(ps.get_learned_update_interval(), ps.get_max_update_interval());
+    EXPECT_EQ(
+        ps.get_effective_update_interval(), ps.get_max_update_interval());
+    EXPECT_EQ(spy.count(), 1);
+    /* same interval, the counter is still written */
+    ps.record_refresh(false);
+    EXPECT_EQ(ps.get_unchanged_refreshes(), 2);
+    EXPECT_EQ(spy.count(), 2);
+    ps.record_refresh(true);
+    EXPECT_EQ(ps.get_unchanged_refreshes(), 0);
+    EXPECT_EQ(spy.count(), 3);
+
+    /* configured bounds take precedence over a learned interval */
+    ps.set_max_update_interval(6h);
+    EXPECT_EQ(ps.get_effective_update_interval(), 6h);
+}
+
 /******************************************************************************/
 TEST(PodcastSource, fromGoodJson) {
     QString json_string(R"(
@@ -338,7 +498,8 @@ TEST(PodcastSource, fromGoodJson) {
     "timestamp": "Thu Nov 14 19:48:55 2019",
 	"url": "https://alternativlos.org/alternativlos.rss",
     "title": "MyTitle",
-	"maxEpisodes" : 3
+	"maxEpisodes" : 3,
+	"offlineEpisodes" : 2
 	})");
     auto jdoc = QJsonDocument::fromJson(json_string.toUtf8());
     auto ps = PodcastSource::from_json_object(jdoc.object());
@@ -349,6 +510,7 @@ TEST(PodcastSource, fromGoodJson) {
     EXPECT_EQ(ps->get_description(), QString("Some Description"));
     EXPECT_EQ(ps->get_icon(), QString("https://some.remote.url/test.jpg"));
     EXPECT_EQ(ps->get_max_episodes(), 3);
+    EXPECT_EQ(ps->get_offline_episodes(), 2);
 }
 
 /******************************************************************************/
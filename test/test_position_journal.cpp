@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "PodcastSource.hpp"
+#include "appconstants.hpp"
+#include "episode_cache.hpp"
+#include "position_journal.hpp"
+
+using namespace DigitalRooster;
+
+/******************************************************************************/
+class PositionJournalFixture : public virtual ::testing::Test {
+public:
+    PositionJournalFixture()
+        : cache_dir(DEFAULT_CACHE_DIR_PATH)
+        , journal_path(
+              cache_dir.filePath("test_" + POSITION_JOURNAL_FILE_NAME)) {
+    }
+
+    void SetUp() {
+        cache_dir.mkpath(".");
+        QFile::remove(journal_path);
+    }
+
+    void TearDown() {
+        QFile::remove(journal_path);
+    }
+
+protected:
+    QDir cache_dir;
+    QString journal_path;
+};
+
+/******************************************************************************/
+TEST_F(PositionJournalFixture, flushAndReload) {
+    {
+        PositionJournal journal(journal_path);
+        EXPECT_EQ(journal.entry("guid-1").position, -1);
+        journal.record("guid-1", 1000, false);
+        journal.record("guid-2", 2000, true);
+        EXPECT_EQ(journal.pending(), 2);
+        journal.flush();
+        EXPECT_EQ(journal.pending(), 0);
+        /* no change, nothing to write */
+        journal.record("guid-1", 1000, false);
+        EXPECT_EQ(journal.pending(), 0);
+    }
+    PositionJournal journal(journal_path);
+    EXPECT_EQ(journal.size(), 2);
+    EXPECT_EQ(journal.entry("guid-1").position, 1000);
+    EXPECT_FALSE(journal.entry("guid-1").listened);
+    EXPECT_EQ(journal.entry("guid-2").position, 2000);
+    EXPECT_TRUE(journal.entry("guid-2").listened);
+}
+
+/******************************************************************************/
+TEST_F(PositionJournalFixture, recordsUpdatedInPlace) {
+    PositionJournal journal(journal_path);
+    journal.record("guid-1", 1000, false);
+    journal.record("guid-2", 2000, true);
+    journal.flush();
+    auto size = QFileInfo(journal_path).size();
+
+    journal.record("guid-1", 5000, true);
+    /* listened stays set when the episode is played from the start */
+    journal.record("guid-2", 0, false);
+    journal.record("guid-2", 100, false);
+    journal.flush();
+    EXPECT_EQ(QFileInfo(journal_path).size(), size);
+    journal.record("guid-3", 300, false);
+    journal.flush();
+    EXPECT_GT(QFileInfo(journal_path).size(), size);
+
+    PositionJournal reloaded(journal_path);
+    EXPECT_EQ(reloaded.size(), 3);
+    EXPECT_EQ(reloaded.entry("guid-1").position, 5000);
+    EXPECT_TRUE(reloaded.entry("guid-1").listened);
+    EXPECT_EQ(reloaded.entry("guid-2").position, 100);
+    EXPECT_TRUE(reloaded.entry("guid-2").listened);
+    EXPECT_EQ(reloaded.entry("guid-3").position, 300);
+}
+
+/******************************************************************************/
+TEST_F(PositionJournalFixture, invalidFileDiscarded) {
+    QFile file(journal_path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("not a journal at all, just some text");
+    file.close();
+
+    PositionJournal journal(journal_path);
+    EXPECT_EQ(journal.size(), 0);
+    journal.record("guid-1", 1000, false);
+    journal.flush();
+    PositionJournal reloaded(journal_path);
+    EXPECT_EQ(reloaded.size(), 1);
+    EXPECT_EQ(reloaded.entry("guid-1").position, 1000);
+}
+
+/******************************************************************************/
+TEST_F(PositionJournalFixture, compactionDropsOldest) {
+    const int extra = 10;
+    {
+        PositionJournal journal(journal_path);
+        for (int i = 0; i < POSITION_JOURNAL_MAX_ENTRIES + extra; i++) {
+            journal.record(QString("guid-%1").arg(i), i + 1, false);
+        }
+        /* played again, now the most recent */
+        journal.record("guid-0", 4711, false);
+        journal.flush();
+        EXPECT_EQ(journal.size(), POSITION_JOURNAL_MAX_ENTRIES);
+    }
+    PositionJournal journal(journal_path);
+    EXPECT_EQ(journal.size(), POSITION_JOURNAL_MAX_ENTRIES);
+    EXPECT_EQ(journal.entry("guid-0").position, 4711);
+    for (int i = 1; i <= extra; i++) {
+        EXPECT_EQ(journal.entry(QString("guid-%1").arg(i)).position, -1);
+    }
+    EXPECT_EQ(journal.entry(QString("guid-%1").arg(extra + 1)).position,
+        extra + 2);
+}
+
+/******************************************************************************/
+TEST_F(PositionJournalFixture, flushedAfterInterval) {
+    PositionJournal journal(journal_path, std::chrono::milliseconds(50));
+    journal.record("guid-1", 1000, false);
+    EXPECT_EQ(journal.pending(), 1);
+
+    QTimer wait_timer;
+    wait_timer.setSingleShot(true);
+    QSignalSpy spy(&wait_timer, SIGNAL(timeout()));
+    wait_timer.start(200);
+    ASSERT_TRUE(spy.wait(1000));
+    EXPECT_EQ(journal.pending(), 0);
+    EXPECT_TRUE(QFile::exists(journal_path));
+}
+
+/******************************************************************************/
+TEST_F(PositionJournalFixture, failedCompactionIsRetried) {
+    QDir missing_dir(cache_dir.filePath("test_journal_dir"));
+    missing_dir.removeRecursively();
+    auto path = missing_dir.filePath(POSITION_JOURNAL_FILE_NAME);
+    PositionJournal journal(path, std::chrono::milliseconds(50));
+    journal.record("guid-1", 1000, false);
+    journal.record("guid-2", 2000, true);
+    /* directory does not exist, the new file cannot be written */
+    journal.flush();
+    EXPECT_EQ(journal.pending(), 2);
+    EXPECT_FALSE(QFile::exists(path));
+
+    /* retried without another change */
+    missing_dir.mkpath(".");
+    QTimer wait_timer;
+    wait_timer.setSingleShot(true);
+    QSignalSpy spy(&wait_timer, SIGNAL(timeout()));
+    wait_timer.start(200);
+    ASSERT_TRUE(spy.wait(1000));
+    EXPECT_EQ(journal.pending(), 0);
+    EXPECT_TRUE(QFile::exists(path));
+    missing_dir.removeRecursively();
+}
+
+/******************************************************************************/
+TEST_F(PositionJournalFixture, restoreMergesPositions) {
+    auto journal = std::make_shared<PositionJournal>(journal_path);
+    journal->record("guid-2", 1234, false);
+    /* listened before and played again from the start */
+    journal->record("guid-3", 0, true);
+
+    std::vector<EpisodeRecord> records;
+    for (int i = 1; i <= 3; i++) {
+        EpisodeRecord record;
+        record.title = QString("Episode %1").arg(i);
+        record.guid = QString("guid-%1").arg(i);
+        record.url = QUrl(QString("http://some.url/%1.mp3").arg(i));
+        record.publication_date =
+            QDateTime::fromSecsSinceEpoch(1000000000LL + i * 3600LL);
+        record.duration = 3600000;
+        /* position of the cache file, older than the journal */
+        record.position = 100;
+        records.push_back(record);
+    }
+
+    PodcastSource ps(QUrl("http://some.url/feed.rss"));
+    ps.add_episode_records(records);
+    const auto& store = ps.get_episode_store();
+    auto episode = ps.get_episode(store.row_of("guid-2"));
+    ps.set_position_journal(journal);
+    EXPECT_EQ(store.position(store.row_of("guid-2")), 1234);
+    EXPECT_EQ(episode->get_position(), 1234);
+    EXPECT_EQ(store.position(store.row_of("guid-1")), 100);
+    EXPECT_EQ(store.position(store.row_of("guid-3")), 0);
+    EXPECT_TRUE(store.listened(store.row_of("guid-3")));
+    EXPECT_FALSE(store.listened(store.row_of("guid-1")));
+    EXPECT_TRUE(ps.get_episode(store.row_of("guid-3"))->already_listened());
+
+    /* episodes added later get their journaled position too */
+    journal->record("guid-4", 4321, false);
+    auto record = records.back();
+    record.guid = "guid-4";
+    record.publication_date = record.publication_date.addDays(1);
+    ps.add_episode_records({record});
+    EXPECT_EQ(store.position(store.row_of("guid-4")), 4321);
+}
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+/*
+ * copyright (c) 2020  Thomas Ruschival <thomas@ruschival.de>
+ * Licensed under GNU PUBLIC LICENSE Version 3 or later
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSignalSpy>
+
+#include <memory>
+
+#include "gtest/gtest.h"
+
+#include "PodcastSource.hpp"
+#include "appconstants.hpp"
+#include "configuration.hpp"
+#include "refresh_scheduler.hpp"
+
+using namespace DigitalRooster;
+using namespace std::chrono_literals;
+
+class RefreshSchedulerFixture : public virtual ::testing::Test {
+public:
+    RefreshSchedulerFixture()
+        : filename(TEST_FILE_PATH + "/refresh_scheduler.json")
+        , cache_dir(TEST_FILE_PATH + "/refresh_scheduler_cache") {
+    }
+
+    void TearDown() {
+        scheduler.reset();
+        config.reset();
+        QFile::remove(filename);
+        QFile::remove(filename + CONFIG_SNAPSHOT_SUFFIX);
+        QFile::remove(filename + CONFIG_JOURNAL_SUFFIX);
+        QDir(cache_dir).removeRecursively();
+    }
+
+protected:
+    QString filename;
+    QString cache_dir;
+    std::unique_ptr<Configuration> config;
+    std::unique_ptr<RefreshScheduler> scheduler;
+
+    /**
+     * Write configuration with one podcast source per file and
+     * start scheduler without jitter
+     */
+    void create_scheduler(const QStringList& rss_files, int max_concurrent) {
+        QJsonArray podcasts;
+        for (const auto& rss_file : rss_files) {
+            QJsonObject pc;
+            pc[KEY_ID] = QUuid::createUuid().toString();
+            pc[KEY_URI] = QString::fromUtf8(
+                QUrl::fromLocalFile(TEST_FILE_PATH + "/" + rss_file)
+                    .toEncoded());
+            pc[KEY_UPDATE_INTERVAL] = 3600;
+            podcasts.append(pc);
+        }
+        QJsonObject appconfig;
+        appconfig[KEY_GROUP_PODCAST_SOURCES] = podcasts;
+        QFile tf(filename);
+        tf.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+        tf.write(QJsonDocument(appconfig).toJson());
+        tf.close();
+        QDir().mkpath(cache_dir);
+
+        config = std::make_unique<Configuration>(filename, cache_dir);
+        QSignalSpy restored(config.get(), SIGNAL(podcast_sources_changed()));
+        config->update_configuration();
+        /* caches are restored on the worker pool */
+        restored.wait(1000);
+        scheduler =
+            std::make_unique<RefreshScheduler>(*config, max_concurrent, 0ms);
+    }
+
+    /**
+     * Process events until no refresh is running or queued
+     */
+    void wait_idle() {
+        QSignalSpy spy(scheduler.get(), SIGNAL(queue_changed()));
+        for (int i = 0; i < 20; i++) {
+            if (scheduler->get_running() == 0 &&
+                scheduler->get_queue_depth() == 0) {
+                return;
+            }
+            spy.wait(500);
+        }
+    }
+};
+
+/*****************************************************************************/
+TEST_F(RefreshSchedulerFixture, limitsConcurrentRefreshes) {
+    create_scheduler(
+        {"alternativlos.rss", "alternativlos.rss", "alternativlos.rss"}, 1);
+    ASSERT_EQ(config->get_podcast_sources().size(), 3U);
+    /* all due at once, only one download at a time */
+    ASSERT_EQ(scheduler->get_running(), 1);
+    ASSERT_EQ(scheduler->get_queue_depth(), 2);
+
+    wait_idle();
+    ASSERT_EQ(scheduler->get_running(), 0);
+    ASSERT_EQ(scheduler->get_queue_depth(), 0);
+    auto earliest = QDateTime::currentDateTime().addSecs(3500);
+    for (const auto& ps : config->get_podcast_sources()) {
+        EXPECT_GT(ps->get_episode_count(), 0);
+        EXPECT_GT(scheduler->get_next_refresh(ps->get_id()), earliest);
+    }
+}
+
+/*****************************************************************************/
+TEST_F(RefreshSchedulerFixture, backoffForFailingHost) {
+    create_scheduler({"does_not_exist.rss"}, 2);
+    auto ps = config->get_podcast_sources()[0];
+    /* local feeds are keyed by url */
+    auto host = ps->get_url().toString();
+    ASSERT_EQ(scheduler->get_backoff(host), 0s);
+
+    wait_idle();
+    ASSERT_EQ(scheduler->get_backoff(host), FEED_REFRESH_BACKOFF_MIN);
+    auto next = scheduler->get_next_refresh(ps->get_id());
+    ASSERT_GT(next, QDateTime::currentDateTime().addSecs(30));
+    ASSERT_LT(next,
+        QDateTime::currentDateTime().addSecs(
+            FEED_REFRESH_BACKOFF_MIN.count() + 1));
+
+    /* next failure doubles the delay */
+    QSignalSpy spy(ps.get(), SIGNAL(update_finished(bool)));
+    ps->refresh();
+    ASSERT_TRUE(spy.wait(2000));
+    ASSERT_EQ(scheduler->get_backoff(host), 2 * FEED_REFRESH_BACKOFF_MIN);
+}
+
+/*****************************************************************************/
+TEST_F(RefreshSchedulerFixture, localFeedsBackOffSeparately) {
+    create_scheduler({"does_not_exist.rss", "missing.rss"}, 2);
+    wait_idle();
+    for (const auto& ps : config->get_podcast_sources()) {
+        EXPECT_EQ(scheduler->get_backoff(ps->get_url().toString()),
+            FEED_REFRESH_BACKOFF_MIN);
+    }
+    ASSERT_EQ(scheduler->get_backoff(QString()), 0s);
+}
+
+/*****************************************************************************/
+TEST_F(RefreshSchedulerFixture, removedSourcesAreUnscheduled) {
+    create_scheduler({"alternativlos.rss", "alternativlos.rss"}, 2);
+    wait_idle();
+    auto id = config->get_podcast_sources()[0]->get_id();
+    ASSERT_TRUE(scheduler->get_next_refresh(id).isValid());
+    config->delete_podcast_source(id);
+    ASSERT_FALSE(scheduler->get_next_refresh(id).isValid());
+    ASSERT_TRUE(scheduler->get_next_refresh(
+        config->get_podcast_sources()[0]->get_id()).isValid());
+}
+
+/*****************************************************************************/
+TEST_F(RefreshSchedulerFixture, defaultPodcastsAreRefreshed) {
+    /* no configuration file, the default configuration is created */
+    QFile::remove(filename);
+    QDir().mkpath(cache_dir);
+    config = std::make_unique<Configuration>(filename, cache_dir);
+    QSignalSpy restored(config.get(), SIGNAL(podcast_sources_changed()));
+    config->update_configuration();
+    restored.wait(1000);
+    ASSERT_EQ(config->get_podcast_sources().size(), 3U);
+    for (const auto& ps : config->get_podcast_sources()) {
+        EXPECT_TRUE(ps->has_update_task());
+    }
+    scheduler = std::make_unique<RefreshScheduler>(*config, 3, 0ms);
+    ASSERT_EQ(scheduler->get_running(), 3);
+    ASSERT_EQ(scheduler->get_queue_depth(), 0);
+}
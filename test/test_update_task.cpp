@@ -24,6 +24,7 @@ TEST(TestDownload, parsed) {
         QUrl("https://alternativlos.org/alternativlos.rss"));
     QSignalSpy spy(&ps, SIGNAL(titleChanged()));
     UpdateTask task(&ps);
+    task.start();
     ASSERT_TRUE(spy.wait());
     ASSERT_EQ(ps.get_title(), "Alternativlos");
 }
@@ -37,11 +38,48 @@ TEST(TestDownload, donotReEmitEpisodesChanged) {
         QUrl("https://alternativlos.org/alternativlos.rss"));
     QSignalSpy spy(&ps, SIGNAL(titleChanged()));
     UpdateTask task(&ps);
+    task.start();
     spy.wait(1000);
     QSignalSpy spy2(&ps, SIGNAL(episodesChanged()));
+    /* unconditional request, otherwise the server may answer 304 */
+    ps.set_http_validators(QString(), QString());
     task.start();
     spy.wait(700);
     ASSERT_EQ(spy.count(), 2);
     ASSERT_EQ(spy2.count(), 0);
     ASSERT_EQ(ps.get_title(), "Alternativlos");
 }
+
+/*****************************************************************************/
+TEST(TestDownload, countsRequests) {
+    PodcastSource ps(
+        QUrl("https://alternativlos.org/alternativlos.rss"));
+    QSignalSpy spy(&ps, SIGNAL(titleChanged()));
+    UpdateTask task(&ps);
+    task.start();
+    ASSERT_TRUE(spy.wait());
+    auto stats = task.get_statistics();
+    ASSERT_EQ(stats.requests, 1);
+    ASSERT_EQ(stats.downloads, 1);
+    ASSERT_GT(stats.bytes_downloaded, 0);
+    ASSERT_EQ(stats.not_modified, 0);
+}
+
+/*****************************************************************************/
+TEST(TestDownload, noRefreshWithoutStart) {
+    PodcastSource ps(
+        QUrl("https://alternativlos.org/alternativlos.rss"));
+    UpdateTask task(&ps);
+    /* RefreshScheduler decides when to start */
+    ASSERT_EQ(task.get_statistics().requests, 0);
+}
+
+/*****************************************************************************/
+TEST(TestDownload, finishedReportsFailure) {
+    PodcastSource ps(QUrl::fromLocalFile("/some/nonexistent/feed.rss"));
+    UpdateTask task(&ps);
+    QSignalSpy spy(&task, SIGNAL(finished(bool)));
+    task.start();
+    ASSERT_TRUE(spy.wait(2000));
+    ASSERT_FALSE(spy.takeFirst().at(0).toBool());
+}